@@ -0,0 +1,299 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <variant>
+
+#include "../src/lib/Environment.hpp"
+#include "../src/lib/Interpreter.hpp"
+#include "../src/lib/Lexer.hpp"
+#include "../src/lib/Parser.hpp"
+#include "../src/lib/TypeInference.hpp"
+#include "../src/lib/VirtualMachine.hpp"
+
+namespace {
+using Value = Interpreter::ExpressionValue;
+
+auto generateArithmetic(std::size_t statements) -> std::string {
+  std::string source = "var x = 1; var y = 2; var z = 3;\n";
+  for (std::size_t i = 0; i < statements; ++i) {
+    auto n = std::to_string(i % 100);
+    source += "var a = x * 2 + y / 3 - (z - x) * " + n + ";\n";
+    source += "x = a * 0.5 > y ? y - 1 : z + x / 4;\n";
+    source += "y = (x + y) * (x - y) / (a + 1000), z = z - 1;\n";
+  }
+  return source;
+}
+
+auto generateNested(std::size_t terms) -> std::string {
+  std::string source = "var x = 1;\nprint 0";
+  for (std::size_t i = 1; i < terms; ++i) {
+    source += i % 2 == 0 ? " + x" : " * x";
+  }
+  return source + ";\n";
+}
+
+// the shapes the superinstructions fuse
+auto generateCounters(std::size_t statements) -> std::string {
+  std::string source = "var i = 0; var x = 1; var y = 2; var b = 0;\n";
+  for (std::size_t i = 0; i < statements; ++i) {
+    source += "i = i + 1; b = i < 100; x = x * y; y = x - y;\n";
+  }
+  return source;
+}
+
+// the same concatenations repeated in every expression
+auto generateCommon(std::size_t statements) -> std::string {
+  std::string source = "var x = \"lorem ipsum\"; var y = \"dolor sit\";\n";
+  for (std::size_t i = 0; i < statements; ++i) {
+    source += "var a = x + y + x == x + y + x ? x + y + x : y;\n";
+    source += "var b = (x + \" \" + y) + (x + \" \" + y);\n";
+  }
+  return source;
+}
+
+// a report assembled by appending its lines, printed once
+auto generateReport(std::size_t statements) -> std::string {
+  std::string source = "var report = \"\"; var name = \"lorem\";\n";
+  for (std::size_t i = 0; i < statements; ++i) {
+    source += "report = report + name + \" ipsum dolor sit amet \";\n";
+  }
+  return source + "print report;\n";
+}
+
+auto parse(std::string const &source, ErrorReporter &err,
+           SymbolTable &symbols) -> Program {
+  Lexer lexer{source, err, symbols};
+  auto const &tokens = lexer.scanTokens().value().get();
+  Parser parser{tokens, err, symbols};
+  return parser.parse().value();
+}
+
+// a reduced recursive evaluator, kept as a reference point: the arithmetic
+// subset of Interpreter::ExpressionVisitor
+struct ReferenceVisitor {
+  Environment &m_env;
+
+  auto operator()(Node<LiteralNumberExpression> const &e) -> Value {
+    return e->getValue();
+  }
+  auto operator()(Node<VariableExpression> const &e) -> Value {
+    return m_env.get(e).value();
+  }
+  auto operator()(Node<GroupingExpression> const &e) -> Value {
+    return std::visit(*this, e->getExpression());
+  }
+  auto operator()(Node<TernaryExpression> const &e) -> Value {
+    auto condition = std::visit(*this, e->getConditionExpression());
+    if (condition.getBool()) {
+      return std::visit(*this, e->getTrueExpression());
+    }
+    return std::visit(*this, e->getFalseExpression());
+  }
+  auto operator()(Node<AssignExpression> const &e) -> Value {
+    auto value = std::visit(*this, e->getValue());
+    m_env.assign(e, value);
+    return value;
+  }
+  template <TokenType type>
+  auto operator()(Node<BinaryExpression<type> > const &e) -> Value {
+    auto left = std::visit(*this, e->getLeftExpression());
+    auto right = std::visit(*this, e->getRightExpression());
+    if (!left.isNumber() || !right.isNumber()) {
+      throw std::runtime_error("Operands must be numbers");
+    }
+    auto l = left.getNumber();
+    auto r = right.getNumber();
+    switch (type) {
+      case TokenType::TOKEN_LESS:
+        return l < r;
+      case TokenType::TOKEN_GREATER:
+        return l > r;
+      case TokenType::TOKEN_PLUS:
+        return l + r;
+      case TokenType::TOKEN_MINUS:
+        return l - r;
+      case TokenType::TOKEN_STAR:
+        return l * r;
+      case TokenType::TOKEN_SLASH:
+        return l / r;
+      case TokenType::TOKEN_COMMA:
+        return right;
+      default:
+        throw std::runtime_error("Unexpected operator");
+    }
+  }
+  template <typename T>
+  auto operator()([[maybe_unused]] T const &e) -> Value {
+    throw std::runtime_error("Unexpected expression");
+  }
+};
+
+struct ReferenceStatementVisitor {
+  Environment &m_env;
+
+  void operator()(Node<PrintStatement> const &s) {
+    benchmark::DoNotOptimize(
+        std::visit(ReferenceVisitor{m_env}, s->getExpression()));
+  }
+  void operator()(Node<ExpressionStatement> const &s) {
+    std::visit(ReferenceVisitor{m_env}, s->getExpression());
+  }
+  void operator()(Node<VariableDeclaration> const &s) {
+    m_env.define(s->getSymbol(), std::visit(ReferenceVisitor{m_env},
+                                            s->getInitializer().value()));
+  }
+  void operator()([[maybe_unused]] Node<BlockStatement> const &s) {}
+};
+
+// the Interpreter walks the tree of the expressions, it only runs a tape for
+// the nodes nested deeper than its recursion, and for every expression while
+// sharing
+void runInterpreter(benchmark::State &state, std::string const &source,
+                    bool sharing = false, bool typed = false) {
+  ErrorReporter err;
+  SymbolTable symbols;
+  auto program = parse(source, err, symbols);
+  if (typed) {
+    TypeInference::infer(program);
+  }
+
+  for (auto _ : state) {
+    Environment env{err};
+    Interpreter interpreter{program.getStatements(), env, err};
+    interpreter.setSharing(sharing);
+    benchmark::DoNotOptimize(interpreter.interpret());
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() *
+                                                    source.size()));
+}
+
+// precompiled runs the bytecode compiled by the first call again, without
+// compiling it in the loop
+void runVirtualMachine(benchmark::State &state, std::string const &source,
+                       bool precompiled = false) {
+  ErrorReporter err;
+  SymbolTable symbols;
+  auto program = parse(source, err, symbols);
+
+  if (precompiled) {
+    Environment env{err};
+    VirtualMachine vm{program.getStatements(), env, err};
+    benchmark::DoNotOptimize(vm.interpret());
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(vm.interpret());
+    }
+  } else {
+    for (auto _ : state) {
+      Environment env{err};
+      VirtualMachine vm{program.getStatements(), env, err};
+      benchmark::DoNotOptimize(vm.interpret());
+    }
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() *
+                                                    source.size()));
+}
+
+void runVisitor(benchmark::State &state, std::string const &source) {
+  ErrorReporter err;
+  SymbolTable symbols;
+  auto program = parse(source, err, symbols);
+
+  for (auto _ : state) {
+    Environment env{err};
+    ReferenceStatementVisitor visitor{env};
+    for (auto const &statement : program.getStatements()) {
+      std::visit(visitor, statement);
+    }
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() *
+                                                    source.size()));
+}
+}  // namespace
+
+static void BM_InterpreterArithmeticTree(benchmark::State &state) {
+  runInterpreter(state, generateArithmetic(state.range(0)));
+}
+BENCHMARK(BM_InterpreterArithmeticTree)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterArithmeticVirtualMachine(benchmark::State &state) {
+  runVirtualMachine(state, generateArithmetic(state.range(0)));
+}
+BENCHMARK(BM_InterpreterArithmeticVirtualMachine)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterArithmeticVirtualMachineRun(
+    benchmark::State &state) {
+  runVirtualMachine(state, generateArithmetic(state.range(0)), true);
+}
+BENCHMARK(BM_InterpreterArithmeticVirtualMachineRun)
+    ->Arg(1 << 10)
+    ->Arg(1 << 14);
+
+static void BM_InterpreterArithmeticTypedTree(benchmark::State &state) {
+  runInterpreter(state, generateArithmetic(state.range(0)), false, true);
+}
+BENCHMARK(BM_InterpreterArithmeticTypedTree)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterArithmeticVisitor(benchmark::State &state) {
+  runVisitor(state, generateArithmetic(state.range(0)));
+}
+BENCHMARK(BM_InterpreterArithmeticVisitor)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterNestedTree(benchmark::State &state) {
+  runInterpreter(state, generateNested(state.range(0)));
+}
+BENCHMARK(BM_InterpreterNestedTree)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterNestedVirtualMachine(benchmark::State &state) {
+  runVirtualMachine(state, generateNested(state.range(0)));
+}
+BENCHMARK(BM_InterpreterNestedVirtualMachine)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterNestedVisitor(benchmark::State &state) {
+  runVisitor(state, generateNested(state.range(0)));
+}
+BENCHMARK(BM_InterpreterNestedVisitor)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterCountersTree(benchmark::State &state) {
+  runInterpreter(state, generateCounters(state.range(0)));
+}
+BENCHMARK(BM_InterpreterCountersTree)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterCountersVirtualMachine(benchmark::State &state) {
+  runVirtualMachine(state, generateCounters(state.range(0)));
+}
+BENCHMARK(BM_InterpreterCountersVirtualMachine)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterCountersVirtualMachineRun(benchmark::State &state) {
+  runVirtualMachine(state, generateCounters(state.range(0)), true);
+}
+BENCHMARK(BM_InterpreterCountersVirtualMachineRun)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterCountersVisitor(benchmark::State &state) {
+  runVisitor(state, generateCounters(state.range(0)));
+}
+BENCHMARK(BM_InterpreterCountersVisitor)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterCommonTree(benchmark::State &state) {
+  runInterpreter(state, generateCommon(state.range(0)));
+}
+BENCHMARK(BM_InterpreterCommonTree)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterCommonVirtualMachine(benchmark::State &state) {
+  runVirtualMachine(state, generateCommon(state.range(0)));
+}
+BENCHMARK(BM_InterpreterCommonVirtualMachine)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterCommonSharedTape(benchmark::State &state) {
+  runInterpreter(state, generateCommon(state.range(0)), true);
+}
+BENCHMARK(BM_InterpreterCommonSharedTape)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterReportTree(benchmark::State &state) {
+  runInterpreter(state, generateReport(state.range(0)));
+}
+BENCHMARK(BM_InterpreterReportTree)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_InterpreterReportVirtualMachine(benchmark::State &state) {
+  runVirtualMachine(state, generateReport(state.range(0)));
+}
+BENCHMARK(BM_InterpreterReportVirtualMachine)->Arg(1 << 10)->Arg(1 << 14);
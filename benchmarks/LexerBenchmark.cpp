@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "../src/lib/Keywords.hpp"
+#include "../src/lib/Lexer.hpp"
+
+namespace {
+auto generateSource(std::size_t statements) -> std::string {
+  std::string source;
+  for (std::size_t i = 0; i < statements; ++i) {
+    auto n = std::to_string(i);
+    source += "var value_" + n + " = (" + n + " * 60 + 24) / 7.5;\n";
+    source += "print value_" + n + " >= 100 ? \"big\" : \"small\";\n";
+    source += "{ var tmp = value_" + n + "; tmp = tmp - 1, !nil; }\n";
+  }
+  return source;
+}
+
+auto generateCommentedSource(std::size_t statements) -> std::string {
+  std::string source;
+  for (std::size_t i = 0; i < statements; ++i) {
+    auto n = std::to_string(i);
+    source += "/*\n * generated block " + n + "\n *" +
+              std::string(120, ' ') + "\n */\n";
+    source += "// " + std::string(100, '-') + "\n";
+    source += "print \"" + std::string(200, 'x') + "\\n line " + n + "\";\n";
+  }
+  return source;
+}
+
+auto generateIdentifiers(std::size_t statements) -> std::string {
+  std::string source;
+  for (std::size_t i = 0; i < statements; ++i) {
+    auto n = std::to_string(i);
+    source += "var while_" + n + " = this_value and fun_count or nil;\n";
+    source += "print classes, returned, superb, truth, variable, forty;\n";
+  }
+  return source;
+}
+
+// the keyword recognizer Keywords::lookup replaced, kept as a reference point
+auto lookupChain(std::string_view lexeme) -> TokenType {
+  constexpr std::array<std::pair<std::string_view, TokenType>, 16> keywords{{
+      {"and", TokenType::TOKEN_AND},       {"class", TokenType::TOKEN_CLASS},
+      {"else", TokenType::TOKEN_ELSE},     {"false", TokenType::TOKEN_FALSE},
+      {"fun", TokenType::TOKEN_FUN},       {"for", TokenType::TOKEN_FOR},
+      {"if", TokenType::TOKEN_IF},         {"nil", TokenType::TOKEN_NIL},
+      {"or", TokenType::TOKEN_OR},         {"print", TokenType::TOKEN_PRINT},
+      {"return", TokenType::TOKEN_RETURN}, {"super", TokenType::TOKEN_SUPER},
+      {"this", TokenType::TOKEN_THIS},     {"true", TokenType::TOKEN_TRUE},
+      {"var", TokenType::TOKEN_VAR},       {"while", TokenType::TOKEN_WHILE},
+  }};
+  for (auto const &[spelling, type] : keywords) {
+    if (lexeme == spelling) {
+      return type;
+    }
+  }
+  return TokenType::TOKEN_IDENTIFIER;
+}
+
+constexpr std::array<std::string_view, 16> lexemes{
+    "value",  "while", "counter", "total", "print", "index", "this", "tmp",
+    "result", "super", "items",   "fun",   "name",  "thing", "or",   "x"};
+
+template <auto Lookup>
+void runLookup(benchmark::State &state) {
+  for (auto _ : state) {
+    for (auto lexeme : lexemes) {
+      benchmark::DoNotOptimize(lexeme);
+      benchmark::DoNotOptimize(Lookup(lexeme));
+    }
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() *
+                                                    lexemes.size()));
+}
+
+void runLexer(benchmark::State &state, std::string const &source) {
+  std::size_t tokens = 0;
+
+  for (auto _ : state) {
+    ErrorReporter err;
+    SymbolTable symbols;
+    Lexer lexer{source, err, symbols};
+    auto result = lexer.scanTokens();
+    tokens = result.value().get().size();
+    benchmark::DoNotOptimize(tokens);
+  }
+
+  state.counters["tokens/s"] =
+      benchmark::Counter(static_cast<double>(tokens),
+                         benchmark::Counter::kIsIterationInvariantRate);
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() *
+                                                    source.size()));
+}
+}  // namespace
+
+static void BM_LexerScanTokens(benchmark::State &state) {
+  runLexer(state, generateSource(state.range(0)));
+}
+BENCHMARK(BM_LexerScanTokens)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_LexerCommentsAndStrings(benchmark::State &state) {
+  runLexer(state, generateCommentedSource(state.range(0)));
+}
+BENCHMARK(BM_LexerCommentsAndStrings)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_LexerIdentifiers(benchmark::State &state) {
+  runLexer(state, generateIdentifiers(state.range(0)));
+}
+BENCHMARK(BM_LexerIdentifiers)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_KeywordLookupChain(benchmark::State &state) {
+  runLookup<lookupChain>(state);
+}
+BENCHMARK(BM_KeywordLookupChain);
+
+static void BM_KeywordLookupPerfectHash(benchmark::State &state) {
+  runLookup<Keywords::lookup>(state);
+}
+BENCHMARK(BM_KeywordLookupPerfectHash);
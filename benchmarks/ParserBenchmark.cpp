@@ -0,0 +1,62 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "../src/lib/Lexer.hpp"
+#include "../src/lib/Parser.hpp"
+
+namespace {
+auto generateSource(std::size_t statements) -> std::string {
+  std::string source;
+  for (std::size_t i = 0; i < statements; ++i) {
+    auto n = std::to_string(i);
+    source += "var value_" + n + " = (" + n + " * 60 + 24) / 7.5;\n";
+    source += "print value_" + n + " >= 100 ? \"big\" : \"small\";\n";
+    source += "{ var tmp = value_" + n + "; tmp = tmp - 1, !nil; }\n";
+  }
+  return source;
+}
+
+auto generateChain(std::size_t terms, std::string_view op) -> std::string {
+  std::string source = "print 0";
+  for (std::size_t i = 1; i < terms; ++i) {
+    source += op;
+    source += std::to_string(i % 10);
+  }
+  return source + ";\n";
+}
+
+void runParser(benchmark::State &state, std::string const &source) {
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer lexer{source, err, symbols};
+  auto const &tokens = lexer.scanTokens().value().get();
+
+  for (auto _ : state) {
+    Parser parser{tokens, err, symbols};
+    auto program = parser.parse();
+    benchmark::DoNotOptimize(program);
+  }
+
+  state.counters["tokens/s"] =
+      benchmark::Counter(static_cast<double>(tokens.size()),
+                         benchmark::Counter::kIsIterationInvariantRate);
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() *
+                                                    source.size()));
+}
+}  // namespace
+
+static void BM_ParserStatements(benchmark::State &state) {
+  runParser(state, generateSource(state.range(0)));
+}
+BENCHMARK(BM_ParserStatements)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_ParserOperatorChain(benchmark::State &state) {
+  runParser(state, generateChain(state.range(0), " + "));
+}
+BENCHMARK(BM_ParserOperatorChain)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_ParserCommaList(benchmark::State &state) {
+  runParser(state, generateChain(state.range(0), ", "));
+}
+BENCHMARK(BM_ParserCommaList)->Arg(1 << 10)->Arg(1 << 14);
@@ -3,9 +3,13 @@ set(CMAKE_MODULE_PATH "${CMAKE_SOURCE_DIR}/externals/sanitizers-cmake/cmake"
 find_package(Sanitizers)
 
 find_package(gtest CONFIG REQUIRED)
+if(BUILD_BENCHMARKS)
+  find_package(benchmark CONFIG REQUIRED)
+endif()
 
 find_package(fmt CONFIG REQUIRED)
 find_package(range-v3 CONFIG REQUIRED)
+find_package(Threads REQUIRED)
 
 find_path(READLINE_INCLUDE_DIR readline/readline.h)
 find_path(NCURSES_INCLUDE_DIR ncurses/curses.h)
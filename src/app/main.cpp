@@ -1,41 +1,168 @@
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sysexits.h>
 #include <unistd.h>
 
+#include <cerrno>
+#include <chrono>
 #include <cstdint>
+#include <filesystem>
 #include <iostream>
+#include <optional>
 #include <span>
+#include <string_view>
 
 #include "../../include/config.hpp"
 #include "../lib/Lox.hpp"
+#include "../lib/ProgramCache.hpp"
+#include "../lib/SourceStream.hpp"
 #include "ReadLine.hpp"
 
-auto runFile(std::string_view path) -> int {
-  auto fd = open(path.data(), O_RDONLY);
+struct Options {
+  // back the mapping of the source with huge pages where supported
+  bool huge_pages = false;
+  // run the standard passes of the PassManager before the programs
+  bool optimize = true;
+  // compute the common subexpressions of an expression once
+  bool share_subexpressions = false;
+  // compile the programs to bytecode and run them on the virtual machine
+  bool virtual_machine = false;
+  // keep the parsed programs of files in a .loxc directory next to them
+  bool cache = true;
+  // print the time and the nodes removed of every pass on stderr
+  bool pass_stats = false;
+  std::optional<std::string_view> path;
+};
+
+void printError(std::string_view error) { std::cerr << error << std::endl; }
+
+void setPasses(Lox &lox, Options const &options) {
+  lox.setOptimizing(options.optimize);
+  lox.getPasses().setCounting(options.pass_stats);
+  lox.setSubexpressionSharing(options.share_subexpressions);
+  lox.setBackend(options.virtual_machine ? Lox::Backend::VIRTUAL_MACHINE
+                                         : Lox::Backend::INTERPRETER);
+}
+
+void printPassReports(Lox &lox, Options const &options) {
+  if (!options.pass_stats) {
+    return;
+  }
+  for (auto const &report : lox.getPasses().getReports()) {
+    std::cerr << report.name << ": "
+              << std::chrono::duration<double, std::milli>(report.time).count()
+              << " ms, " << report.removed << " nodes removed" << std::endl;
+  }
+}
+
+// drops the whole pages of [offset, offset + size) from the mapping, they are
+// read again from the file if the parser or an error message needs them
+void releasePages(void *map, std::size_t offset, std::size_t size) {
+  static auto const page_size =
+      static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  auto begin = (offset + page_size - 1) / page_size * page_size;
+  auto end = (offset + size) / page_size * page_size;
+  if (end > begin) {
+    madvise(static_cast<char *>(map) + begin, end - begin, MADV_DONTNEED);
+  }
+}
+
+auto runStream(int fd, Options const &options) -> int {
+  SourceStream stream{[fd](char *buffer, std::size_t size) -> std::ptrdiff_t {
+    while (true) {
+      auto count = read(fd, buffer, size);
+      if (count >= 0 || errno != EINTR) {
+        return count;
+      }
+    }
+  }};
+
+  Lox lox;
+  setPasses(lox, options);
+  for (auto declaration = stream.next(); declaration.has_value();
+       declaration = stream.next()) {
+    auto result = lox.run(declaration.value(), stream.getLine(),
+                          stream.getLinePrefix());
+
+    if (lox.hasErrors()) {
+      printPassReports(lox, options);
+      lox.reportErrors(printError);
+      return EX_SOFTWARE;
+    }
+    if (result.has_value()) {
+      for (auto const &v : result.value()) {
+        std::cout << v << '\n';
+      }
+    }
+  }
+  std::cout.flush();
+  printPassReports(lox, options);
+
+  if (stream.hasFailed()) {
+    std::cerr << "Failed to read input" << std::endl;
+    return EX_IOERR;
+  }
+  return 0;
+}
+
+auto runFile(std::string_view path, Options const &options) -> int {
+  auto fd = path == "-" ? STDIN_FILENO : open(path.data(), O_RDONLY);
   if (fd == -1) {
     std::cerr << "Failed to open file " << path << '\n';
     return EX_NOINPUT;
   }
 
-  auto file_size = lseek(fd, 0, SEEK_END);
+  // pipes, FIFOs and terminals can not be mapped, run them as a stream
+  struct stat file_stat {};
+  if (fstat(fd, &file_stat) == -1 || !S_ISREG(file_stat.st_mode)) {
+    auto exit_code = runStream(fd, options);
+    if (fd != STDIN_FILENO) {
+      close(fd);
+    }
+    return exit_code;
+  }
+
+  auto file_size = file_stat.st_size;
   auto *map = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
   if (map == MAP_FAILED) {
     std::cerr << "Failed to map file " << path << '\n';
-    close(fd);
+    if (fd != STDIN_FILENO) {
+      close(fd);
+    }
     return EX_NOINPUT;
   }
 
   std::string_view source(reinterpret_cast<const char *>(map), file_size);
 
+  // the source is read once from start to end: read ahead, and release the
+  // pages behind the lexer so large inputs do not stay resident
+  madvise(map, file_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+  if (options.huge_pages) {
+    madvise(map, file_size, MADV_HUGEPAGE);
+  }
+#endif
+
   Lox lox;
+  setPasses(lox, options);
+  // a redirected stdin has no directory to keep its entry in
+  if (options.cache && path != "-") {
+    std::filesystem::path script{path};
+    lox.setProgramCache(ProgramCache{script.parent_path() / ".loxc",
+                                     script.filename().string(), PROJECT_VER});
+  }
+  if (source.size() >= Lexer::progress_step) {
+    lox.setLexerProgress([map](std::size_t offset, std::size_t size) {
+      releasePages(map, offset, size);
+    });
+  }
   auto result = lox.run(source);
   std::uint16_t exit_code = 0;
+  printPassReports(lox, options);
 
   if (lox.hasErrors()) {
-    for (auto const &error : lox.getErrors()) {
-      std::cerr << error << std::endl;
-    }
+    lox.reportErrors(printError);
     exit_code = EX_SOFTWARE;
   } else if (result.has_value()) {
     for (auto const &v : result.value()) {
@@ -44,16 +171,19 @@ auto runFile(std::string_view path) -> int {
   }
 
   munmap(map, file_size);
-  close(fd);
+  if (fd != STDIN_FILENO) {
+    close(fd);
+  }
 
   return exit_code;
 }
 
-auto runRepl() -> int {
+auto runRepl(Options const &options) -> int {
   std::cout << "cpplox: Lox interpreter - v" << PROJECT_VER << std::endl;
   std::cout << "To exit, press Ctrl+d or type \"exit\"" << std::endl;
 
   Lox lox;
+  setPasses(lox, options);
   ReadLine readline{">> "};
   while (true) {
     auto line = readline.getLine();
@@ -74,9 +204,7 @@ auto runRepl() -> int {
     auto result = lox.run(line.value());
 
     if (lox.hasErrors()) {
-      for (auto const &error : lox.getErrors()) {
-        std::cerr << error << std::endl;
-      }
+      lox.reportErrors(printError);
     } else if (result.has_value()) {
       for (auto const &v : result.value()) {
         std::cout << v << std::endl;
@@ -88,12 +216,36 @@ auto runRepl() -> int {
 auto main(int argc, char **argv) -> int {
   std::span const args(argv, argc);
 
-  if (argc > 2) {
-    std::cerr << "Usage: " << args.front() << " [filename]" << std::endl;
-    return EX_USAGE;
+  Options options;
+  for (std::string_view arg : args.subspan(1)) {
+    if (arg == "--huge-pages") {
+      options.huge_pages = true;
+    } else if (arg == "--no-opt") {
+      options.optimize = false;
+    } else if (arg == "--cse") {
+      options.share_subexpressions = true;
+    } else if (arg == "--vm") {
+      options.virtual_machine = true;
+    } else if (arg == "--no-cache") {
+      options.cache = false;
+    } else if (arg == "--pass-stats") {
+      options.pass_stats = true;
+    } else if (!options.path.has_value()) {
+      options.path = arg;
+    } else {
+      std::cerr << "Usage: " << args.front()
+                << " [--huge-pages] [--no-opt] [--cse] [--vm]"
+                   " [--no-cache] [--pass-stats] [filename]"
+                << std::endl;
+      return EX_USAGE;
+    }
+  }
+
+  if (options.path.has_value()) {
+    return runFile(options.path.value(), options);
   }
-  if (argc == 2) {
-    return runFile(args.back());
+  if (isatty(STDIN_FILENO) == 0) {
+    return runFile("-", options);
   }
-  return runRepl();
+  return runRepl(options);
 }
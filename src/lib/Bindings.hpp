@@ -0,0 +1,125 @@
+#ifndef CPPLOX_BINDINGS_HPP
+#define CPPLOX_BINDINGS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "Scopes.hpp"
+#include "SymbolTable.hpp"
+
+/*
+What a pass knows about the value of the variables of the program it walks in
+the order it runs, Value{} when it knows nothing. The changes made in the
+branches of a ternary are undone at the end of the branch, and the values after
+the ternary are those both branches agree on according to Same.
+*/
+template <typename Value, typename Same = std::equal_to<Value> >
+class Bindings {
+  struct Change {
+    Value *binding;
+    Value previous;
+  };
+
+  Scopes<Value> m_scopes;
+  // journal of the changes, kept while a ternary is walked
+  std::vector<Change> m_changes;
+  // start of the changes of the branch of every ternary being walked
+  std::vector<std::size_t> m_branches;
+  // values at the end of the true branches of the ternaries being walked
+  std::vector<std::pair<Value *, Value> > m_true_values;
+  std::vector<std::size_t> m_true_starts;
+
+ public:
+  void push() { m_scopes.push(); }
+  void pop() { m_scopes.pop(); }
+
+  void declare(SymbolTable::Symbol symbol, Value value) {
+    m_scopes.declare(symbol, std::move(value));
+  }
+
+  auto find(SymbolTable::Symbol symbol) -> Value const * {
+    return m_scopes.find(symbol);
+  }
+
+  void assign(SymbolTable::Symbol symbol, Value value) {
+    auto *binding = m_scopes.find(symbol);
+    if (binding != nullptr) {
+      set(binding, std::move(value));
+    }
+  }
+
+  void enterTrueBranch() {
+    m_branches.push_back(m_changes.size());
+    m_true_starts.push_back(m_true_values.size());
+  }
+
+  void enterFalseBranch() {
+    auto start = m_branches.back();
+    for (auto i = start; i < m_changes.size(); ++i) {
+      auto *binding = m_changes[i].binding;
+      m_true_values.emplace_back(binding, *binding);
+    }
+    undo(start);
+  }
+
+  void leaveTernary() {
+    auto start = m_branches.back();
+    auto true_start = m_true_starts.back();
+    auto true_values = std::span{m_true_values}.subspan(true_start);
+
+    std::vector<std::pair<Value *, Value> > merged;
+    for (auto const &[binding, value] : true_values) {
+      merged.emplace_back(binding, isSame(value, *binding) ? value : Value{});
+    }
+    // the bindings only the false branch changed are compared to their value
+    // before the ternary, once it is restored
+    std::vector<std::pair<Value *, Value> > false_values;
+    for (auto i = start; i < m_changes.size(); ++i) {
+      auto *binding = m_changes[i].binding;
+      auto in_true = std::find_if(true_values.begin(), true_values.end(),
+                                  [binding](auto const &value) {
+                                    return value.first == binding;
+                                  });
+      if (in_true == true_values.end()) {
+        false_values.emplace_back(binding, *binding);
+      }
+    }
+    undo(start);
+    for (auto const &[binding, value] : false_values) {
+      merged.emplace_back(binding, isSame(value, *binding) ? value : Value{});
+    }
+
+    m_branches.pop_back();
+    m_true_values.resize(true_start);
+    m_true_starts.pop_back();
+    for (auto &[binding, value] : merged) {
+      set(binding, std::move(value));
+    }
+  }
+
+ private:
+  void set(Value *binding, Value value) {
+    if (!m_branches.empty()) {
+      m_changes.push_back({binding, *binding});
+    }
+    *binding = std::move(value);
+  }
+
+  // restores the bindings changed since the start-th change
+  void undo(std::size_t start) {
+    while (m_changes.size() > start) {
+      *m_changes.back().binding = std::move(m_changes.back().previous);
+      m_changes.pop_back();
+    }
+  }
+
+  static auto isSame(Value const &left, Value const &right) -> bool {
+    return Same{}(left, right);
+  }
+};
+
+#endif /* CPPLOX_BINDINGS_HPP */
@@ -0,0 +1,553 @@
+#include "Bytecode.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "StatementWalker.hpp"
+
+namespace {
+// values an instruction pops and pushes, the jumps leave the stack as it is
+auto effect(Bytecode::OpCode code) -> std::pair<std::uint32_t, std::uint32_t> {
+  using enum Bytecode::OpCode;
+  switch (code) {
+    case NUMBER:
+    case STRING:
+    case TRUE:
+    case FALSE:
+    case NIL:
+    case GET_GLOBAL:
+    case GET_LOCAL:
+      return {0, 1};
+    case SET_GLOBAL:
+    case SET_LOCAL:
+    case NEGATE:
+    case NOT:
+      return {1, 1};
+    case STORE_GLOBAL:
+    case DEFINE_GLOBAL:
+    case STORE_LOCAL:
+    case POP:
+    case PRINT:
+    case JUMP_IF_FALSE:
+      return {1, 0};
+    case DECLARE_GLOBAL:
+    case DECLARE_LOCAL:
+    case JUMP:
+    case RETURN:
+      return {0, 0};
+    default:
+      return {2, 1};
+  }
+}
+}  // namespace
+
+// emits the instruction of every node once its operands were emitted, and the
+// jumps of the ternaries and the pop of the comma between their operands
+struct Bytecode::Emitter {
+  // of the expressions emitted by native recursion, the walker costs more
+  // than emitting most of them
+  static constexpr unsigned max_depth = 128;
+
+  Bytecode &m_code;
+
+  // emits the nodes of expr deeper than max_depth with the walker
+  void emit(Expression const &expr, unsigned depth) {
+    if (depth == max_depth) {
+      m_code.m_walker.walk(expr, *this);
+      return;
+    }
+    std::visit([this, depth](auto const &e) { descend(e, depth + 1); }, expr);
+  }
+  void descend(Node<GroupingExpression> const &e, unsigned depth) {
+    emit(e->getExpression(), depth);
+  }
+  void descend(Node<TernaryExpression> const &e, unsigned depth) {
+    emit(e->getConditionExpression(), depth);
+    trueBranch();
+    emit(e->getTrueExpression(), depth);
+    falseBranch();
+    emit(e->getFalseExpression(), depth);
+    (*this)(e);
+  }
+  void descend(Node<AssignExpression> const &e, unsigned depth) {
+    emit(e->getValue(), depth);
+    (*this)(e);
+  }
+  template <TokenType type>
+  void descend(Node<UnaryExpression<type> > const &e, unsigned depth) {
+    emit(e->getExpression(), depth);
+    (*this)(e);
+  }
+  template <TokenType type>
+  void descend(Node<BinaryExpression<type> > const &e, unsigned depth) {
+    emit(e->getLeftExpression(), depth);
+    if (type == TokenType::TOKEN_COMMA) {
+      m_code.emit(OpCode::POP, -1);
+    }
+    emit(e->getRightExpression(), depth);
+    (*this)(e);
+  }
+  template <typename T>
+  void descend(T const &e, [[maybe_unused]] unsigned depth) {
+    (*this)(e);
+  }
+
+  void next(Expression const &expr, std::uint8_t operand) {
+    if (std::holds_alternative<Node<TernaryExpression> >(expr)) {
+      if (operand == 1) {
+        trueBranch();
+      } else {
+        falseBranch();
+      }
+    } else if (std::holds_alternative<
+                   Node<BinaryExpression<TokenType::TOKEN_COMMA> > >(expr)) {
+      m_code.emit(OpCode::POP, -1);
+    }
+  }
+  void leave(Expression const &expr) { std::visit(*this, expr); }
+
+  void trueBranch() {
+    m_code.m_jumps.push_back(m_code.jump(OpCode::JUMP_IF_FALSE, -1));
+  }
+  // the false branch starts from the depth the true one started from
+  void falseBranch() {
+    auto jump_if_false = m_code.m_jumps.back();
+    m_code.m_jumps.back() = m_code.jump(OpCode::JUMP, -1);
+    m_code.patch(jump_if_false);
+  }
+
+  void operator()(Node<LiteralNumberExpression> const &e) {
+    m_code.emit(OpCode::NUMBER, 1, add(m_code.m_numbers, e->getValue()));
+  }
+  void operator()(Node<LiteralStringExpression> const &e) {
+    m_code.emit(OpCode::STRING, 1, add(m_code.m_strings, e->getValue()));
+  }
+  void operator()(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_TRUE> > const
+          &e) {
+    m_code.emit(OpCode::TRUE, 1);
+  }
+  void operator()(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_FALSE> > const
+          &e) {
+    m_code.emit(OpCode::FALSE, 1);
+  }
+  void operator()(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_NIL> > const
+          &e) {
+    m_code.emit(OpCode::NIL, 1);
+  }
+  void operator()(Node<VariableExpression> const &e) {
+    site(e);
+    auto symbol = e->getSymbol();
+    auto const *local = m_code.local(symbol);
+    if (local != nullptr) {
+      m_code.emit(OpCode::GET_LOCAL, 1, *local);
+    } else {
+      m_code.emit(OpCode::GET_GLOBAL, 1, m_code.global(symbol));
+    }
+  }
+  void operator()([[maybe_unused]] Node<GroupingExpression> const &e) {}
+  void operator()([[maybe_unused]] Node<TernaryExpression> const &e) {
+    m_code.patch(m_code.m_jumps.back());
+    m_code.m_jumps.pop_back();
+  }
+  void operator()(Node<AssignExpression> const &e) {
+    auto symbol = e->getSymbol();
+    auto const *local = m_code.local(symbol);
+    if (local != nullptr) {
+      m_code.emit(OpCode::SET_LOCAL, 0, *local);
+      return;
+    }
+    site(e);
+    m_code.emit(OpCode::SET_GLOBAL, 0, m_code.global(symbol));
+  }
+  template <TokenType type>
+  void operator()(Node<UnaryExpression<type> > const &e) {
+    if (type == TokenType::TOKEN_MINUS) {
+      site(e);
+      m_code.emit(OpCode::NEGATE, 0);
+    } else {
+      m_code.emit(OpCode::NOT, 0);
+    }
+  }
+  void operator()(
+      [[maybe_unused]] Node<BinaryExpression<TokenType::TOKEN_COMMA> > const
+          &e) {}
+  template <TokenType type>
+  void operator()(Node<BinaryExpression<type> > const &e) {
+    site(e);
+    m_code.emit(code<type>(e->getOperandTypes()), -1);
+  }
+
+  // e is the source of the instruction about to be emitted, which can fail
+  template <typename T>
+  void site(Node<T> const &e) {
+    if (m_code.m_locating != m_code.m_code.size()) {
+      return;
+    }
+    if constexpr (requires { e->getIdentifier(); }) {
+      m_code.m_site = {e->getIdentifier().getPosition(), e->getName()};
+    } else {
+      m_code.m_site = {e->getOperator(), {}};
+    }
+  }
+
+  template <TokenType type>
+  static constexpr auto code() -> OpCode {
+    switch (type) {
+      case TokenType::TOKEN_EQUAL_EQUAL:
+        return OpCode::EQUAL;
+      case TokenType::TOKEN_BANG_EQUAL:
+        return OpCode::NOT_EQUAL;
+      case TokenType::TOKEN_LESS:
+        return OpCode::LESS;
+      case TokenType::TOKEN_LESS_EQUAL:
+        return OpCode::LESS_EQUAL;
+      case TokenType::TOKEN_GREATER:
+        return OpCode::GREATER;
+      case TokenType::TOKEN_GREATER_EQUAL:
+        return OpCode::GREATER_EQUAL;
+      case TokenType::TOKEN_PLUS:
+        return OpCode::ADD;
+      case TokenType::TOKEN_MINUS:
+        return OpCode::SUBTRACT;
+      case TokenType::TOKEN_STAR:
+        return OpCode::MULTIPLY;
+      default:
+        return OpCode::DIVIDE;
+    }
+  }
+
+  template <TokenType type>
+  static constexpr auto code(OperandTypes operands) -> OpCode {
+    if (operands == OperandTypes::NUMBERS) {
+      switch (type) {
+        case TokenType::TOKEN_EQUAL_EQUAL:
+          return OpCode::EQUAL_NUMBERS;
+        case TokenType::TOKEN_BANG_EQUAL:
+          return OpCode::NOT_EQUAL_NUMBERS;
+        case TokenType::TOKEN_LESS:
+          return OpCode::LESS_NUMBERS;
+        case TokenType::TOKEN_LESS_EQUAL:
+          return OpCode::LESS_EQUAL_NUMBERS;
+        case TokenType::TOKEN_GREATER:
+          return OpCode::GREATER_NUMBERS;
+        case TokenType::TOKEN_GREATER_EQUAL:
+          return OpCode::GREATER_EQUAL_NUMBERS;
+        case TokenType::TOKEN_PLUS:
+          return OpCode::ADD_NUMBERS;
+        case TokenType::TOKEN_MINUS:
+          return OpCode::SUBTRACT_NUMBERS;
+        case TokenType::TOKEN_STAR:
+          return OpCode::MULTIPLY_NUMBERS;
+        default:
+          return OpCode::DIVIDE_NUMBERS;
+      }
+    }
+    if (operands == OperandTypes::STRINGS) {
+      switch (type) {
+        case TokenType::TOKEN_EQUAL_EQUAL:
+          return OpCode::EQUAL_STRINGS;
+        case TokenType::TOKEN_BANG_EQUAL:
+          return OpCode::NOT_EQUAL_STRINGS;
+        case TokenType::TOKEN_PLUS:
+          return OpCode::ADD_STRINGS;
+        default:
+          break;
+      }
+    }
+    return code<type>();
+  }
+};
+
+struct Bytecode::StatementCompiler {
+  Bytecode &m_code;
+  // first slot of the locals of each block being compiled
+  std::vector<std::uint32_t> m_starts;
+
+  void operator()(Node<PrintStatement> const &s) {
+    m_code.expression(s->getExpression());
+    m_code.emit(OpCode::PRINT, -1);
+  }
+
+  void operator()(Node<ExpressionStatement> const &s) {
+    auto const &expr = s->getExpression();
+    m_code.expression(expr);
+    if (std::holds_alternative<Node<AssignExpression> >(expr)) {
+      m_code.store();
+    } else {
+      m_code.emit(OpCode::POP, -1);
+    }
+  }
+
+  // the initializer is compiled before the variable is declared, it reads the
+  // variables the name had before
+  void operator()(Node<VariableDeclaration> const &s) {
+    auto const &initializer = s->getInitializer();
+    if (initializer.has_value()) {
+      m_code.expression(initializer.value());
+    }
+    auto &scopes = m_code.m_scopes;
+    if (scopes.isTopLevel()) {
+      auto index = m_code.global(s->getSymbol());
+      if (initializer.has_value()) {
+        m_code.emit(OpCode::DEFINE_GLOBAL, -1, index);
+      } else {
+        m_code.emit(OpCode::DECLARE_GLOBAL, 0, index);
+      }
+      return;
+    }
+    auto const *declared = scopes.findInScope(s->getSymbol());
+    auto slot = declared != nullptr
+                    ? *declared
+                    : scopes.declare(s->getSymbol(), m_code.m_next_local++);
+    m_code.m_locals = std::max(m_code.m_locals, m_code.m_next_local);
+    if (initializer.has_value()) {
+      m_code.emit(OpCode::STORE_LOCAL, -1, slot);
+    } else {
+      m_code.emit(OpCode::DECLARE_LOCAL, 0, slot);
+    }
+  }
+
+  void enterBlock([[maybe_unused]] Node<BlockStatement> const &s) {
+    m_starts.push_back(m_code.m_next_local);
+    m_code.m_scopes.push();
+  }
+  void leaveBlock([[maybe_unused]] Node<BlockStatement> const &s) {
+    m_code.m_scopes.pop();
+    m_code.m_next_local = m_starts.back();
+    m_starts.pop_back();
+  }
+};
+
+void Bytecode::compile(std::span<Statement const> statements) {
+  m_code.clear();
+  m_numbers.clear();
+  m_strings.clear();
+  for (auto symbol : m_globals) {
+    m_global_indices[symbol] = 0;
+  }
+  m_globals.clear();
+  m_locals = 0;
+  m_stack_size = 0;
+  m_depth = 0;
+
+  StatementCompiler compiler{*this, {}};
+  StatementWalker walker;
+  walker.walk(statements, compiler);
+  emit(OpCode::RETURN, 0);
+}
+
+auto Bytecode::locate(std::span<Statement const> statements,
+                      std::uint32_t offset) -> Site {
+  Bytecode code;
+  code.m_locating = offset;
+  code.compile(statements);
+  return code.m_site;
+}
+
+auto Bytecode::load(std::vector<std::uint8_t> code,
+                    std::vector<double> numbers,
+                    std::vector<std::string_view> strings,
+                    std::vector<SymbolTable::Symbol> globals,
+                    std::uint32_t locals) -> std::optional<Bytecode> {
+  Bytecode bytecode;
+  bytecode.m_code = std::move(code);
+  bytecode.m_numbers = std::move(numbers);
+  bytecode.m_strings = std::move(strings);
+  bytecode.m_globals = std::move(globals);
+  bytecode.m_locals = locals;
+  if (!bytecode.verify()) {
+    return std::nullopt;
+  }
+  return bytecode;
+}
+
+auto Bytecode::hasOperand(OpCode code) -> bool {
+  using enum OpCode;
+  switch (code) {
+    case NUMBER:
+    case STRING:
+    case GET_GLOBAL:
+    case SET_GLOBAL:
+    case STORE_GLOBAL:
+    case DEFINE_GLOBAL:
+    case DECLARE_GLOBAL:
+    case GET_LOCAL:
+    case SET_LOCAL:
+    case STORE_LOCAL:
+    case DECLARE_LOCAL:
+    case JUMP_IF_FALSE:
+    case JUMP:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// the jumps only land forward, the depth of the stack where they land is known
+// before the instructions there are reached by falling through. Those that
+// follow a JUMP are only reached by the jumps that land on them.
+auto Bytecode::verify() -> bool {
+  // depth of the stack where the pending jumps land
+  std::map<std::uint32_t, std::uint32_t> targets;
+  std::uint32_t depth = 0;
+  bool reached = true;
+  m_stack_size = 0;
+  std::size_t offset = 0;
+  while (offset < m_code.size()) {
+    if (!targets.empty() && targets.begin()->first <= offset) {
+      auto [target, expected] = *targets.begin();
+      if (target < offset || (reached && depth != expected)) {
+        return false;
+      }
+      depth = expected;
+      reached = true;
+      targets.erase(targets.begin());
+    }
+    if (m_code[offset] > static_cast<std::uint8_t>(OpCode::RETURN)) {
+      return false;
+    }
+    auto code = static_cast<OpCode>(m_code[offset++]);
+    std::uint32_t operand = 0;
+    if (hasOperand(code)) {
+      if (m_code.size() - offset < sizeof(operand)) {
+        return false;
+      }
+      std::memcpy(&operand, &m_code[offset], sizeof(operand));
+      offset += sizeof(operand);
+    }
+    auto [pops, pushes] = effect(code);
+    if (depth < pops) {
+      return false;
+    }
+    depth += pushes - pops;
+    m_stack_size = std::max(m_stack_size, depth);
+
+    using enum OpCode;
+    switch (code) {
+      case NUMBER:
+        if (operand >= m_numbers.size()) {
+          return false;
+        }
+        break;
+      case STRING:
+        if (operand >= m_strings.size()) {
+          return false;
+        }
+        break;
+      case GET_GLOBAL:
+      case SET_GLOBAL:
+      case STORE_GLOBAL:
+      case DEFINE_GLOBAL:
+      case DECLARE_GLOBAL:
+        if (operand >= m_globals.size()) {
+          return false;
+        }
+        break;
+      case GET_LOCAL:
+      case SET_LOCAL:
+      case STORE_LOCAL:
+      case DECLARE_LOCAL:
+        if (operand >= m_locals) {
+          return false;
+        }
+        break;
+      case JUMP_IF_FALSE:
+      case JUMP:
+        if (operand < offset || operand >= m_code.size() ||
+            targets.try_emplace(operand, depth).first->second != depth) {
+          return false;
+        }
+        if (code == JUMP) {
+          reached = false;
+        }
+        break;
+      case RETURN:
+        reached = false;
+        break;
+      default:
+        break;
+    }
+  }
+  return !reached && targets.empty();
+}
+
+void Bytecode::expression(Expression const &expr) {
+  Emitter emitter{*this};
+  emitter.emit(expr, 0);
+}
+
+void Bytecode::emit(OpCode code, int depth) {
+  m_code.push_back(static_cast<std::uint8_t>(code));
+  m_depth += depth;
+  m_stack_size = std::max(m_stack_size, m_depth);
+}
+
+void Bytecode::emit(OpCode code, int depth, std::uint32_t operand) {
+  m_depth += depth;
+  m_stack_size = std::max(m_stack_size, m_depth);
+  // inserted at once, the code grows by pushing whole instructions
+  std::array<std::uint8_t, 1 + sizeof(operand)> bytes{
+      static_cast<std::uint8_t>(code)};
+  std::memcpy(&bytes[1], &operand, sizeof(operand));
+  m_code.insert(m_code.end(), bytes.begin(), bytes.end());
+}
+
+template <typename T>
+auto Bytecode::add(std::vector<T> &pool, T value) -> std::uint32_t {
+  pool.push_back(value);
+  return static_cast<std::uint32_t>(pool.size() - 1);
+}
+
+// the assignment is the root of the expression of a statement, its
+// instruction is the last one and no jump lands after it
+void Bytecode::store() {
+  auto &code = m_code.end()[-1 - static_cast<int>(sizeof(std::uint32_t))];
+  code = static_cast<std::uint8_t>(
+      code == static_cast<std::uint8_t>(OpCode::SET_GLOBAL)
+          ? OpCode::STORE_GLOBAL
+          : OpCode::STORE_LOCAL);
+  --m_depth;
+}
+
+// the variables of the top level are not declared in the scopes, and a block
+// does not see those of the blocks around it
+auto Bytecode::local(SymbolTable::Symbol symbol) -> std::uint32_t const * {
+  return m_scopes.isTopLevel() ? nullptr : m_scopes.findInScope(symbol);
+}
+
+auto Bytecode::global(SymbolTable::Symbol symbol) -> std::uint32_t {
+  if (symbol >= m_global_indices.size()) {
+    m_global_indices.resize(symbol + 1);
+  }
+  auto &index = m_global_indices[symbol];
+  if (index == 0) {
+    m_globals.push_back(symbol);
+    index = static_cast<std::uint32_t>(m_globals.size());
+  }
+  return index - 1;
+}
+
+auto Bytecode::jump(OpCode code, int depth) -> std::uint32_t {
+  if (m_code.size() >= std::numeric_limits<std::uint32_t>::max()) {
+    throw std::length_error("Program too long");
+  }
+  auto offset = static_cast<std::uint32_t>(m_code.size());
+  emit(code, depth, 0);
+  return offset;
+}
+
+// the jump lands after the last instruction emitted
+void Bytecode::patch(std::uint32_t jump) {
+  auto target = static_cast<std::uint32_t>(m_code.size());
+  std::memcpy(&m_code[jump + 1], &target, sizeof(target));
+}
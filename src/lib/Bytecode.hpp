@@ -0,0 +1,188 @@
+#ifndef CPPLOX_BYTECODE_HPP
+#define CPPLOX_BYTECODE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "Expression.hpp"
+#include "ExpressionWalker.hpp"
+#include "Scopes.hpp"
+#include "SourcePosition.hpp"
+#include "Statement.hpp"
+#include "SymbolTable.hpp"
+
+/*
+The statements of a program compiled for the VirtualMachine: a byte per
+instruction code followed by its operand, if any, as 4 bytes in native byte
+order. The literals are loaded from the constant pools of the numbers and of
+the strings, by index.
+
+The variables are resolved as the Environments of the Interpreter would: a
+variable of a block is in a slot of the locals, once its declaration was
+compiled, and any other variable is global and looked up in the environment by
+its index in the globals. The locals of the blocks do not outlive them, the
+slots of a block are reused by the blocks that follow it.
+
+The source of the instructions that can fail is not kept: errors stop the
+program, the statements are compiled again to locate the one that failed. Code
+compiled by another run is loaded without its statements, see ProgramCache.
+*/
+class Bytecode {
+ public:
+  enum class OpCode : std::uint8_t {
+    // index in the numbers
+    NUMBER,
+    // index in the strings
+    STRING,
+    TRUE,
+    FALSE,
+    NIL,
+    // index in the globals
+    GET_GLOBAL,
+    SET_GLOBAL,
+    // pops the value, for the assignments whose value is not used
+    STORE_GLOBAL,
+    // pops the initializer
+    DEFINE_GLOBAL,
+    // declares the variable without initializing it
+    DECLARE_GLOBAL,
+    // slot of the local
+    GET_LOCAL,
+    SET_LOCAL,
+    // pops the value, or the initializer
+    STORE_LOCAL,
+    DECLARE_LOCAL,
+    NEGATE,
+    NOT,
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    // the operators whose operands the type inference proved to be numbers or
+    // strings, see Tape
+    EQUAL_NUMBERS,
+    NOT_EQUAL_NUMBERS,
+    LESS_NUMBERS,
+    LESS_EQUAL_NUMBERS,
+    GREATER_NUMBERS,
+    GREATER_EQUAL_NUMBERS,
+    ADD_NUMBERS,
+    SUBTRACT_NUMBERS,
+    MULTIPLY_NUMBERS,
+    DIVIDE_NUMBERS,
+    EQUAL_STRINGS,
+    NOT_EQUAL_STRINGS,
+    ADD_STRINGS,
+    POP,
+    PRINT,
+    // pops the condition, jumps to the offset when it is falsy
+    JUMP_IF_FALSE,
+    JUMP,
+    RETURN,
+  };
+
+  // where an instruction that can fail comes from
+  struct Site {
+    SourcePosition position;
+    // of the variable the instruction reads or writes, empty for operators
+    std::string_view name;
+  };
+
+ private:
+  std::vector<std::uint8_t> m_code;
+  std::vector<double> m_numbers;
+  // the literals of the program
+  std::vector<std::string_view> m_strings;
+  std::vector<SymbolTable::Symbol> m_globals;
+  std::uint32_t m_locals = 0;
+  // values on the stack at most
+  std::uint32_t m_stack_size = 0;
+
+  // index + 1 in the globals of every symbol, 0 when it has none
+  std::vector<std::uint32_t> m_global_indices;
+  // slots of the locals of the blocks being compiled
+  Scopes<std::uint32_t> m_scopes;
+  std::uint32_t m_next_local = 0;
+  ExpressionWalker m_walker;
+  // jumps waiting for the end of the branch they skip
+  std::vector<std::uint32_t> m_jumps;
+  std::uint32_t m_depth = 0;
+  // offset of the instruction whose site is searched, and its site once found
+  std::optional<std::uint32_t> m_locating;
+  Site m_site{{0, 0}, {}};
+
+ public:
+  // replaces the code by that of statements, the nodes of statements and the
+  // symbol table of their names must outlive the code
+  void compile(std::span<Statement const> statements);
+  // code compiled by another run, nullopt unless its operands are in the
+  // pools, its jumps land forward on an instruction, every path pops only the
+  // values it pushed and ends with RETURN. The proven operand types are
+  // trusted, as those of the statements are. The strings must outlive the code.
+  [[nodiscard]] static auto load(std::vector<std::uint8_t> code,
+                                 std::vector<double> numbers,
+                                 std::vector<std::string_view> strings,
+                                 std::vector<SymbolTable::Symbol> globals,
+                                 std::uint32_t locals)
+      -> std::optional<Bytecode>;
+  // the instruction is followed by a 4 bytes operand
+  [[nodiscard]] static auto hasOperand(OpCode code) -> bool;
+
+  [[nodiscard]] inline auto getCode() const -> std::span<std::uint8_t const> {
+    return m_code;
+  }
+  [[nodiscard]] inline auto getNumbers() const -> std::span<double const> {
+    return m_numbers;
+  }
+  [[nodiscard]] inline auto getStrings() const
+      -> std::span<std::string_view const> {
+    return m_strings;
+  }
+  [[nodiscard]] inline auto getGlobals() const
+      -> std::span<SymbolTable::Symbol const> {
+    return m_globals;
+  }
+  // number of slots the locals use
+  [[nodiscard]] inline auto getLocals() const -> std::uint32_t {
+    return m_locals;
+  }
+  [[nodiscard]] inline auto getStackSize() const -> std::uint32_t {
+    return m_stack_size;
+  }
+  // site of the instruction at offset in the code of statements, which can
+  // fail
+  [[nodiscard]] static auto locate(std::span<Statement const> statements,
+                                   std::uint32_t offset) -> Site;
+
+ private:
+  struct Emitter;
+  struct StatementCompiler;
+
+  void expression(Expression const &expr);
+  // checks the loaded code and sizes its stack
+  auto verify() -> bool;
+  // depth is the number of values the instruction pushes minus those it pops
+  void emit(OpCode code, int depth);
+  void emit(OpCode code, int depth, std::uint32_t operand);
+  // the assignment the code ends with pops its value
+  void store();
+  template <typename T>
+  static auto add(std::vector<T> &pool, T value) -> std::uint32_t;
+  // slot of the local symbol resolves to, nullptr when it is a global
+  auto local(SymbolTable::Symbol symbol) -> std::uint32_t const *;
+  auto global(SymbolTable::Symbol symbol) -> std::uint32_t;
+  // emits a jump and returns its offset, to patch its target
+  auto jump(OpCode code, int depth) -> std::uint32_t;
+  void patch(std::uint32_t jump);
+};
+
+#endif /* CPPLOX_BYTECODE_HPP */
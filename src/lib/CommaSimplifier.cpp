@@ -0,0 +1,192 @@
+#include "CommaSimplifier.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ExpressionRewriter.hpp"
+#include "Scopes.hpp"
+#include "StatementWalker.hpp"
+
+namespace {
+// whether the variables of the program are defined once declared
+using Definitions = Scopes<bool>;
+
+// rewrites the nodes in postorder, m_effect_free holds whether the rewritten
+// operands of a node have no effect along with them
+class ExpressionSimplifier : public ExpressionRewriter<ExpressionSimplifier> {
+  Definitions &m_definitions;
+  std::vector<bool> m_effect_free;
+
+ public:
+  using ExpressionRewriter::operator();
+
+  ExpressionSimplifier(Arena &arena, Definitions &definitions)
+      : ExpressionRewriter(arena), m_definitions(definitions) {}
+
+  // rewritten expr and whether it has no effect
+  auto simplify(Expression const &expr) -> std::pair<Expression, bool> {
+    auto rewritten = rewrite(expr);
+    auto effect_free = m_effect_free.back();
+    m_effect_free.pop_back();
+    return {std::move(rewritten), effect_free};
+  }
+
+  void leave(Expression const &expr) {
+    ExpressionRewriter::leave(expr);
+    std::visit([this](auto const &e) { leaveEffects(e); }, expr);
+  }
+
+  auto operator()(Node<BinaryExpression<TokenType::TOKEN_COMMA> > const &e)
+      -> Expression {
+    auto left_effect_free = m_effect_free.end()[-2];
+    if (left_effect_free) {
+      auto right = pop();
+      pop();
+      return right;
+    }
+    return ExpressionRewriter::operator()(e);
+  }
+
+ private:
+  void leaveEffects(Node<VariableExpression> const &e) {
+    auto const *defined = m_definitions.find(e->getSymbol());
+    m_effect_free.push_back(defined != nullptr && *defined);
+  }
+  void leaveEffects([[maybe_unused]] Node<GroupingExpression> const &e) {}
+  void leaveEffects([[maybe_unused]] Node<TernaryExpression> const &e) {
+    combine(3, true);
+  }
+  void leaveEffects([[maybe_unused]] Node<AssignExpression> const &e) {
+    combine(1, false);
+  }
+  void leaveEffects(
+      [[maybe_unused]] Node<UnaryExpression<TokenType::TOKEN_BANG> > const &e) {
+  }
+  void leaveEffects(
+      [[maybe_unused]] Node<UnaryExpression<TokenType::TOKEN_MINUS> > const
+          &e) {
+    combine(1, false);
+  }
+  template <TokenType type>
+  void leaveEffects([[maybe_unused]] Node<BinaryExpression<type> > const &e) {
+    // only the comma and the equalities never fail
+    combine(2, type == TokenType::TOKEN_COMMA ||
+                   type == TokenType::TOKEN_EQUAL_EQUAL ||
+                   type == TokenType::TOKEN_BANG_EQUAL);
+  }
+  // literals
+  template <typename T>
+  void leaveEffects([[maybe_unused]] T const &e) {
+    m_effect_free.push_back(true);
+  }
+
+  // replaces the flags of the operands of a node by its own, that has no
+  // effect when they have none and the node itself cannot fail
+  void combine(std::size_t operands, bool effect_free) {
+    for (std::size_t i = 0; i < operands; ++i) {
+      effect_free = effect_free && m_effect_free.back();
+      m_effect_free.pop_back();
+    }
+    m_effect_free.push_back(effect_free);
+  }
+};
+
+class StatementSimplifier {
+  Arena &m_arena;
+  Definitions m_definitions;
+  ExpressionSimplifier m_expressions;
+  StatementWalker m_walker;
+  // the simplified statements of the blocks being walked, innermost last
+  std::vector<std::vector<Statement> > m_blocks;
+  std::vector<Statement> *m_statements = nullptr;
+
+ public:
+  explicit StatementSimplifier(Arena &arena)
+      : m_arena(arena), m_expressions(arena, m_definitions) {}
+
+  auto simplify(std::span<Statement const> statements)
+      -> std::vector<Statement> {
+    open(statements.size());
+    m_walker.walk(statements, *this);
+    return close();
+  }
+
+  void operator()(Node<ExpressionStatement> const &s) {
+    auto [expr, effect_free] = m_expressions.simplify(s->getExpression());
+    if (effect_free) {
+      return;
+    }
+    if (expr == s->getExpression()) {
+      m_statements->emplace_back(s);
+      return;
+    }
+    m_statements->emplace_back(
+        m_arena.make<ExpressionStatement>(std::move(expr)));
+  }
+
+  void operator()(Node<PrintStatement> const &s) {
+    auto expr = m_expressions.simplify(s->getExpression()).first;
+    if (expr == s->getExpression()) {
+      m_statements->emplace_back(s);
+      return;
+    }
+    m_statements->emplace_back(m_arena.make<PrintStatement>(std::move(expr)));
+  }
+
+  void operator()(Node<VariableDeclaration> const &s) {
+    auto const &initializer = s->getInitializer();
+    if (!initializer.has_value()) {
+      m_definitions.declare(s->getSymbol(), false);
+      m_statements->emplace_back(s);
+      return;
+    }
+    auto expr = m_expressions.simplify(initializer.value()).first;
+    m_definitions.declare(s->getSymbol(), true);
+    if (expr == initializer.value()) {
+      m_statements->emplace_back(s);
+      return;
+    }
+    m_statements->emplace_back(
+        m_arena.make<VariableDeclaration>(s->getIdentifier(), std::move(expr)));
+  }
+
+  void enterBlock(Node<BlockStatement> const &s) {
+    m_definitions.push();
+    open(s->getStatements().size());
+  }
+
+  void leaveBlock(Node<BlockStatement> const &s) {
+    auto simplified = close();
+    m_definitions.pop();
+    if (std::ranges::equal(simplified, s->getStatements())) {
+      m_statements->emplace_back(s);
+    } else if (!simplified.empty()) {
+      m_statements->emplace_back(m_arena.make<BlockStatement>(
+          m_arena.copy(std::span<Statement const>{simplified})));
+    }
+  }
+
+ private:
+  // the statements simplified from now on go to a block of their own
+  void open(std::size_t size) {
+    m_blocks.emplace_back().reserve(size);
+    m_statements = &m_blocks.back();
+  }
+
+  auto close() -> std::vector<Statement> {
+    auto simplified = std::move(m_blocks.back());
+    m_blocks.pop_back();
+    m_statements = m_blocks.empty() ? nullptr : &m_blocks.back();
+    return simplified;
+  }
+};
+}  // namespace
+
+void CommaSimplifier::simplify(Program &program) {
+  StatementSimplifier simplifier{program.getArena()};
+  program.getStatements() = simplifier.simplify(program.getStatements());
+}
@@ -0,0 +1,20 @@
+#ifndef CPPLOX_COMMASIMPLIFIER_HPP
+#define CPPLOX_COMMASIMPLIFIER_HPP
+
+#include "Statement.hpp"
+
+/*
+Pass that removes the expressions whose value is discarded and that have no
+effect: the left operands of the commas and the expressions of the expression
+statements. An expression has no effect when it assigns nothing and cannot
+fail, reading a variable only when the program declared it with an
+initializer.
+*/
+class CommaSimplifier {
+ public:
+  // rewrites the statements of program, the new nodes are allocated in its
+  // arena
+  static void simplify(Program &program);
+};
+
+#endif /* CPPLOX_COMMASIMPLIFIER_HPP */
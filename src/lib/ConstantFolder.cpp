@@ -0,0 +1,481 @@
+#include "ConstantFolder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "Bindings.hpp"
+#include "ExpressionWalker.hpp"
+#include "StatementWalker.hpp"
+
+namespace {
+// value of a literal, strings are views of the source or of the arena
+using Constant = std::variant<bool, double, std::string_view, std::nullptr_t>;
+
+// the longer concatenations are left to the runtime, whose long strings are
+// ropes: folding a string assembled by appends would copy it at every append
+constexpr std::size_t max_folded_string = 1024;
+
+struct ConstantVisitor {
+  auto operator()(Node<LiteralNumberExpression> const &e)
+      -> std::optional<Constant> {
+    return e->getValue();
+  }
+  auto operator()(Node<LiteralStringExpression> const &e)
+      -> std::optional<Constant> {
+    return e->getValue();
+  }
+  auto operator()(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_TRUE> > const &e)
+      -> std::optional<Constant> {
+    return true;
+  }
+  auto operator()(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_FALSE> > const
+          &e) -> std::optional<Constant> {
+    return false;
+  }
+  auto operator()(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_NIL> > const &e)
+      -> std::optional<Constant> {
+    return nullptr;
+  }
+  template <typename T>
+  auto operator()([[maybe_unused]] T const &e) -> std::optional<Constant> {
+    return std::nullopt;
+  }
+};
+
+auto constant(Expression const &expr) -> std::optional<Constant> {
+  return std::visit(ConstantVisitor{}, expr);
+}
+
+// same rules as Interpreter::isTruthy and Interpreter::isEqual
+auto isTruthy(Constant const &value) -> bool {
+  if (auto const *boolean = std::get_if<bool>(&value)) {
+    return *boolean;
+  }
+  return !std::holds_alternative<std::nullptr_t>(value);
+}
+
+auto isEqual(Constant const &left, Constant const &right) -> bool {
+  return left == right;
+}
+
+// whether the values cannot be told apart, unlike isEqual -0 is not 0
+auto isSame(Constant const &left, Constant const &right) -> bool {
+  auto const *pl_val = std::get_if<double>(&left);
+  auto const *pr_val = std::get_if<double>(&right);
+  if (pl_val != nullptr && pr_val != nullptr) {
+    return *pl_val == *pr_val && std::signbit(*pl_val) == std::signbit(*pr_val);
+  }
+  return left == right;
+}
+
+template <TokenType type>
+using Unary = Node<UnaryExpression<type> >;
+template <TokenType type>
+using Binary = Node<BinaryExpression<type> >;
+
+template <typename... Nodes>
+auto holdsAnyOf(Expression const &expr) -> bool {
+  return (std::holds_alternative<Nodes>(expr) || ...);
+}
+
+// expressions that evaluate to a number whenever they do not fail
+auto isNumber(Expression const &expr) -> bool {
+  return holdsAnyOf<Node<LiteralNumberExpression>,
+                    Unary<TokenType::TOKEN_MINUS>,
+                    Binary<TokenType::TOKEN_MINUS>,
+                    Binary<TokenType::TOKEN_STAR>,
+                    Binary<TokenType::TOKEN_SLASH> >(expr);
+}
+
+// expressions that evaluate to a boolean whenever they do not fail
+auto isBoolean(Expression const &expr) -> bool {
+  return holdsAnyOf<Node<LiteralExpression<TokenType::TOKEN_TRUE> >,
+                    Node<LiteralExpression<TokenType::TOKEN_FALSE> >,
+                    Unary<TokenType::TOKEN_BANG>,
+                    Binary<TokenType::TOKEN_EQUAL_EQUAL>,
+                    Binary<TokenType::TOKEN_BANG_EQUAL>,
+                    Binary<TokenType::TOKEN_LESS>,
+                    Binary<TokenType::TOKEN_LESS_EQUAL>,
+                    Binary<TokenType::TOKEN_GREATER>,
+                    Binary<TokenType::TOKEN_GREATER_EQUAL> >(expr);
+}
+
+// whether value is the number, +0 for 0
+auto isNumber(std::optional<Constant> const &value, double number) -> bool {
+  auto const *pval =
+      value.has_value() ? std::get_if<double>(&value.value()) : nullptr;
+  return pval != nullptr && *pval == number && !std::signbit(*pval);
+}
+
+// literal value of the variables of the program, nullopt when it is not known
+struct SameConstant {
+  auto operator()(std::optional<Expression> const &left,
+                  std::optional<Expression> const &right) const -> bool {
+    if (!left.has_value() || !right.has_value()) {
+      return !left.has_value() && !right.has_value();
+    }
+    return isSame(constant(left.value()).value(),
+                  constant(right.value()).value());
+  }
+};
+using Constants = Bindings<std::optional<Expression>, SameConstant>;
+
+// folds the nodes in postorder, the folded operands of a node are on top of
+// m_folded when it is left. With bindings, the variables whose value is known
+// are replaced by it.
+class ExpressionFolder {
+  Arena &m_arena;
+  Constants *m_bindings;
+  ExpressionWalker m_walker;
+  std::vector<Expression> m_folded;
+
+ public:
+  ExpressionFolder(Arena &arena, Constants *bindings)
+      : m_arena(arena), m_bindings(bindings) {}
+
+  auto fold(Expression const &expr) -> Expression {
+    m_walker.walk(expr, *this);
+    return pop();
+  }
+
+  void next(Expression const &expr, std::uint8_t operand) {
+    if (m_bindings == nullptr ||
+        !std::holds_alternative<Node<TernaryExpression> >(expr)) {
+      return;
+    }
+    if (operand == 1) {
+      m_bindings->enterTrueBranch();
+    } else {
+      m_bindings->enterFalseBranch();
+    }
+  }
+  void leave(Expression const &expr) {
+    m_folded.push_back(std::visit(*this, expr));
+  }
+
+  auto operator()(Node<VariableExpression> const &e) -> Expression {
+    if (m_bindings != nullptr) {
+      auto const *value = m_bindings->find(e->getSymbol());
+      if (value != nullptr && value->has_value()) {
+        return value->value();
+      }
+    }
+    return e;
+  }
+
+  auto operator()([[maybe_unused]] Node<GroupingExpression> const &e)
+      -> Expression {
+    return pop();
+  }
+
+  auto operator()(Node<AssignExpression> const &e) -> Expression {
+    auto value = pop();
+    if (m_bindings != nullptr) {
+      m_bindings->assign(e->getSymbol(), constant(value).has_value()
+                                             ? std::optional{value}
+                                             : std::nullopt);
+    }
+    if (value == e->getValue()) {
+      return e;
+    }
+    return m_arena.make<AssignExpression>(e->getIdentifier(), std::move(value));
+  }
+
+  auto operator()(Node<TernaryExpression> const &e) -> Expression {
+    auto false_expr = pop();
+    auto true_expr = pop();
+    auto condition = pop();
+    if (m_bindings != nullptr) {
+      m_bindings->leaveTernary();
+    }
+    auto value = constant(condition);
+    if (value.has_value()) {
+      return isTruthy(value.value()) ? true_expr : false_expr;
+    }
+    if (condition == e->getConditionExpression() &&
+        true_expr == e->getTrueExpression() &&
+        false_expr == e->getFalseExpression()) {
+      return e;
+    }
+    return m_arena.make<TernaryExpression>(
+        std::move(condition), std::move(true_expr), std::move(false_expr));
+  }
+
+  template <TokenType type>
+  auto operator()(Node<UnaryExpression<type> > const &e) -> Expression {
+    auto right = pop();
+    auto value = constant(right);
+
+    if constexpr (type == TokenType::TOKEN_MINUS) {
+      if (value.has_value() && std::holds_alternative<double>(value.value())) {
+        return literal(-std::get<double>(value.value()));
+      }
+      // -(-x) is x for every number
+      auto const *inner = std::get_if<Unary<TokenType::TOKEN_MINUS> >(&right);
+      if (inner != nullptr && isNumber((*inner)->getExpression())) {
+        return (*inner)->getExpression();
+      }
+    } else {
+      if (value.has_value()) {
+        return literal(!isTruthy(value.value()));
+      }
+      // !!x is x for every boolean
+      auto const *inner = std::get_if<Unary<TokenType::TOKEN_BANG> >(&right);
+      if (inner != nullptr && isBoolean((*inner)->getExpression())) {
+        return (*inner)->getExpression();
+      }
+    }
+
+    if (right == e->getExpression()) {
+      return e;
+    }
+    return m_arena.make<UnaryExpression<type> >(e->getOperator(),
+                                                std::move(right));
+  }
+
+  template <TokenType type>
+  auto operator()(Node<BinaryExpression<type> > const &e) -> Expression {
+    auto right = pop();
+    auto left = pop();
+    auto left_value = constant(left);
+    auto right_value = constant(right);
+
+    if (left_value.has_value() && right_value.has_value()) {
+      auto value = evaluate<type>(left_value.value(), right_value.value());
+      if (value.has_value()) {
+        return literal(value.value());
+      }
+    }
+
+    // identities that keep the value, sign of zero included, and the errors
+    // of their other operand
+    if constexpr (type == TokenType::TOKEN_COMMA) {
+      if (left_value.has_value()) {
+        return right;
+      }
+    } else if constexpr (type == TokenType::TOKEN_MINUS) {
+      if (isNumber(left) && isNumber(right_value, 0)) {
+        return left;
+      }
+    } else if constexpr (type == TokenType::TOKEN_STAR) {
+      if (isNumber(left) && isNumber(right_value, 1)) {
+        return left;
+      }
+      if (isNumber(left_value, 1) && isNumber(right)) {
+        return right;
+      }
+    } else if constexpr (type == TokenType::TOKEN_SLASH) {
+      if (isNumber(left) && isNumber(right_value, 1)) {
+        return left;
+      }
+    }
+
+    if (left == e->getLeftExpression() && right == e->getRightExpression()) {
+      return e;
+    }
+    return m_arena.make<BinaryExpression<type> >(
+        std::move(left), e->getOperator(), std::move(right));
+  }
+
+  template <typename T>
+  auto operator()(T const &e) -> Expression {
+    return e;
+  }
+
+ private:
+  auto pop() -> Expression {
+    auto expr = m_folded.back();
+    m_folded.pop_back();
+    return expr;
+  }
+
+  // value of the operator, nullopt when it fails at runtime or is not folded
+  template <TokenType type>
+  auto evaluate(Constant const &left, Constant const &right)
+      -> std::optional<Constant> {
+    if constexpr (type == TokenType::TOKEN_COMMA) {
+      return right;
+    } else if constexpr (type == TokenType::TOKEN_EQUAL_EQUAL) {
+      return isEqual(left, right);
+    } else if constexpr (type == TokenType::TOKEN_BANG_EQUAL) {
+      return !isEqual(left, right);
+    } else {
+      if constexpr (type == TokenType::TOKEN_PLUS) {
+        auto const *left_string = std::get_if<std::string_view>(&left);
+        auto const *right_string = std::get_if<std::string_view>(&right);
+        if (left_string != nullptr && right_string != nullptr) {
+          if (left_string->size() + right_string->size() > max_folded_string) {
+            return std::nullopt;
+          }
+          return concatenate(*left_string, *right_string);
+        }
+      }
+
+      auto const *pl_val = std::get_if<double>(&left);
+      auto const *pr_val = std::get_if<double>(&right);
+      if (pl_val == nullptr || pr_val == nullptr) {
+        return std::nullopt;
+      }
+      auto l = *pl_val;
+      auto r = *pr_val;
+      switch (type) {
+        case TokenType::TOKEN_LESS:
+          return l < r;
+        case TokenType::TOKEN_LESS_EQUAL:
+          return l <= r;
+        case TokenType::TOKEN_GREATER:
+          return l > r;
+        case TokenType::TOKEN_GREATER_EQUAL:
+          return l >= r;
+        case TokenType::TOKEN_PLUS:
+          return l + r;
+        case TokenType::TOKEN_MINUS:
+          return l - r;
+        case TokenType::TOKEN_STAR:
+          return l * r;
+        case TokenType::TOKEN_SLASH:
+          return l / r;
+        default:
+          return std::nullopt;
+      }
+    }
+  }
+
+  auto concatenate(std::string_view left, std::string_view right)
+      -> std::string_view {
+    std::string value{left};
+    value += right;
+    auto copy = m_arena.copy(std::span<char const>{value});
+    return {copy.data(), copy.size()};
+  }
+
+  auto literal(Constant const &value) -> Expression {
+    if (auto const *boolean = std::get_if<bool>(&value)) {
+      if (*boolean) {
+        return m_arena.make<LiteralExpression<TokenType::TOKEN_TRUE> >();
+      }
+      return m_arena.make<LiteralExpression<TokenType::TOKEN_FALSE> >();
+    }
+    if (auto const *number = std::get_if<double>(&value)) {
+      return m_arena.make<LiteralNumberExpression>(*number);
+    }
+    if (auto const *string = std::get_if<std::string_view>(&value)) {
+      return m_arena.make<LiteralStringExpression>(*string);
+    }
+    return m_arena.make<LiteralExpression<TokenType::TOKEN_NIL> >();
+  }
+};
+
+// folds the statements the walker visits into the statements of the innermost
+// block being walked
+class StatementFolder {
+  Arena &m_arena;
+  Constants *m_bindings;
+  ExpressionFolder m_expressions;
+  StatementWalker m_walker;
+  // the folded statements of the blocks being walked, innermost last
+  std::vector<std::vector<Statement> > m_blocks;
+
+ public:
+  StatementFolder(Arena &arena, Constants *bindings)
+      : m_arena(arena), m_bindings(bindings), m_expressions(arena, bindings) {}
+
+  auto fold(std::span<Statement const> statements) -> std::vector<Statement> {
+    m_blocks.emplace_back().reserve(statements.size());
+    m_walker.walk(statements, *this);
+    auto folded = std::move(m_blocks.back());
+    m_blocks.pop_back();
+    return folded;
+  }
+
+  template <typename T>
+  void operator()(Node<T> const &s) {
+    m_blocks.back().push_back(foldStatement(s));
+  }
+
+  void enterBlock(Node<BlockStatement> const &s) {
+    if (m_bindings != nullptr) {
+      m_bindings->push();
+    }
+    m_blocks.emplace_back().reserve(s->getStatements().size());
+  }
+
+  void leaveBlock(Node<BlockStatement> const &s) {
+    if (m_bindings != nullptr) {
+      m_bindings->pop();
+    }
+    auto statements = std::move(m_blocks.back());
+    m_blocks.pop_back();
+    if (std::ranges::equal(statements, s->getStatements())) {
+      m_blocks.back().emplace_back(s);
+      return;
+    }
+    m_blocks.back().emplace_back(m_arena.make<BlockStatement>(
+        m_arena.copy(std::span<Statement const>{statements})));
+  }
+
+ private:
+  auto foldStatement(Node<ExpressionStatement> const &s) -> Statement {
+    auto expr = m_expressions.fold(s->getExpression());
+    if (expr == s->getExpression()) {
+      return s;
+    }
+    return m_arena.make<ExpressionStatement>(std::move(expr));
+  }
+
+  auto foldStatement(Node<PrintStatement> const &s) -> Statement {
+    auto expr = m_expressions.fold(s->getExpression());
+    if (expr == s->getExpression()) {
+      return s;
+    }
+    return m_arena.make<PrintStatement>(std::move(expr));
+  }
+
+  auto foldStatement(Node<VariableDeclaration> const &s) -> Statement {
+    auto const &initializer = s->getInitializer();
+    if (!initializer.has_value()) {
+      declare(s, std::nullopt);
+      return s;
+    }
+    auto expr = m_expressions.fold(initializer.value());
+    declare(s, expr);
+    if (expr == initializer.value()) {
+      return s;
+    }
+    return m_arena.make<VariableDeclaration>(s->getIdentifier(),
+                                             std::move(expr));
+  }
+
+  void declare(Node<VariableDeclaration> const &s,
+               std::optional<Expression> const &value) {
+    if (m_bindings == nullptr) {
+      return;
+    }
+    auto known = value.has_value() && constant(value.value()).has_value();
+    m_bindings->declare(s->getSymbol(), known ? value : std::nullopt);
+  }
+};
+}  // namespace
+
+void ConstantFolder::fold(Program &program) {
+  StatementFolder folder{program.getArena(), nullptr};
+  program.getStatements() = folder.fold(program.getStatements());
+}
+
+void ConstantFolder::propagate(Program &program) {
+  Constants bindings;
+  StatementFolder folder{program.getArena(), &bindings};
+  program.getStatements() = folder.fold(program.getStatements());
+}
@@ -0,0 +1,24 @@
+#ifndef CPPLOX_CONSTANTFOLDER_HPP
+#define CPPLOX_CONSTANTFOLDER_HPP
+
+#include "Statement.hpp"
+
+/*
+Pass run between the parser and the interpreter. It evaluates the operators
+whose operands are literals, removes the groupings and simplifies the
+identities that hold for every value of their operand. An operation that
+would fail at runtime is left in place so that its error is still reported
+when it is executed.
+*/
+class ConstantFolder {
+ public:
+  // rewrites the statements of program, the new nodes are allocated in its
+  // arena
+  static void fold(Program &program);
+  // folds program like fold, and replaces the variables it reads by the
+  // literal they were last given by the program, when every path to the read
+  // gave them the same one
+  static void propagate(Program &program);
+};
+
+#endif /* CPPLOX_CONSTANTFOLDER_HPP */
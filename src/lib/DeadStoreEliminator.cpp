@@ -0,0 +1,303 @@
+#include "DeadStoreEliminator.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ExpressionRewriter.hpp"
+#include "ExpressionWalker.hpp"
+#include "Scopes.hpp"
+#include "StatementWalker.hpp"
+
+namespace {
+// what the analysis found about the variables of the blocks
+struct Liveness {
+  std::unordered_set<AssignExpression const *> dead_assignments;
+  std::unordered_set<VariableDeclaration const *> dead_initializers;
+  std::unordered_set<VariableDeclaration const *> unread_declarations;
+
+  [[nodiscard]] auto isEmpty() const -> bool {
+    return dead_assignments.empty() && dead_initializers.empty() &&
+           unread_declarations.empty();
+  }
+};
+
+// walks the program in the order it runs: the stores of a variable are
+// pending until it is read, which makes them live, or until it is stored again
+// or its block ends, which makes them dead. A store in a branch of a ternary
+// does not end the pending stores, the other branch may not run it.
+class Analysis {
+  struct Binding {
+    // nullptr for the variables of the top level, which are not tracked
+    VariableDeclaration const *declaration;
+    bool initializer_pending;
+    bool read = false;
+    std::vector<AssignExpression const *> pending;
+  };
+
+  Liveness &m_liveness;
+  Scopes<Binding> m_scopes;
+  ExpressionWalker m_walker;
+  // number of ternary branches the walk is in
+  std::size_t m_branches = 0;
+
+ public:
+  explicit Analysis(Liveness &liveness) : m_liveness(liveness) {}
+
+  void operator()(Node<ExpressionStatement> const &s) {
+    m_walker.walk(s->getExpression(), *this);
+  }
+
+  void operator()(Node<PrintStatement> const &s) {
+    m_walker.walk(s->getExpression(), *this);
+  }
+
+  void operator()(Node<VariableDeclaration> const &s) {
+    auto const &initializer = s->getInitializer();
+    if (initializer.has_value()) {
+      m_walker.walk(initializer.value(), *this);
+    }
+    // a declaration in the same scope replaces the variable
+    auto *declared = m_scopes.findInScope(s->getSymbol());
+    if (declared != nullptr) {
+      end(*declared);
+    }
+    auto const *declaration = m_scopes.isTopLevel() ? nullptr : &*s;
+    m_scopes.declare(s->getSymbol(),
+                     {declaration, initializer.has_value(), false, {}});
+  }
+
+  void enterBlock([[maybe_unused]] Node<BlockStatement> const &s) {
+    m_scopes.push();
+  }
+
+  void leaveBlock([[maybe_unused]] Node<BlockStatement> const &s) {
+    for (auto &[symbol, binding] : m_scopes.getBlockScope()) {
+      end(binding);
+    }
+    m_scopes.pop();
+  }
+
+  void next(Expression const &expr, std::uint8_t operand) {
+    if (operand == 1 &&
+        std::holds_alternative<Node<TernaryExpression> >(expr)) {
+      ++m_branches;
+    }
+  }
+
+  void leave(Expression const &expr) {
+    if (auto const *variable = std::get_if<Node<VariableExpression> >(&expr)) {
+      read((*variable)->getSymbol());
+    } else if (auto const *assign =
+                   std::get_if<Node<AssignExpression> >(&expr)) {
+      store(*assign);
+    } else if (std::holds_alternative<Node<TernaryExpression> >(expr)) {
+      --m_branches;
+    }
+  }
+
+ private:
+  void read(SymbolTable::Symbol symbol) {
+    auto *binding = m_scopes.find(symbol);
+    if (binding == nullptr || binding->declaration == nullptr) {
+      return;
+    }
+    binding->read = true;
+    binding->initializer_pending = false;
+    binding->pending.clear();
+  }
+
+  void store(Node<AssignExpression> const &e) {
+    auto *binding = m_scopes.find(e->getSymbol());
+    if (binding == nullptr || binding->declaration == nullptr) {
+      return;
+    }
+    if (m_branches == 0) {
+      kill(*binding);
+    }
+    binding->pending.push_back(&*e);
+  }
+
+  // binding is no longer visible
+  void end(Binding &binding) {
+    kill(binding);
+    if (binding.declaration != nullptr && !binding.read) {
+      m_liveness.unread_declarations.insert(binding.declaration);
+    }
+  }
+
+  // the pending stores of binding are never read
+  void kill(Binding &binding) {
+    if (binding.declaration == nullptr) {
+      return;
+    }
+    if (binding.initializer_pending) {
+      m_liveness.dead_initializers.insert(binding.declaration);
+      binding.initializer_pending = false;
+    }
+    for (auto const *assignment : binding.pending) {
+      m_liveness.dead_assignments.insert(assignment);
+    }
+    binding.pending.clear();
+  }
+};
+
+auto isLiteral(Expression const &expr) -> bool {
+  return std::holds_alternative<Node<LiteralNumberExpression> >(expr) ||
+         std::holds_alternative<Node<LiteralStringExpression> >(expr) ||
+         std::holds_alternative<
+             Node<LiteralExpression<TokenType::TOKEN_TRUE> > >(expr) ||
+         std::holds_alternative<
+             Node<LiteralExpression<TokenType::TOKEN_FALSE> > >(expr) ||
+         std::holds_alternative<
+             Node<LiteralExpression<TokenType::TOKEN_NIL> > >(expr);
+}
+
+class ExpressionEliminator : public ExpressionRewriter<ExpressionEliminator> {
+  Liveness const &m_liveness;
+
+ public:
+  using ExpressionRewriter::operator();
+
+  ExpressionEliminator(Arena &arena, Liveness const &liveness)
+      : ExpressionRewriter(arena), m_liveness(liveness) {}
+
+  // the value of a dead assignment is the value assigned
+  auto operator()(Node<AssignExpression> const &e) -> Expression {
+    if (m_liveness.dead_assignments.contains(&*e)) {
+      return pop();
+    }
+    return ExpressionRewriter::operator()(e);
+  }
+};
+
+// appends the statements a statement is rewritten to to m_statements, none
+// when it is removed
+class StatementEliminator {
+  Arena &m_arena;
+  Liveness const &m_liveness;
+  ExpressionEliminator m_expressions;
+  StatementWalker m_walker;
+  // the statements of the blocks being walked, innermost last
+  std::vector<std::vector<Statement> > m_blocks;
+  std::vector<Statement> *m_statements = nullptr;
+
+ public:
+  StatementEliminator(Arena &arena, Liveness const &liveness)
+      : m_arena(arena),
+        m_liveness(liveness),
+        m_expressions(arena, liveness) {}
+
+  // the variables of the top level are not tracked, so only its blocks can
+  // have dead stores
+  auto eliminateTopLevel(std::span<Statement const> statements)
+      -> std::vector<Statement> {
+    open(statements.size());
+    for (auto const &statement : statements) {
+      if (std::holds_alternative<Node<BlockStatement> >(statement)) {
+        m_walker.walk({&statement, 1}, *this);
+      } else {
+        m_statements->push_back(statement);
+      }
+    }
+    return close();
+  }
+
+  void operator()(Node<ExpressionStatement> const &s) {
+    auto expr = m_expressions.rewrite(s->getExpression());
+    if (expr == s->getExpression()) {
+      m_statements->emplace_back(s);
+      return;
+    }
+    m_statements->emplace_back(
+        m_arena.make<ExpressionStatement>(std::move(expr)));
+  }
+
+  void operator()(Node<PrintStatement> const &s) {
+    auto expr = m_expressions.rewrite(s->getExpression());
+    if (expr == s->getExpression()) {
+      m_statements->emplace_back(s);
+      return;
+    }
+    m_statements->emplace_back(m_arena.make<PrintStatement>(std::move(expr)));
+  }
+
+  void operator()(Node<VariableDeclaration> const &s) {
+    auto const &initializer = s->getInitializer();
+    std::optional<Expression> expr;
+    if (initializer.has_value()) {
+      expr = m_expressions.rewrite(initializer.value());
+    }
+
+    auto const *declaration = &*s;
+    auto unread = m_liveness.unread_declarations.contains(declaration);
+    if (!unread && !m_liveness.dead_initializers.contains(declaration)) {
+      if (expr == initializer) {
+        m_statements->emplace_back(s);
+      } else {
+        m_statements->emplace_back(
+            m_arena.make<VariableDeclaration>(s->getIdentifier(),
+                                              std::move(expr)));
+      }
+      return;
+    }
+
+    // only the effects of the initializer are kept
+    if (expr.has_value() && !isLiteral(expr.value())) {
+      m_statements->emplace_back(
+          m_arena.make<ExpressionStatement>(std::move(expr.value())));
+    }
+    if (!unread) {
+      m_statements->emplace_back(
+          m_arena.make<VariableDeclaration>(s->getIdentifier()));
+    }
+  }
+
+  void enterBlock(Node<BlockStatement> const &s) {
+    open(s->getStatements().size());
+  }
+
+  void leaveBlock(Node<BlockStatement> const &s) {
+    auto eliminated = close();
+    if (std::ranges::equal(eliminated, s->getStatements())) {
+      m_statements->emplace_back(s);
+    } else if (!eliminated.empty()) {
+      m_statements->emplace_back(m_arena.make<BlockStatement>(
+          m_arena.copy(std::span<Statement const>{eliminated})));
+    }
+  }
+
+ private:
+  // the statements eliminated from now on go to a block of their own
+  void open(std::size_t size) {
+    m_blocks.emplace_back().reserve(size);
+    m_statements = &m_blocks.back();
+  }
+
+  auto close() -> std::vector<Statement> {
+    auto eliminated = std::move(m_blocks.back());
+    m_blocks.pop_back();
+    m_statements = m_blocks.empty() ? nullptr : &m_blocks.back();
+    return eliminated;
+  }
+};
+}  // namespace
+
+void DeadStoreEliminator::eliminate(Program &program) {
+  Liveness liveness;
+  Analysis analysis{liveness};
+  StatementWalker walker;
+  walker.walk(program.getStatements(), analysis);
+  if (liveness.isEmpty()) {
+    return;
+  }
+  StatementEliminator eliminator{program.getArena(), liveness};
+  program.getStatements() =
+      eliminator.eliminateTopLevel(program.getStatements());
+}
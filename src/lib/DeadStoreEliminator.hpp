@@ -0,0 +1,21 @@
+#ifndef CPPLOX_DEADSTOREELIMINATOR_HPP
+#define CPPLOX_DEADSTOREELIMINATOR_HPP
+
+#include "Statement.hpp"
+
+/*
+Pass that removes the stores to the variables of blocks that are never read:
+those overwritten before being read and those the block ends before reading.
+A removed assignment is replaced by its value, and a declaration whose
+variable is never read is removed with its initializer when it is a literal.
+The variables of the top level of a program are left alone, other programs
+run in the same global environment may read them.
+*/
+class DeadStoreEliminator {
+ public:
+  // rewrites the statements of program, the new nodes are allocated in its
+  // arena
+  static void eliminate(Program &program);
+};
+
+#endif /* CPPLOX_DEADSTOREELIMINATOR_HPP */
@@ -0,0 +1,91 @@
+#include "DeclarationScanner.hpp"
+
+#include "utils/Scan.hpp"
+
+auto DeclarationScanner::scan(std::string_view text, std::size_t from)
+    -> std::optional<std::size_t> {
+  auto const *begin = text.data();
+  auto const *end = begin + text.size();
+  auto const *it = begin + from;
+
+  while (it != end) {
+    switch (m_state) {
+      case State::CODE:
+        switch (*it++) {
+          case '"':
+            m_state = State::STRING;
+            break;
+          case '/':
+            m_state = State::SLASH;
+            break;
+          case '{':
+            ++m_depth;
+            break;
+          case '}':
+            if (--m_depth <= 0) {
+              m_depth = 0;
+              return it - begin;
+            }
+            break;
+          case ';':
+            if (m_depth == 0) {
+              return it - begin;
+            }
+            break;
+          default:
+            break;
+        }
+        break;
+      case State::SLASH:
+        if (*it == '/') {
+          m_state = State::LINE_COMMENT;
+          ++it;
+        } else if (*it == '*') {
+          m_state = State::BLOCK_COMMENT;
+          ++it;
+        } else {
+          m_state = State::CODE;
+        }
+        break;
+      case State::LINE_COMMENT:
+        it = Scan::findByte(it, end, '\n');
+        if (it != end) {
+          m_state = State::CODE;
+          ++it;
+        }
+        break;
+      case State::BLOCK_COMMENT:
+        it = Scan::findByte(it, end, '*');
+        if (it != end) {
+          m_state = State::BLOCK_COMMENT_STAR;
+          ++it;
+        }
+        break;
+      case State::BLOCK_COMMENT_STAR:
+        if (*it == '/') {
+          m_state = State::CODE;
+          ++it;
+        } else if (*it != '*') {
+          m_state = State::BLOCK_COMMENT;
+          ++it;
+        } else {
+          ++it;
+        }
+        break;
+      case State::STRING:
+        it = Scan::findByte(it, end, '"');
+        if (it != end) {
+          m_state = State::CODE;
+          ++it;
+        }
+        break;
+    }
+  }
+
+  return std::nullopt;
+}
+
+void DeclarationScanner::reset() {
+  m_state = State::CODE;
+  m_depth = 0;
+}
@@ -0,0 +1,37 @@
+#ifndef CPPLOX_DECLARATIONSCANNER_HPP
+#define CPPLOX_DECLARATIONSCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/*
+Finds where top-level declarations end without lexing them: a declaration ends
+on a ';' or on the '}' closing a block, outside of strings and comments. The
+scanner keeps its state between calls so that a declaration can be fed in
+several pieces, and starts over after each declaration it finds.
+*/
+class DeclarationScanner {
+  enum class State : std::uint8_t {
+    CODE,
+    SLASH,
+    LINE_COMMENT,
+    BLOCK_COMMENT,
+    BLOCK_COMMENT_STAR,
+    STRING
+  };
+
+  State m_state = State::CODE;
+  std::int64_t m_depth = 0;
+
+ public:
+  // scans [from, text.size()) and returns the offset right after the end of
+  // the current declaration, or nullopt when it does not end in text
+  auto scan(std::string_view text, std::size_t from)
+      -> std::optional<std::size_t>;
+
+  void reset();
+};
+
+#endif /* CPPLOX_DECLARATIONSCANNER_HPP */
@@ -0,0 +1,129 @@
+#include "Document.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "DeclarationScanner.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "utils/Scan.hpp"
+
+Document::Document(SymbolTable &symbols) : m_symbols(symbols) {}
+
+void Document::setText(std::string_view text) {
+  reparse(std::string{text}, 0, m_declarations.size());
+}
+
+void Document::edit(std::size_t offset, std::size_t length,
+                    std::string_view replacement) {
+  if (offset > m_size || length > m_size - offset) {
+    throw std::out_of_range("Edit out of the document");
+  }
+
+  // the declarations before the one holding offset end before the edit, and
+  // so do their boundaries, an edit at the end of the text goes to the last
+  // declaration which may be unterminated
+  std::size_t first = 0;
+  std::size_t start = 0;
+  while (first + 1 < m_declarations.size() &&
+         start + m_declarations[first]->text.size() <= offset) {
+    start += m_declarations[first]->text.size();
+    ++first;
+  }
+
+  std::string text;
+  auto last = first;
+  auto end = start;
+  while (last < m_declarations.size() &&
+         (last == first || end < offset + length)) {
+    text += m_declarations[last]->text;
+    end += m_declarations[last]->text.size();
+    ++last;
+  }
+  text.replace(offset - start, length, replacement);
+
+  reparse(std::move(text), first, last);
+}
+
+void Document::reparse(std::string text, std::size_t first, std::size_t last) {
+  for (auto i = first; i < last; ++i) {
+    m_size -= m_declarations[i]->text.size();
+  }
+
+  std::vector<std::unique_ptr<Declaration> > declarations;
+  DeclarationScanner scanner;
+  std::size_t start = 0;
+  std::size_t scanned = 0;
+  while (true) {
+    auto end = scanner.scan(text, scanned);
+    if (end.has_value()) {
+      declarations.push_back(parse(text.substr(start, end.value() - start)));
+      start = scanned = end.value();
+      continue;
+    }
+    if (start == text.size()) {
+      break;
+    }
+    if (last == m_declarations.size()) {
+      // unterminated trailing declaration, let the parser report it
+      declarations.push_back(parse(text.substr(start)));
+      break;
+    }
+    scanned = text.size();
+    text += m_declarations[last]->text;
+    m_size -= m_declarations[last]->text.size();
+    ++last;
+  }
+
+  m_size += text.size();
+  m_reparsed = declarations.size();
+  m_declarations.erase(m_declarations.begin() + first,
+                       m_declarations.begin() + last);
+  m_declarations.insert(m_declarations.begin() + first,
+                        std::make_move_iterator(declarations.begin()),
+                        std::make_move_iterator(declarations.end()));
+}
+
+auto Document::parse(std::string text) -> std::unique_ptr<Declaration> {
+  auto declaration = std::make_unique<Declaration>();
+  declaration->text = std::move(text);
+  auto const &source = declaration->text;
+  declaration->newlines = static_cast<std::uint32_t>(
+      Scan::countNewlines(source.data(), source.data() + source.size()));
+
+  // declarations are small, lexing them on other threads does not pay off
+  Lexer lexer{source, declaration->errors, m_symbols};
+  auto tokens = lexer.scanTokens(1);
+  if (!declaration->errors.hasErrors() && tokens.has_value()) {
+    declaration->tokens = std::move(tokens->get());
+    Parser parser{declaration->tokens, declaration->errors, m_symbols};
+    declaration->program = parser.parse();
+  }
+  return declaration;
+}
+
+[[nodiscard]] auto Document::getText() const -> std::string {
+  std::string text;
+  text.reserve(m_size);
+  for (auto const &declaration : m_declarations) {
+    text += declaration->text;
+  }
+  return text;
+}
+
+[[nodiscard]] auto Document::getSize() const -> std::size_t { return m_size; }
+
+[[nodiscard]] auto Document::getDeclarations() const
+    -> std::vector<std::unique_ptr<Declaration> > const & {
+  return m_declarations;
+}
+
+[[nodiscard]] auto Document::getReparsedCount() const -> std::size_t {
+  return m_reparsed;
+}
+
+[[nodiscard]] auto Document::hasErrors() const -> bool {
+  return std::any_of(
+      m_declarations.begin(), m_declarations.end(),
+      [](auto const &declaration) { return declaration->errors.hasErrors(); });
+}
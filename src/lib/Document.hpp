@@ -0,0 +1,66 @@
+#ifndef CPPLOX_DOCUMENT_HPP
+#define CPPLOX_DOCUMENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ErrorReporter.hpp"
+#include "Statement.hpp"
+#include "SymbolTable.hpp"
+#include "Token.hpp"
+
+/*
+A source kept split in top-level declarations, each one with its own tokens and
+statements. An edit only relexes and reparses the declarations it touches, and
+the ones following them until a declaration boundary of the previous text is
+found again, so its cost depends on the size of the edit and not of the source.
+*/
+class Document {
+ public:
+  struct Declaration {
+    // positions in tokens, program and errors are relative to text
+    std::string text;
+    std::uint32_t newlines = 0;
+    TokenBuffer tokens;
+    std::optional<Program> program;
+    ErrorReporter errors;
+  };
+
+ private:
+  SymbolTable &m_symbols;
+  // declarations are not moved once parsed, their tokens and programs hold
+  // views of their text
+  std::vector<std::unique_ptr<Declaration> > m_declarations;
+  std::size_t m_size = 0;
+  std::size_t m_reparsed = 0;
+
+ public:
+  Document(SymbolTable &symbols);
+
+  void setText(std::string_view text);
+  // replaces the length bytes at offset with replacement
+  void edit(std::size_t offset, std::size_t length,
+            std::string_view replacement);
+
+  [[nodiscard]] auto getText() const -> std::string;
+  [[nodiscard]] auto getSize() const -> std::size_t;
+  [[nodiscard]] auto getDeclarations() const
+      -> std::vector<std::unique_ptr<Declaration> > const &;
+  // number of declarations lexed and parsed by the last setText or edit
+  [[nodiscard]] auto getReparsedCount() const -> std::size_t;
+  [[nodiscard]] auto hasErrors() const -> bool;
+
+ private:
+  // splits text, starting at an old declaration boundary, into declarations
+  // that replace the old ones in [first, last), more old declarations are
+  // consumed while the last new one is incomplete
+  void reparse(std::string text, std::size_t first, std::size_t last);
+  auto parse(std::string text) -> std::unique_ptr<Declaration>;
+};
+
+#endif /* CPPLOX_DOCUMENT_HPP */
@@ -1,5 +1,9 @@
 #include "Environment.hpp"
 
+#include <fmt/core.h>
+
+#include <utility>
+
 Environment::Environment(ErrorReporter &error_reporter)
     : m_error_reporter(error_reporter), m_parent(std::nullopt) {}
 
@@ -9,43 +13,61 @@ Environment::Environment(Environment &parent)
 Environment::EnvironmentException::EnvironmentException(std::string const &what)
     : std::runtime_error("[InterpreterException]\n" + what) {}
 
-void Environment::define(std::string_view name,
-                         std::optional<Interpreter::ExpressionValue> value) {
-  m_values.insert_or_assign(std::string{name}, value);
+auto Environment::define(SymbolTable::Symbol symbol,
+                         Interpreter::ExpressionValue value)
+    -> Interpreter::ExpressionValue & {
+  return m_values.insert_or_assign(symbol, std::move(value)).first->second;
 }
 
-void Environment::assign(Box<AssignExpression> const &expr,
+void Environment::assign(Node<AssignExpression> const &expr,
                          Interpreter::ExpressionValue const &value) {
-  auto const name = std::string{expr->getName()};
-  if (m_values.contains(name)) {
-    m_values[name] = value;
+  auto it = m_values.find(expr->getSymbol());
+  if (it != m_values.end()) {
+    it->second = value;
   } else if (m_parent.has_value()) {
     m_parent.value().get().assign(expr, value);
   } else {
-    throw error(expr->getIdentifier(),
+    throw error(expr->getIdentifier().getPosition(),
                 fmt::format("Undeclared variable '{}'", expr->getName()));
   }
 }
 
-auto Environment::get(Box<VariableExpression> const &expr)
+auto Environment::get(Node<VariableExpression> const &expr)
     -> std::optional<Interpreter::ExpressionValue> {
-  try {
-    return m_values.at(std::string{expr->getName()});
-  } catch (std::out_of_range &e) {
-    if (m_parent.has_value()) {
-      return m_parent.value().get().get(expr);
-    }
-    throw error(expr->getIdentifier(),
-                fmt::format("Undeclared variable '{}'", expr->getName()));
+  auto const &value = find(expr);
+  if (value.isUndefined()) {
+    return std::nullopt;
   }
+  return value;
 }
 
-auto Environment::error(std::optional<Token const *> token,
-                        std::string const &msg) -> EnvironmentException {
-  if (token.has_value()) {
-    m_error_reporter.setError(msg, token.value()->getPosition());
-  } else {
-    m_error_reporter.setError(msg);
+auto Environment::find(Node<VariableExpression> const &expr)
+    -> Interpreter::ExpressionValue & {
+  auto it = m_values.find(expr->getSymbol());
+  if (it != m_values.end()) {
+    return it->second;
+  }
+  if (m_parent.has_value()) {
+    return m_parent.value().get().find(expr);
   }
+  throw error(expr->getIdentifier().getPosition(),
+              fmt::format("Undeclared variable '{}'", expr->getName()));
+}
+
+auto Environment::lookup(SymbolTable::Symbol symbol)
+    -> Interpreter::ExpressionValue * {
+  auto it = m_values.find(symbol);
+  if (it != m_values.end()) {
+    return &it->second;
+  }
+  if (m_parent.has_value()) {
+    return m_parent.value().get().lookup(symbol);
+  }
+  return nullptr;
+}
+
+auto Environment::error(std::optional<SourcePosition> position,
+                        std::string const &msg) -> EnvironmentException {
+  m_error_reporter.setError(msg, position);
   return {msg};
 }
\ No newline at end of file
@@ -9,10 +9,12 @@
 #include "ErrorReporter.hpp"
 #include "Expression.hpp"
 #include "Interpreter.hpp"
+#include "SymbolTable.hpp"
 #include "Token.hpp"
 
 class Environment {
-  std::unordered_map<std::string, std::optional<Interpreter::ExpressionValue>>
+  // undefined while the variable is not initialized
+  std::unordered_map<SymbolTable::Symbol, Interpreter::ExpressionValue>
       m_values;
 
   ErrorReporter& m_error_reporter;
@@ -31,15 +33,22 @@ class Environment {
     EnvironmentException(std::string const& what);
   };
 
-  void define(std::string_view name,
-              std::optional<Interpreter::ExpressionValue> value);
-  void assign(Box<AssignExpression> const& expr,
+  // returns the slot of the variable
+  auto define(SymbolTable::Symbol symbol, Interpreter::ExpressionValue value)
+      -> Interpreter::ExpressionValue&;
+  void assign(Node<AssignExpression> const& expr,
               Interpreter::ExpressionValue const& value);
-  auto get(Box<VariableExpression> const& expr)
+  auto get(Node<VariableExpression> const& expr)
       -> std::optional<Interpreter::ExpressionValue>;
+  // the slot of the variable, undefined while it is not initialized
+  auto find(Node<VariableExpression> const& expr)
+      -> Interpreter::ExpressionValue&;
+  // the slot of the variable, nullptr when it is not declared. The slots are
+  // not moved while the environment lives.
+  auto lookup(SymbolTable::Symbol symbol) -> Interpreter::ExpressionValue*;
 
  private:
-  auto error(std::optional<Token const*> token, std::string const& msg)
+  auto error(std::optional<SourcePosition> position, std::string const& msg)
       -> EnvironmentException;
 };
 
@@ -3,8 +3,7 @@
 #include <fmt/color.h>
 #include <fmt/core.h>
 
-#include <range/v3/view.hpp>
-#include <range/v3/view/transform.hpp>
+#include <algorithm>
 
 Error::Error(std::string msg, std::optional<SourcePosition> position)
     : m_msg(std::move(msg)), m_position(std::move(position)) {}
@@ -16,23 +15,95 @@ ErrorReporter::ErrorReporter(Formater formater)
   return !m_errors.empty();
 }
 
+[[nodiscard]] auto ErrorReporter::getSuppressedCount() const -> std::size_t {
+  return m_suppressed;
+}
+
+void ErrorReporter::report(Sink const& sink) const {
+  if (m_errors.empty()) {
+    return;
+  }
+  if (!m_line_index.has_value()) {
+    if (m_line_prefix.empty()) {
+      m_line_index.emplace(m_source);
+    } else {
+      m_text = std::string{m_line_prefix} + std::string{m_source};
+      m_line_index.emplace(m_text);
+    }
+  }
+
+  for (auto const& error : m_errors) {
+    if (m_line_prefix.empty() || !error.hasPosition()) {
+      sink(m_formater(error, m_line_index.value(), m_first_line));
+      continue;
+    }
+    Error shifted{error.getMessage(),
+                  error.getPositon()->withOffset(m_line_prefix.size())};
+    sink(m_formater(shifted, m_line_index.value(), m_first_line));
+  }
+  if (m_suppressed != 0) {
+    sink(fmt::format("{0} {1} more error{2} not shown\n",
+                     fmt::styled("note:", fmt::fg(fmt::color::cyan)),
+                     m_suppressed, m_suppressed == 1 ? "" : "s"));
+  }
+}
+
 [[nodiscard]] auto ErrorReporter::getErrors() const
     -> std::vector<std::string> {
-  return m_errors | ranges::views::transform([this](Error const& error) {
-           return m_formater(error, m_source);
-         }) |
-         ranges::to_vector;
+  std::vector<std::string> errors;
+  report([&errors](std::string_view error) { errors.emplace_back(error); });
+  return errors;
 }
 
 void ErrorReporter::setError(std::string const& msg,
                              std::optional<SourcePosition> position) {
+  if (m_errors.size() >= m_max_errors ||
+      ++m_message_counts[msg] > m_max_duplicates) {
+    ++m_suppressed;
+    return;
+  }
   m_errors.emplace_back(msg, position);
 }
 
-void ErrorReporter::clearErrors() { m_errors.clear(); }
+void ErrorReporter::addErrors(ErrorReporter const& other,
+                              std::uint64_t offset) {
+  for (auto const& error : other.m_errors) {
+    auto position = error.getPositon();
+    if (position.has_value()) {
+      position = position->withOffset(offset);
+    }
+    setError(error.getMessage(), position);
+  }
+  m_suppressed += other.m_suppressed;
+}
+
+void ErrorReporter::setLimits(std::size_t max_errors,
+                              std::size_t max_duplicates) {
+  m_max_errors = max_errors;
+  m_max_duplicates = max_duplicates;
+}
+
+void ErrorReporter::clearErrors() {
+  m_errors.clear();
+  m_message_counts.clear();
+  m_suppressed = 0;
+}
+
+namespace {
+// number of characters in the first bytes of a line, so that the error
+// indicator lines up with UTF-8 text
+auto displayColumn(std::string_view line, std::size_t bytes) -> std::size_t {
+  auto in_line = std::min(bytes, line.size());
+  auto continuations = std::count_if(
+      line.begin(), line.begin() + in_line,
+      [](char c) { return (static_cast<unsigned char>(c) & 0xC0) == 0x80; });
+  return bytes - continuations;
+}
+}  // namespace
 
 [[nodiscard]] auto ErrorReporter::defaultFormater(Error const& error,
-                                                  std::string_view source)
+                                                  LineIndex const& line_index,
+                                                  std::uint32_t first_line)
     -> std::string {
   auto error_string =
       fmt::format("{0} {1}\n", fmt::styled("error:", fmt::fg(fmt::color::red)),
@@ -41,8 +112,11 @@ void ErrorReporter::clearErrors() { m_errors.clear(); }
   auto error_position_opt = error.getPositon();
   if (error_position_opt.has_value()) {
     auto error_position = error_position_opt.value();
-    auto error_source = error_position.getSourceSubstr(source);
-    auto line_numbers_witdh = error_position.getEndLine() / 10 + 1;
+    auto error_source = line_index.getLines(error_position);
+    auto location = line_index.locate(error_position);
+    auto line_offset = first_line - 1;
+    auto line_numbers_witdh =
+        fmt::formatted_size("{}", line_offset + location.end_line);
 
     std::uint32_t line_index = 0;
     std::string_view::size_type prev_nl_position = 0;
@@ -53,21 +127,22 @@ void ErrorReporter::clearErrors() { m_errors.clear(); }
       auto line_source = error_source.substr(
           prev_nl_position, next_nl_positon - prev_nl_position);
 
-      std::uint32_t start_err = 0;
-      std::uint32_t end_err = line_source.size();
+      std::size_t start_err = 0;
+      std::size_t end_err = line_source.size();
       if (line_index == 0) {
-        start_err = error_position.getStartLinePosition();
+        start_err = location.start_column;
       }
-      if (line_index ==
-          error_position.getEndLine() - error_position.getStartLine()) {
-        end_err = error_position.getEndLinePosition();
+      if (line_index == location.end_line - location.start_line) {
+        end_err = location.end_column;
       } else {
         end_err = end_err == 0 ? end_err : end_err - 1;
       }
+      start_err = displayColumn(line_source, start_err);
+      end_err = displayColumn(line_source, end_err + 1) - 1;
 
       auto str_number_maring =
           fmt::format("{1:<{0}}", line_numbers_witdh,
-                      error_position.getStartLine() + line_index);
+                      line_offset + location.start_line + line_index);
 
       error_string += fmt::format(
           "{line_number_margin} | {line_source}\n{whitespace: <{padding_size}}"
@@ -97,4 +172,12 @@ void ErrorReporter::clearErrors() { m_errors.clear(); }
   return error_string;
 }
 
-void ErrorReporter::setSource(std::string_view source) { m_source = source; }
\ No newline at end of file
+void ErrorReporter::setSource(std::string_view source,
+                              std::uint32_t first_line,
+                              std::string_view line_prefix) {
+  m_source = source;
+  m_first_line = first_line;
+  m_line_prefix = line_prefix;
+  m_line_index.reset();
+  m_text.clear();
+}
\ No newline at end of file
@@ -1,12 +1,15 @@
 #ifndef CPPLOX_ERRORREPORTER_HPP
 #define CPPLOX_ERRORREPORTER_HPP
 
+#include <cstddef>
 #include <functional>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include "LineIndex.hpp"
 #include "SourcePosition.hpp"
 
 class Error {
@@ -28,31 +31,68 @@ class Error {
   }
 };
 
+/*
+Collects the errors of a run and formats them only when they are reported.
+The line index of the source is built the first time an error is formatted,
+at most max_errors errors are kept and a message is kept at most
+max_duplicates times, the others are only counted.
+*/
 class ErrorReporter {
  public:
-  using Formater = std::function<std::string(Error, std::string_view)>;
+  // formats an error of a source whose first line is numbered first_line
+  using Formater = std::function<std::string(Error const&, LineIndex const&,
+                                             std::uint32_t first_line)>;
+  // receives the formatted errors one by one
+  using Sink = std::function<void(std::string_view)>;
+
+  static constexpr std::size_t default_max_errors = 100;
+  static constexpr std::size_t default_max_duplicates = 10;
 
  private:
   std::vector<Error> m_errors;
+  std::unordered_map<std::string, std::size_t> m_message_counts;
+  std::size_t m_suppressed = 0;
+  std::size_t m_max_errors = default_max_errors;
+  std::size_t m_max_duplicates = default_max_duplicates;
+
   std::string_view m_source;
+  std::uint32_t m_first_line = 1;
+  std::string_view m_line_prefix;
+  // the line prefix followed by the source, joined to be indexed
+  mutable std::string m_text;
+  mutable std::optional<LineIndex> m_line_index;
   Formater m_formater;
 
  public:
   ErrorReporter(Formater formater = defaultFormater);
 
-  void setSource(std::string_view source);
+  // line_prefix is the start of the first line of the input, before source, for
+  // the sources that do not start a line: the errors show the whole line
+  void setSource(std::string_view source, std::uint32_t first_line = 1,
+                 std::string_view line_prefix = {});
+  void setLimits(std::size_t max_errors, std::size_t max_duplicates);
 
   [[nodiscard]] auto hasErrors() const -> bool;
+  [[nodiscard]] auto getSuppressedCount() const -> std::size_t;
+
+  // formats the errors into the sink, followed by a count of the suppressed
+  // ones if any
+  void report(Sink const& sink) const;
   [[nodiscard]] auto getErrors() const -> std::vector<std::string>;
 
   void setError(std::string const& msg,
                 std::optional<SourcePosition> position = std::nullopt);
 
+  // copies the errors of a reporter used for a part of the source starting
+  // offset bytes after the start of this reporter's source
+  void addErrors(ErrorReporter const& other, std::uint64_t offset);
+
   void clearErrors();
 
  private:
   [[nodiscard]] static auto defaultFormater(Error const& error,
-                                            std::string_view source)
+                                            LineIndex const& line_index,
+                                            std::uint32_t first_line)
       -> std::string;
 };
 
@@ -15,20 +15,41 @@ LiteralStringExpression::LiteralStringExpression(std::string_view value)
   return m_value;
 }
 
-VariableExpression::VariableExpression(
-    ValueToken<TokenType::TOKEN_IDENTIFIER>* identifier)
+Identifier::Identifier(SymbolTable::Symbol symbol, std::string_view name,
+                       SourcePosition position)
+    : m_symbol(symbol), m_name(name), m_position(position) {}
+
+[[nodiscard]] auto Identifier::getSymbol() const -> SymbolTable::Symbol {
+  return m_symbol;
+}
+
+[[nodiscard]] auto Identifier::getName() const -> std::string_view {
+  return m_name;
+}
+
+[[nodiscard]] auto Identifier::getPosition() const -> SourcePosition const& {
+  return m_position;
+}
+
+VariableExpression::VariableExpression(Identifier identifier)
     : m_identifier(identifier) {}
 
+[[nodiscard]] auto VariableExpression::getSymbol() const
+    -> SymbolTable::Symbol {
+  return m_identifier.getSymbol();
+}
+
 [[nodiscard]] auto VariableExpression::getName() const -> std::string_view {
-  return m_identifier->getValue();
+  return m_identifier.getName();
 }
 
 [[nodiscard]] auto VariableExpression::getIdentifier() const
-    -> ValueToken<TokenType::TOKEN_IDENTIFIER>* {
+    -> Identifier const& {
   return m_identifier;
 }
 
-GroupingExpression::GroupingExpression(Expression&& expr) : m_expr(expr) {}
+GroupingExpression::GroupingExpression(Expression&& expr)
+    : m_expr(std::move(expr)) {}
 
 [[nodiscard]] auto GroupingExpression::getExpression() const
     -> Expression const& {
@@ -38,9 +59,9 @@ GroupingExpression::GroupingExpression(Expression&& expr) : m_expr(expr) {}
 TernaryExpression::TernaryExpression(Expression&& condition,
                                      Expression&& true_expr,
                                      Expression&& false_expr)
-    : m_condition(condition),
-      m_true_expr(true_expr),
-      m_false_expr(false_expr) {}
+    : m_condition(std::move(condition)),
+      m_true_expr(std::move(true_expr)),
+      m_false_expr(std::move(false_expr)) {}
 
 [[nodiscard]] auto TernaryExpression::getConditionExpression() const
     -> Expression const& {
@@ -57,12 +78,15 @@ TernaryExpression::TernaryExpression(Expression&& condition,
   return m_false_expr;
 }
 
-AssignExpression::AssignExpression(
-    ValueToken<TokenType::TOKEN_IDENTIFIER>* identifier, Expression&& value)
-    : m_identifier(identifier), m_value(value) {}
+AssignExpression::AssignExpression(Identifier identifier, Expression&& value)
+    : m_identifier(identifier), m_value(std::move(value)) {}
+
+[[nodiscard]] auto AssignExpression::getSymbol() const -> SymbolTable::Symbol {
+  return m_identifier.getSymbol();
+}
 
 [[nodiscard]] auto AssignExpression::getName() const -> std::string_view {
-  return m_identifier->getValue();
+  return m_identifier.getName();
 }
 
 [[nodiscard]] auto AssignExpression::getValue() const -> Expression const& {
@@ -70,6 +94,6 @@ AssignExpression::AssignExpression(
 }
 
 [[nodiscard]] auto AssignExpression::getIdentifier() const
-    -> ValueToken<TokenType::TOKEN_IDENTIFIER>* {
+    -> Identifier const& {
   return m_identifier;
 }
\ No newline at end of file
@@ -1,11 +1,15 @@
 #ifndef CPPLOX_EXPRESSION_HPP
 #define CPPLOX_EXPRESSION_HPP
 
+#include <cstdint>
 #include <string_view>
+#include <utility>
 #include <variant>
 
-#include "./utils/Box.hpp"
+#include "SymbolTable.hpp"
 #include "Token.hpp"
+#include "utils/Arena.hpp"
+#include "utils/CopyCounter.hpp"
 
 /*
 NUMBER         → DIGIT+ ( "." DIGIT+ )? ;
@@ -40,6 +44,10 @@ class GroupingExpression;
 template <TokenType type>
   requires(type == TokenType::TOKEN_MINUS || type == TokenType::TOKEN_BANG)
 class UnaryExpression;
+// what is proven about the operands of a binary expression, whenever its
+// operator runs
+enum class OperandTypes : std::uint8_t { UNKNOWN, NUMBERS, STRINGS };
+
 template <TokenType type>
   requires(type == TokenType::TOKEN_EQUAL_EQUAL ||
            type == TokenType::TOKEN_BANG_EQUAL ||
@@ -55,27 +63,27 @@ class TernaryExpression;
 class AssignExpression;
 
 using Expression =
-    std::variant<Box<LiteralNumberExpression>, Box<LiteralStringExpression>,
-                 Box<LiteralExpression<TokenType::TOKEN_TRUE> >,
-                 Box<LiteralExpression<TokenType::TOKEN_FALSE> >,
-                 Box<LiteralExpression<TokenType::TOKEN_NIL> >,
-                 Box<VariableExpression>, Box<GroupingExpression>,
-                 Box<TernaryExpression>, Box<AssignExpression>,
-                 Box<UnaryExpression<TokenType::TOKEN_MINUS> >,
-                 Box<UnaryExpression<TokenType::TOKEN_BANG> >,
-                 Box<BinaryExpression<TokenType::TOKEN_EQUAL_EQUAL> >,
-                 Box<BinaryExpression<TokenType::TOKEN_BANG_EQUAL> >,
-                 Box<BinaryExpression<TokenType::TOKEN_LESS> >,
-                 Box<BinaryExpression<TokenType::TOKEN_LESS_EQUAL> >,
-                 Box<BinaryExpression<TokenType::TOKEN_GREATER> >,
-                 Box<BinaryExpression<TokenType::TOKEN_GREATER_EQUAL> >,
-                 Box<BinaryExpression<TokenType::TOKEN_PLUS> >,
-                 Box<BinaryExpression<TokenType::TOKEN_MINUS> >,
-                 Box<BinaryExpression<TokenType::TOKEN_STAR> >,
-                 Box<BinaryExpression<TokenType::TOKEN_SLASH> >,
-                 Box<BinaryExpression<TokenType::TOKEN_COMMA> > >;
-
-class LiteralNumberExpression {
+    std::variant<Node<LiteralNumberExpression>, Node<LiteralStringExpression>,
+                 Node<LiteralExpression<TokenType::TOKEN_TRUE> >,
+                 Node<LiteralExpression<TokenType::TOKEN_FALSE> >,
+                 Node<LiteralExpression<TokenType::TOKEN_NIL> >,
+                 Node<VariableExpression>, Node<GroupingExpression>,
+                 Node<TernaryExpression>, Node<AssignExpression>,
+                 Node<UnaryExpression<TokenType::TOKEN_MINUS> >,
+                 Node<UnaryExpression<TokenType::TOKEN_BANG> >,
+                 Node<BinaryExpression<TokenType::TOKEN_EQUAL_EQUAL> >,
+                 Node<BinaryExpression<TokenType::TOKEN_BANG_EQUAL> >,
+                 Node<BinaryExpression<TokenType::TOKEN_LESS> >,
+                 Node<BinaryExpression<TokenType::TOKEN_LESS_EQUAL> >,
+                 Node<BinaryExpression<TokenType::TOKEN_GREATER> >,
+                 Node<BinaryExpression<TokenType::TOKEN_GREATER_EQUAL> >,
+                 Node<BinaryExpression<TokenType::TOKEN_PLUS> >,
+                 Node<BinaryExpression<TokenType::TOKEN_MINUS> >,
+                 Node<BinaryExpression<TokenType::TOKEN_STAR> >,
+                 Node<BinaryExpression<TokenType::TOKEN_SLASH> >,
+                 Node<BinaryExpression<TokenType::TOKEN_COMMA> > >;
+
+class LiteralNumberExpression : CopyCounter {
   double m_value;
 
  public:
@@ -84,7 +92,7 @@ class LiteralNumberExpression {
   [[nodiscard]] auto getValue() const -> double;
 };
 
-class LiteralStringExpression {
+class LiteralStringExpression : CopyCounter {
   std::string_view m_value;
 
  public:
@@ -96,21 +104,36 @@ class LiteralStringExpression {
 template <TokenType type>
   requires(type == TokenType::TOKEN_TRUE || type == TokenType::TOKEN_FALSE ||
            type == TokenType::TOKEN_NIL)
-class LiteralExpression {};
+class LiteralExpression : CopyCounter {};
 
-class VariableExpression {
-  ValueToken<TokenType::TOKEN_IDENTIFIER> *m_identifier;
+// the name of an identifier is owned by the symbol table it is interned in
+class Identifier {
+  SymbolTable::Symbol m_symbol;
+  std::string_view m_name;
+  SourcePosition m_position;
 
  public:
-  VariableExpression(ValueToken<TokenType::TOKEN_IDENTIFIER> *identifier);
+  Identifier(SymbolTable::Symbol symbol, std::string_view name,
+             SourcePosition position);
 
+  [[nodiscard]] auto getSymbol() const -> SymbolTable::Symbol;
   [[nodiscard]] auto getName() const -> std::string_view;
+  [[nodiscard]] auto getPosition() const -> SourcePosition const &;
+};
+
+class VariableExpression : CopyCounter {
+  Identifier m_identifier;
+
+ public:
+  VariableExpression(Identifier identifier);
 
-  [[nodiscard]] auto getIdentifier() const
-      -> ValueToken<TokenType::TOKEN_IDENTIFIER> *;
+  [[nodiscard]] auto getSymbol() const -> SymbolTable::Symbol;
+  [[nodiscard]] auto getName() const -> std::string_view;
+
+  [[nodiscard]] auto getIdentifier() const -> Identifier const &;
 };
 
-class GroupingExpression {
+class GroupingExpression : CopyCounter {
   Expression m_expr;
 
  public:
@@ -121,19 +144,19 @@ class GroupingExpression {
 
 template <TokenType type>
   requires(type == TokenType::TOKEN_MINUS || type == TokenType::TOKEN_BANG)
-class UnaryExpression {
-  BasicToken<type> *m_operator;
+class UnaryExpression : CopyCounter {
+  SourcePosition m_operator;
   Expression m_right_expr;
 
  public:
-  UnaryExpression(BasicToken<type> *op, Expression &&expr)
-      : m_operator(op), m_right_expr(expr) {}
+  UnaryExpression(SourcePosition op, Expression &&expr)
+      : m_operator(op), m_right_expr(std::move(expr)) {}
 
   [[nodiscard]] auto getExpression() const -> Expression const & {
     return m_right_expr;
   }
 
-  [[nodiscard]] auto getOperator() const -> BasicToken<type> * {
+  [[nodiscard]] auto getOperator() const -> SourcePosition const & {
     return m_operator;
   }
 };
@@ -148,15 +171,18 @@ template <TokenType type>
            type == TokenType::TOKEN_PLUS || type == TokenType::TOKEN_MINUS ||
            type == TokenType::TOKEN_STAR || type == TokenType::TOKEN_SLASH ||
            type == TokenType::TOKEN_COMMA)
-class BinaryExpression {
+class BinaryExpression : CopyCounter {
   Expression m_left_expr;
-  BasicToken<type> *m_operator;
+  SourcePosition m_operator;
   Expression m_right_expr;
+  OperandTypes m_operand_types = OperandTypes::UNKNOWN;
 
  public:
-  BinaryExpression(Expression &&left_expr, BasicToken<type> *op,
+  BinaryExpression(Expression &&left_expr, SourcePosition op,
                    Expression &&right_expr)
-      : m_left_expr(left_expr), m_operator(op), m_right_expr(right_expr) {}
+      : m_left_expr(std::move(left_expr)),
+        m_operator(op),
+        m_right_expr(std::move(right_expr)) {}
 
   [[nodiscard]] auto getLeftExpression() const -> Expression const & {
     return m_left_expr;
@@ -166,10 +192,16 @@ class BinaryExpression {
     return m_right_expr;
   }
 
-  auto getOperator() const -> BasicToken<type> * { return m_operator; }
+  auto getOperator() const -> SourcePosition const & { return m_operator; }
+
+  [[nodiscard]] auto getOperandTypes() const -> OperandTypes {
+    return m_operand_types;
+  }
+  // set by the type inference, see TypeInference
+  void setOperandTypes(OperandTypes types) { m_operand_types = types; }
 };
 
-class TernaryExpression {
+class TernaryExpression : CopyCounter {
   Expression m_condition;
   Expression m_true_expr;
   Expression m_false_expr;
@@ -185,18 +217,17 @@ class TernaryExpression {
   [[nodiscard]] auto getFalseExpression() const -> Expression const &;
 };
 
-class AssignExpression {
-  ValueToken<TokenType::TOKEN_IDENTIFIER> *m_identifier;
+class AssignExpression : CopyCounter {
+  Identifier m_identifier;
   Expression m_value;
 
  public:
-  AssignExpression(ValueToken<TokenType::TOKEN_IDENTIFIER> *identifier,
-                   Expression &&value);
+  AssignExpression(Identifier identifier, Expression &&value);
 
+  [[nodiscard]] auto getSymbol() const -> SymbolTable::Symbol;
   [[nodiscard]] auto getName() const -> std::string_view;
   [[nodiscard]] auto getValue() const -> Expression const &;
-  [[nodiscard]] auto getIdentifier() const
-      -> ValueToken<TokenType::TOKEN_IDENTIFIER> *;
+  [[nodiscard]] auto getIdentifier() const -> Identifier const &;
 };
 
 #endif /* CPPLOX_EXPRESSION_HPP */
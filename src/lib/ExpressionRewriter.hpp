@@ -0,0 +1,105 @@
+#ifndef CPPLOX_EXPRESSIONREWRITER_HPP
+#define CPPLOX_EXPRESSIONREWRITER_HPP
+
+#include <cstdint>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "Expression.hpp"
+#include "ExpressionWalker.hpp"
+#include "utils/Arena.hpp"
+
+/*
+Base of the passes that rewrite expressions in postorder: Derived is walked by
+an ExpressionWalker and the rewritten operands of a node are on top of the
+stack when it is left. A node is rebuilt in the arena only when one of its
+operands changed. Derived hides the handlers of the nodes it rewrites and
+brings the others in with a using declaration.
+*/
+template <typename Derived>
+class ExpressionRewriter {
+  Arena &m_arena;
+  ExpressionWalker m_walker;
+  std::vector<Expression> m_rewritten;
+
+ public:
+  explicit ExpressionRewriter(Arena &arena) : m_arena(arena) {}
+
+  auto rewrite(Expression const &expr) -> Expression {
+    m_walker.walk(expr, static_cast<Derived &>(*this));
+    return pop();
+  }
+
+  void next([[maybe_unused]] Expression const &expr,
+            [[maybe_unused]] std::uint8_t operand) {}
+  void leave(Expression const &expr) {
+    m_rewritten.push_back(std::visit(static_cast<Derived &>(*this), expr));
+  }
+
+  auto operator()(Node<GroupingExpression> const &e) -> Expression {
+    auto expr = pop();
+    if (expr == e->getExpression()) {
+      return e;
+    }
+    return m_arena.make<GroupingExpression>(std::move(expr));
+  }
+
+  auto operator()(Node<TernaryExpression> const &e) -> Expression {
+    auto false_expr = pop();
+    auto true_expr = pop();
+    auto condition = pop();
+    if (condition == e->getConditionExpression() &&
+        true_expr == e->getTrueExpression() &&
+        false_expr == e->getFalseExpression()) {
+      return e;
+    }
+    return m_arena.make<TernaryExpression>(
+        std::move(condition), std::move(true_expr), std::move(false_expr));
+  }
+
+  auto operator()(Node<AssignExpression> const &e) -> Expression {
+    auto value = pop();
+    if (value == e->getValue()) {
+      return e;
+    }
+    return m_arena.make<AssignExpression>(e->getIdentifier(), std::move(value));
+  }
+
+  template <TokenType type>
+  auto operator()(Node<UnaryExpression<type> > const &e) -> Expression {
+    auto right = pop();
+    if (right == e->getExpression()) {
+      return e;
+    }
+    return m_arena.make<UnaryExpression<type> >(e->getOperator(),
+                                                std::move(right));
+  }
+
+  template <TokenType type>
+  auto operator()(Node<BinaryExpression<type> > const &e) -> Expression {
+    auto right = pop();
+    auto left = pop();
+    if (left == e->getLeftExpression() && right == e->getRightExpression()) {
+      return e;
+    }
+    return m_arena.make<BinaryExpression<type> >(
+        std::move(left), e->getOperator(), std::move(right));
+  }
+
+  template <typename T>
+  auto operator()(T const &e) -> Expression {
+    return e;
+  }
+
+ protected:
+  [[nodiscard]] inline auto getArena() -> Arena & { return m_arena; }
+
+  auto pop() -> Expression {
+    auto expr = m_rewritten.back();
+    m_rewritten.pop_back();
+    return expr;
+  }
+};
+
+#endif /* CPPLOX_EXPRESSIONREWRITER_HPP */
@@ -0,0 +1,96 @@
+#ifndef CPPLOX_EXPRESSIONWALKER_HPP
+#define CPPLOX_EXPRESSIONWALKER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+#include "Expression.hpp"
+
+/*
+Depth first walk of an expression with an explicit stack instead of native
+recursion, so that the depth of the expressions the parser builds is not
+limited by the size of the native stack.
+
+The visitor is called with next(expr, child) before every operand of expr but
+the first, and with leave(expr) once all of them were walked: leave sees the
+nodes in postorder. The stack is kept between walks.
+*/
+class ExpressionWalker {
+  struct Operands {
+    std::array<Expression const *, 3> items{};
+    std::uint8_t size = 0;
+
+    auto operator()(Node<GroupingExpression> const &e) -> void {
+      items = {&e->getExpression()};
+      size = 1;
+    }
+    auto operator()(Node<TernaryExpression> const &e) -> void {
+      items = {&e->getConditionExpression(), &e->getTrueExpression(),
+               &e->getFalseExpression()};
+      size = 3;
+    }
+    auto operator()(Node<AssignExpression> const &e) -> void {
+      items = {&e->getValue()};
+      size = 1;
+    }
+    template <TokenType type>
+    auto operator()(Node<UnaryExpression<type> > const &e) -> void {
+      items = {&e->getExpression()};
+      size = 1;
+    }
+    template <TokenType type>
+    auto operator()(Node<BinaryExpression<type> > const &e) -> void {
+      items = {&e->getLeftExpression(), &e->getRightExpression()};
+      size = 2;
+    }
+    template <typename T>
+    auto operator()([[maybe_unused]] T const &e) -> void {}
+  };
+
+  struct Frame {
+    Expression const *expr;
+    Operands operands;
+    std::uint8_t next;
+  };
+
+  std::vector<Frame> m_stack;
+
+ public:
+  template <typename Visitor>
+  void walk(Expression const &root, Visitor &visitor) {
+    auto const base = m_stack.size();
+    push(root, visitor);
+    while (m_stack.size() > base) {
+      auto &frame = m_stack.back();
+      if (frame.next == frame.operands.size) {
+        auto const &expr = *frame.expr;
+        m_stack.pop_back();
+        visitor.leave(expr);
+        continue;
+      }
+      if (frame.next > 0) {
+        visitor.next(*frame.expr, frame.next);
+      }
+      // frame is invalidated by the push
+      push(*frame.operands.items[frame.next++], visitor);
+    }
+  }
+
+ private:
+  // the leaves are left right away instead of going through the stack
+  template <typename Visitor>
+  void push(Expression const &expr, Visitor &visitor) {
+    Operands operands;
+    std::visit(operands, expr);
+    if (operands.size == 0) {
+      visitor.leave(expr);
+      return;
+    }
+    m_stack.push_back({&expr, operands, 0});
+  }
+};
+
+#endif /* CPPLOX_EXPRESSIONWALKER_HPP */
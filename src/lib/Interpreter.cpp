@@ -1,5 +1,7 @@
 #include "Interpreter.hpp"
 
+#include <fmt/core.h>
+
 #include "Environment.hpp"
 
 Interpreter::Interpreter(std::vector<Statement> const& statements,
@@ -12,9 +14,7 @@ Interpreter::Interpreter(std::vector<Statement> const& statements,
 auto Interpreter::interpret() -> std::optional<std::vector<std::string> const> {
   try {
     StatementVisitor v{*this, m_environment};
-    for (auto statement : m_statements) {
-      std::visit(v, statement);
-    }
+    m_walker.walk(m_statements, v);
     return v.getValues();
   } catch (Interpreter::InterpreterException& e) {
   } catch (Environment::EnvironmentException& e) {
@@ -24,13 +24,9 @@ auto Interpreter::interpret() -> std::optional<std::vector<std::string> const> {
   return std::nullopt;
 }
 
-auto Interpreter::error(std::optional<Token const*> token,
+auto Interpreter::error(std::optional<SourcePosition> position,
                         std::string const& msg) -> InterpreterException {
-  if (token.has_value()) {
-    m_error_reporter.setError(msg, token.value()->getPosition());
-  } else {
-    m_error_reporter.setError(msg);
-  }
+  m_error_reporter.setError(msg, position);
   return {msg};
 }
 
@@ -38,14 +34,16 @@ Interpreter::InterpreterException::InterpreterException(std::string const& what)
     : std::runtime_error("[InterpreterException]\n" + what) {}
 
 auto Interpreter::isTruthy(ExpressionValue const& value) -> bool {
-  TruthyVisitor v;
-  return std::visit(v, value);
+  return value.visit(TruthyVisitor{});
 }
 
 auto Interpreter::isEqual(ExpressionValue const& left_value,
                           ExpressionValue const& right_value) -> bool {
-  EqualityVisitor v;
-  return std::visit(v, left_value, right_value);
+  return Value::visit(EqualityVisitor{}, left_value, right_value);
+}
+
+auto Interpreter::stringify(ExpressionValue const& value) -> std::string {
+  return value.visit(StringifyVisitor{});
 }
 
 Interpreter::StatementVisitor::StatementVisitor(Interpreter& interpreter,
@@ -57,249 +55,566 @@ Interpreter::StatementVisitor::StatementVisitor(Interpreter& interpreter,
   return m_values;
 }
 
-auto Interpreter::StatementVisitor::operator()(Box<PrintStatement> const& s)
+auto Interpreter::StatementVisitor::operator()(Node<PrintStatement> const& s)
     -> void {
-  ExpressionVisitor expression_visitor{m_interpreter, m_env};
-  ExpressionValue value = std::visit(expression_visitor, s->getExpression());
-  StringifyVisitor stringify_visitor;
-  m_values.emplace_back(std::visit(stringify_visitor, value));
+  auto& env = environment();
+  // print x reads x in place instead of copying it through a tape
+  if (auto const* variable =
+          std::get_if<Node<VariableExpression> >(&s->getExpression())) {
+    m_values.emplace_back(stringify(m_interpreter.read(*variable, env)));
+    return;
+  }
+  ExpressionValue value = m_interpreter.evaluate(s->getExpression(), env);
+  m_values.emplace_back(stringify(value));
 }
 auto Interpreter::StatementVisitor::operator()(
-    Box<ExpressionStatement> const& s) -> void {
-  ExpressionVisitor expression_visitor{m_interpreter, m_env};
-  std::visit(expression_visitor, s->getExpression());
+    Node<ExpressionStatement> const& s) -> void {
+  m_interpreter.evaluate(s->getExpression(), environment());
 }
 
 auto Interpreter::StatementVisitor::operator()(
-    Box<VariableDeclaration> const& s) -> void {
-  auto initializer = s->getInitializer();
-  std::optional<ExpressionValue> value = std::nullopt;
-  if (initializer.has_value()) {
-    ExpressionVisitor expression_visitor{m_interpreter, m_env};
-    value = std::visit(expression_visitor, initializer.value());
-  }
-  m_env.define(s->getName(), value);
+    Node<VariableDeclaration> const& s) -> void {
+  auto& env = environment();
+  auto const& initializer = s->getInitializer();
+  auto value = initializer.has_value()
+                   ? m_interpreter.evaluate(initializer.value(), env)
+                   : ExpressionValue::undefined();
+  env.define(s->getSymbol(), std::move(value));
 }
 
-auto Interpreter::StatementVisitor::operator()(Box<BlockStatement> const& s)
-    -> void {
-  Environment env{m_interpreter.m_environment};
-  Interpreter::StatementVisitor visitor{m_interpreter, env};
-  for (auto statement : s->getStatements()) {
-    std::visit(visitor, statement);
-  }
-  for (auto const& v : visitor.getValues()) {
-    m_values.emplace_back(v);
-  }
+void Interpreter::StatementVisitor::enterBlock(
+    [[maybe_unused]] Node<BlockStatement> const& s) {
+  m_blocks.push_back(
+      std::make_unique<Environment>(m_interpreter.m_environment));
 }
 
-Interpreter::ExpressionVisitor::ExpressionVisitor(Interpreter& interpreter,
-                                                  Environment& env)
-    : m_interpreter(interpreter), m_env(env) {}
-
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<LiteralNumberExpression> const& e) -> ExpressionValue {
-  return e->getValue();
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    [[maybe_unused]] Box<LiteralStringExpression> const& e) -> ExpressionValue {
-  return std::string{e->getValue()};
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    [[maybe_unused]] Box<LiteralExpression<TokenType::TOKEN_TRUE>> const& e)
-    -> ExpressionValue {
-  return true;
+void Interpreter::StatementVisitor::leaveBlock(
+    [[maybe_unused]] Node<BlockStatement> const& s) {
+  m_blocks.pop_back();
 }
-auto Interpreter::ExpressionVisitor::operator()(
-    [[maybe_unused]] Box<LiteralExpression<TokenType::TOKEN_FALSE>> const& e)
-    -> ExpressionValue {
-  return false;
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    [[maybe_unused]] Box<LiteralExpression<TokenType::TOKEN_NIL>> const& e)
-    -> ExpressionValue {
-  return nullptr;
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<VariableExpression> const& e) -> ExpressionValue {
-  auto value = m_env.get(e);
-
-  if (value.has_value()) {
-    return value.value();
-  }
 
-  throw m_interpreter.error(
-      e->getIdentifier(), fmt::format("Undefined variable '{}'", e->getName()));
+auto Interpreter::StatementVisitor::environment() -> Environment& {
+  return m_blocks.empty() ? m_env : *m_blocks.back();
 }
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<GroupingExpression> const& e) -> ExpressionValue {
-  return std::visit(*this, e->getExpression());
-}
-auto Interpreter::ExpressionVisitor::operator()(Box<TernaryExpression> const& e)
-    -> ExpressionValue {
-  auto condition_value = std::visit(*this, e->getConditionExpression());
 
-  if (isTruthy(condition_value)) {
-    return std::visit(*this, e->getTrueExpression());
+auto Interpreter::read(Node<VariableExpression> const& variable,
+                       Environment& env) -> ExpressionValue& {
+  auto& value = env.find(variable);
+  if (value.isUndefined()) {
+    throw error(variable->getIdentifier().getPosition(),
+                fmt::format("Undefined variable '{}'", variable->getName()));
   }
-  return std::visit(*this, e->getFalseExpression());
-}
-auto Interpreter::ExpressionVisitor::operator()(Box<AssignExpression> const& e)
-    -> ExpressionValue {
-  auto value = std::visit(*this, e->getValue());
-  m_env.assign(e, value);
   return value;
 }
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<UnaryExpression<TokenType::TOKEN_MINUS>> const& e) -> ExpressionValue {
-  auto right_value = std::visit(*this, e->getExpression());
 
-  if (auto const* pval = std::get_if<double>(&right_value)) {
-    return -(*pval);
+template <Tape::OpCode code>
+void Interpreter::variables(std::span<Tape::Instruction const> instructions,
+                            std::size_t& pc, Environment& env) {
+  auto const& left = read(instructions[pc].variable, env);
+  auto const& right = read(instructions[pc + 1].variable, env);
+  pc += 2;
+  auto const& position = instructions[pc].position;
+  if constexpr (code == Tape::OpCode::EQUAL) {
+    m_stack.emplace_back(isEqual(left, right));
+  } else if constexpr (code == Tape::OpCode::NOT_EQUAL) {
+    m_stack.emplace_back(!isEqual(left, right));
+  } else if constexpr (code == Tape::OpCode::ADD) {
+    if (left.isNumber() && right.isNumber()) {
+      m_stack.emplace_back(left.getNumber() + right.getNumber());
+      return;
+    }
+    if (left.isString() && right.isString()) {
+      m_stack.push_back(ExpressionValue::concatenate(left, right));
+      return;
+    }
+    throw error(position, "Operands must be two numbers or two strings");
+  } else {
+    if (!left.isNumber() || !right.isNumber()) {
+      throw error(position, "Operands must be numbers");
+    }
+    auto l_val = left.getNumber();
+    auto r_val = right.getNumber();
+    switch (code) {
+      case Tape::OpCode::LESS:
+        m_stack.emplace_back(l_val < r_val);
+        break;
+      case Tape::OpCode::LESS_EQUAL:
+        m_stack.emplace_back(l_val <= r_val);
+        break;
+      case Tape::OpCode::GREATER:
+        m_stack.emplace_back(l_val > r_val);
+        break;
+      case Tape::OpCode::GREATER_EQUAL:
+        m_stack.emplace_back(l_val >= r_val);
+        break;
+      case Tape::OpCode::SUBTRACT:
+        m_stack.emplace_back(l_val - r_val);
+        break;
+      case Tape::OpCode::MULTIPLY:
+        m_stack.emplace_back(l_val * r_val);
+        break;
+      default:
+        m_stack.emplace_back(l_val / r_val);
+        break;
+    }
   }
-
-  throw m_interpreter.error(e->getOperator(), "Operand must be a number");
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<UnaryExpression<TokenType::TOKEN_BANG>> const& e) -> ExpressionValue {
-  auto right_value = std::visit(*this, e->getExpression());
-
-  return !isTruthy(right_value);
 }
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<BinaryExpression<TokenType::TOKEN_EQUAL_EQUAL>> const& e)
-    -> ExpressionValue {
-  auto left_value = std::visit(*this, e->getLeftExpression());
-  auto right_value = std::visit(*this, e->getRightExpression());
 
-  return isEqual(left_value, right_value);
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<BinaryExpression<TokenType::TOKEN_BANG_EQUAL>> const& e)
-    -> ExpressionValue {
-  auto left_value = std::visit(*this, e->getLeftExpression());
-  auto right_value = std::visit(*this, e->getRightExpression());
+// evaluates the nodes of an expression by native recursion, which costs less
+// than compiling them to a tape, and the nodes deeper than max_depth with the
+// tape. The operators do not check the operands the type inference proved.
+struct Interpreter::ExpressionVisitor {
+  static constexpr unsigned max_depth = 128;
 
-  return !isEqual(left_value, right_value);
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<BinaryExpression<TokenType::TOKEN_LESS>> const& e) -> ExpressionValue {
-  auto left_value = std::visit(*this, e->getLeftExpression());
-  auto right_value = std::visit(*this, e->getRightExpression());
+  Interpreter& m_interpreter;
+  Environment& m_env;
 
-  auto const* pl_val = std::get_if<double>(&left_value);
-  auto const* pr_val = std::get_if<double>(&right_value);
-  if ((pl_val != nullptr) && (pr_val != nullptr)) {
-    return *pl_val < *pr_val;
+  auto evaluate(Expression const& expr, unsigned depth) -> ExpressionValue {
+    if (depth == max_depth) {
+      return m_interpreter.run(expr, m_env);
+    }
+    return std::visit(
+        [this, depth](auto const& e) { return descend(e, depth + 1); }, expr);
   }
 
-  throw m_interpreter.error(e->getOperator(), "Operands must be numbers");
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<BinaryExpression<TokenType::TOKEN_LESS_EQUAL>> const& e)
-    -> ExpressionValue {
-  auto left_value = std::visit(*this, e->getLeftExpression());
-  auto right_value = std::visit(*this, e->getRightExpression());
-
-  auto const* pl_val = std::get_if<double>(&left_value);
-  auto const* pr_val = std::get_if<double>(&right_value);
-  if ((pl_val != nullptr) && (pr_val != nullptr)) {
-    return *pl_val <= *pr_val;
+  auto descend(Node<LiteralNumberExpression> const& e,
+               [[maybe_unused]] unsigned depth) -> ExpressionValue {
+    return e->getValue();
   }
-
-  throw m_interpreter.error(e->getOperator(), "Operands must be numbers");
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<BinaryExpression<TokenType::TOKEN_GREATER>> const& e)
-    -> ExpressionValue {
-  auto left_value = std::visit(*this, e->getLeftExpression());
-  auto right_value = std::visit(*this, e->getRightExpression());
-
-  auto const* pl_val = std::get_if<double>(&left_value);
-  auto const* pr_val = std::get_if<double>(&right_value);
-  if ((pl_val != nullptr) && (pr_val != nullptr)) {
-    return *pl_val > *pr_val;
+  auto descend(Node<LiteralStringExpression> const& e,
+               [[maybe_unused]] unsigned depth) -> ExpressionValue {
+    return ExpressionValue{e->getValue()};
   }
-
-  throw m_interpreter.error(e->getOperator(), "Operands must be numbers");
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<BinaryExpression<TokenType::TOKEN_GREATER_EQUAL>> const& e)
-    -> ExpressionValue {
-  auto left_value = std::visit(*this, e->getLeftExpression());
-  auto right_value = std::visit(*this, e->getRightExpression());
-
-  auto const* pl_val = std::get_if<double>(&left_value);
-  auto const* pr_val = std::get_if<double>(&right_value);
-  if ((pl_val != nullptr) && (pr_val != nullptr)) {
-    return *pl_val >= *pr_val;
+  auto descend(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_TRUE> > const& e,
+      [[maybe_unused]] unsigned depth) -> ExpressionValue {
+    return true;
   }
-
-  throw m_interpreter.error(e->getOperator(), "Operands must be numbers");
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<BinaryExpression<TokenType::TOKEN_PLUS>> const& e) -> ExpressionValue {
-  auto left_value = std::visit(*this, e->getLeftExpression());
-  auto right_value = std::visit(*this, e->getRightExpression());
-
-  auto const* left_double_ptr = std::get_if<double>(&left_value);
-  auto const* right_double_ptr = std::get_if<double>(&right_value);
-  if ((left_double_ptr != nullptr) && (right_double_ptr != nullptr)) {
-    return *left_double_ptr + *right_double_ptr;
+  auto descend(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_FALSE> > const&
+          e,
+      [[maybe_unused]] unsigned depth) -> ExpressionValue {
+    return false;
   }
-
-  auto const* left_string_ptr = std::get_if<std::string>(&left_value);
-  auto const* right_string_ptr = std::get_if<std::string>(&right_value);
-  if ((left_string_ptr != nullptr) && (right_string_ptr != nullptr)) {
-    return *left_string_ptr + *right_string_ptr;
+  auto descend(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_NIL> > const& e,
+      [[maybe_unused]] unsigned depth) -> ExpressionValue {
+    return nullptr;
+  }
+  auto descend(Node<VariableExpression> const& e,
+               [[maybe_unused]] unsigned depth) -> ExpressionValue {
+    return m_interpreter.read(e, m_env);
+  }
+  auto descend(Node<GroupingExpression> const& e, unsigned depth)
+      -> ExpressionValue {
+    return evaluate(e->getExpression(), depth);
+  }
+  auto descend(Node<TernaryExpression> const& e, unsigned depth)
+      -> ExpressionValue {
+    if (isTruthy(evaluate(e->getConditionExpression(), depth))) {
+      return evaluate(e->getTrueExpression(), depth);
+    }
+    return evaluate(e->getFalseExpression(), depth);
+  }
+  auto descend(Node<AssignExpression> const& e, unsigned depth)
+      -> ExpressionValue {
+    if (auto const* increment = incremented(e)) {
+      return *increment;
+    }
+    auto value = evaluate(e->getValue(), depth);
+    m_env.assign(e, value);
+    return value;
+  }
+  auto descend(Node<UnaryExpression<TokenType::TOKEN_MINUS> > const& e,
+               unsigned depth) -> ExpressionValue {
+    auto value = evaluate(e->getExpression(), depth);
+    if (!value.isNumber()) {
+      throw m_interpreter.error(e->getOperator(), "Operand must be a number");
+    }
+    return -value.getNumber();
+  }
+  auto descend(Node<UnaryExpression<TokenType::TOKEN_BANG> > const& e,
+               unsigned depth) -> ExpressionValue {
+    return !isTruthy(evaluate(e->getExpression(), depth));
+  }
+  auto descend(Node<BinaryExpression<TokenType::TOKEN_COMMA> > const& e,
+               unsigned depth) -> ExpressionValue {
+    evaluate(e->getLeftExpression(), depth);
+    return evaluate(e->getRightExpression(), depth);
+  }
+  template <TokenType type>
+  auto descend(Node<BinaryExpression<type> > const& e, unsigned depth)
+      -> ExpressionValue {
+    // x op y and x op n read their operands in place, as the
+    // superinstructions of the tape
+    if (auto const* variable = std::get_if<Node<VariableExpression> >(
+            &e->getLeftExpression())) {
+      auto const& right = e->getRightExpression();
+      if (auto const* other =
+              std::get_if<Node<VariableExpression> >(&right)) {
+        auto const& left = m_interpreter.read(*variable, m_env);
+        return apply(e, left, m_interpreter.read(*other, m_env));
+      }
+      if (auto const* number =
+              std::get_if<Node<LiteralNumberExpression> >(&right)) {
+        return apply(e, m_interpreter.read(*variable, m_env),
+                     (*number)->getValue());
+      }
+    }
+    auto left = evaluate(e->getLeftExpression(), depth);
+    auto right = evaluate(e->getRightExpression(), depth);
+    return apply(e, left, right);
   }
 
-  throw m_interpreter.error(e->getOperator(),
-                            "Operands must be two numbers or two strings");
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<BinaryExpression<TokenType::TOKEN_MINUS>> const& e) -> ExpressionValue {
-  auto left_value = std::visit(*this, e->getLeftExpression());
-  auto right_value = std::visit(*this, e->getRightExpression());
+  // runs x = x + n in the slot of x, nullptr when e is not of that shape
+  auto incremented(Node<AssignExpression> const& e) -> ExpressionValue* {
+    auto const* plus =
+        std::get_if<Node<BinaryExpression<TokenType::TOKEN_PLUS> > >(
+            &e->getValue());
+    if (plus == nullptr) {
+      return nullptr;
+    }
+    auto const* variable = std::get_if<Node<VariableExpression> >(
+        &(*plus)->getLeftExpression());
+    auto const* number = std::get_if<Node<LiteralNumberExpression> >(
+        &(*plus)->getRightExpression());
+    if (variable == nullptr || number == nullptr ||
+        (*variable)->getSymbol() != e->getSymbol()) {
+      return nullptr;
+    }
+    auto& value = m_interpreter.read(*variable, m_env);
+    if (!value.isNumber()) {
+      throw m_interpreter.error((*plus)->getOperator(),
+                                "Operands must be two numbers or two strings");
+    }
+    value = value.getNumber() + (*number)->getValue();
+    return &value;
+  }
 
-  auto const* pl_val = std::get_if<double>(&left_value);
-  auto const* pr_val = std::get_if<double>(&right_value);
-  if ((pl_val != nullptr) && (pr_val != nullptr)) {
-    return *pl_val - *pr_val;
+  // the operator of e on the values of its operands
+  template <TokenType type>
+  auto apply(Node<BinaryExpression<type> > const& e,
+             ExpressionValue const& left, ExpressionValue const& right)
+      -> ExpressionValue {
+    auto const types = e->getOperandTypes();
+    if constexpr (type == TokenType::TOKEN_EQUAL_EQUAL ||
+                  type == TokenType::TOKEN_BANG_EQUAL) {
+      auto equal = types == OperandTypes::NUMBERS
+                       ? left.getNumber() == right.getNumber()
+                   : types == OperandTypes::STRINGS
+                       ? left.getString() == right.getString()
+                       : isEqual(left, right);
+      return (type == TokenType::TOKEN_EQUAL_EQUAL) == equal;
+    } else if constexpr (type == TokenType::TOKEN_PLUS) {
+      if (types == OperandTypes::NUMBERS ||
+          (types == OperandTypes::UNKNOWN && left.isNumber() &&
+           right.isNumber())) {
+        return left.getNumber() + right.getNumber();
+      }
+      if (types == OperandTypes::STRINGS ||
+          (left.isString() && right.isString())) {
+        return ExpressionValue::concatenate(left, right);
+      }
+      throw m_interpreter.error(e->getOperator(),
+                                "Operands must be two numbers or two strings");
+    } else {
+      if (types != OperandTypes::NUMBERS &&
+          (!left.isNumber() || !right.isNumber())) {
+        throw m_interpreter.error(e->getOperator(), "Operands must be numbers");
+      }
+      auto l_val = left.getNumber();
+      auto r_val = right.getNumber();
+      switch (type) {
+        case TokenType::TOKEN_LESS:
+          return l_val < r_val;
+        case TokenType::TOKEN_LESS_EQUAL:
+          return l_val <= r_val;
+        case TokenType::TOKEN_GREATER:
+          return l_val > r_val;
+        case TokenType::TOKEN_GREATER_EQUAL:
+          return l_val >= r_val;
+        case TokenType::TOKEN_MINUS:
+          return l_val - r_val;
+        case TokenType::TOKEN_STAR:
+          return l_val * r_val;
+        default:
+          return l_val / r_val;
+      }
+    }
   }
+};
 
-  throw m_interpreter.error(e->getOperator(), "Operands must be numbers");
+auto Interpreter::evaluate(Expression const& expr, Environment& env)
+    -> ExpressionValue {
+  // the common subexpressions are only found while compiling a tape
+  if (m_tape.isSharing()) {
+    return run(expr, env);
+  }
+  return ExpressionVisitor{*this, env}.evaluate(expr, 0);
 }
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<BinaryExpression<TokenType::TOKEN_STAR>> const& e) -> ExpressionValue {
-  auto left_value = std::visit(*this, e->getLeftExpression());
-  auto right_value = std::visit(*this, e->getRightExpression());
 
-  auto const* pl_val = std::get_if<double>(&left_value);
-  auto const* pr_val = std::get_if<double>(&right_value);
-  if ((pl_val != nullptr) && (pr_val != nullptr)) {
-    return *pl_val * *pr_val;
+auto Interpreter::run(Expression const& expr, Environment& env)
+    -> ExpressionValue {
+  m_tape.compile(expr);
+  m_stack.clear();
+  m_temporaries.resize(m_tape.getTemporaries());
+
+  auto const instructions = m_tape.getInstructions();
+  for (std::size_t pc = 0; pc < instructions.size(); ++pc) {
+    auto const& instruction = instructions[pc];
+    switch (instruction.code) {
+      case Tape::OpCode::NUMBER:
+        m_stack.emplace_back(instruction.number);
+        break;
+      case Tape::OpCode::STRING:
+        m_stack.emplace_back(instruction.string->getValue());
+        break;
+      case Tape::OpCode::TRUE:
+        m_stack.emplace_back(true);
+        break;
+      case Tape::OpCode::FALSE:
+        m_stack.emplace_back(false);
+        break;
+      case Tape::OpCode::NIL:
+        m_stack.emplace_back(nullptr);
+        break;
+      case Tape::OpCode::GET:
+        m_stack.push_back(read(instruction.variable, env));
+        break;
+      case Tape::OpCode::SET:
+        env.assign(instruction.assignment, m_stack.back());
+        break;
+      case Tape::OpCode::NEGATE: {
+        auto& value = m_stack.back();
+        if (!value.isNumber()) {
+          throw error(instruction.position, "Operand must be a number");
+        }
+        value = -value.getNumber();
+        break;
+      }
+      case Tape::OpCode::NOT:
+        m_stack.back() = !isTruthy(m_stack.back());
+        break;
+      case Tape::OpCode::EQUAL:
+      case Tape::OpCode::NOT_EQUAL: {
+        auto equal = isEqual(m_stack.end()[-2], m_stack.back());
+        m_stack.pop_back();
+        m_stack.back() = (instruction.code == Tape::OpCode::EQUAL) == equal;
+        break;
+      }
+      case Tape::OpCode::LESS: {
+        auto [l, r] = numberOperands(instruction.position);
+        m_stack.back() = l < r;
+        break;
+      }
+      case Tape::OpCode::LESS_EQUAL: {
+        auto [l, r] = numberOperands(instruction.position);
+        m_stack.back() = l <= r;
+        break;
+      }
+      case Tape::OpCode::GREATER: {
+        auto [l, r] = numberOperands(instruction.position);
+        m_stack.back() = l > r;
+        break;
+      }
+      case Tape::OpCode::GREATER_EQUAL: {
+        auto [l, r] = numberOperands(instruction.position);
+        m_stack.back() = l >= r;
+        break;
+      }
+      case Tape::OpCode::ADD: {
+        auto& left_value = m_stack.end()[-2];
+        auto const& right_value = m_stack.back();
+        if (left_value.isNumber() && right_value.isNumber()) {
+          left_value = left_value.getNumber() + right_value.getNumber();
+          m_stack.pop_back();
+          break;
+        }
+        if (left_value.isString() && right_value.isString()) {
+          left_value = ExpressionValue::concatenate(left_value, right_value);
+          m_stack.pop_back();
+          break;
+        }
+        throw error(instruction.position,
+                    "Operands must be two numbers or two strings");
+      }
+      case Tape::OpCode::SUBTRACT: {
+        auto [l, r] = numberOperands(instruction.position);
+        m_stack.back() = l - r;
+        break;
+      }
+      case Tape::OpCode::MULTIPLY: {
+        auto [l, r] = numberOperands(instruction.position);
+        m_stack.back() = l * r;
+        break;
+      }
+      case Tape::OpCode::DIVIDE: {
+        auto [l, r] = numberOperands(instruction.position);
+        m_stack.back() = l / r;
+        break;
+      }
+      case Tape::OpCode::POP:
+        m_stack.pop_back();
+        break;
+      case Tape::OpCode::JUMP_IF_FALSE: {
+        auto condition = isTruthy(m_stack.back());
+        m_stack.pop_back();
+        if (!condition) {
+          pc = instruction.target - 1;
+        }
+        // the jumps leave no result to store
+        continue;
+      }
+      case Tape::OpCode::JUMP:
+        pc = instruction.target - 1;
+        continue;
+      case Tape::OpCode::LOAD:
+        m_stack.push_back(m_temporaries[instruction.temporary]);
+        break;
+      case Tape::OpCode::EQUAL_NUMBERS: {
+        auto [l, r] = provenNumbers();
+        m_stack.back() = l == r;
+        break;
+      }
+      case Tape::OpCode::NOT_EQUAL_NUMBERS: {
+        auto [l, r] = provenNumbers();
+        m_stack.back() = l != r;
+        break;
+      }
+      case Tape::OpCode::LESS_NUMBERS: {
+        auto [l, r] = provenNumbers();
+        m_stack.back() = l < r;
+        break;
+      }
+      case Tape::OpCode::LESS_EQUAL_NUMBERS: {
+        auto [l, r] = provenNumbers();
+        m_stack.back() = l <= r;
+        break;
+      }
+      case Tape::OpCode::GREATER_NUMBERS: {
+        auto [l, r] = provenNumbers();
+        m_stack.back() = l > r;
+        break;
+      }
+      case Tape::OpCode::GREATER_EQUAL_NUMBERS: {
+        auto [l, r] = provenNumbers();
+        m_stack.back() = l >= r;
+        break;
+      }
+      case Tape::OpCode::ADD_NUMBERS: {
+        auto [l, r] = provenNumbers();
+        m_stack.back() = l + r;
+        break;
+      }
+      case Tape::OpCode::SUBTRACT_NUMBERS: {
+        auto [l, r] = provenNumbers();
+        m_stack.back() = l - r;
+        break;
+      }
+      case Tape::OpCode::MULTIPLY_NUMBERS: {
+        auto [l, r] = provenNumbers();
+        m_stack.back() = l * r;
+        break;
+      }
+      case Tape::OpCode::DIVIDE_NUMBERS: {
+        auto [l, r] = provenNumbers();
+        m_stack.back() = l / r;
+        break;
+      }
+      case Tape::OpCode::EQUAL_STRINGS:
+      case Tape::OpCode::NOT_EQUAL_STRINGS: {
+        auto equal =
+            m_stack.end()[-2].getString() == m_stack.back().getString();
+        m_stack.pop_back();
+        m_stack.back() =
+            (instruction.code == Tape::OpCode::EQUAL_STRINGS) == equal;
+        break;
+      }
+      case Tape::OpCode::ADD_STRINGS:
+        m_stack.end()[-2] =
+            ExpressionValue::concatenate(m_stack.end()[-2], m_stack.back());
+        m_stack.pop_back();
+        break;
+      case Tape::OpCode::ADD_VARIABLE_NUMBER:
+      case Tape::OpCode::LESS_VARIABLE_NUMBER:
+      case Tape::OpCode::INCREMENT: {
+        auto& left = read(instruction.variable, env);
+        auto right = instructions[pc + 1].number;
+        auto const& op = instructions[pc + 2];
+        if (!left.isNumber()) {
+          throw error(op.position,
+                      instruction.code == Tape::OpCode::LESS_VARIABLE_NUMBER
+                          ? "Operands must be numbers"
+                          : "Operands must be two numbers or two strings");
+        }
+        if (instruction.code == Tape::OpCode::LESS_VARIABLE_NUMBER) {
+          m_stack.emplace_back(left.getNumber() < right);
+        } else if (instruction.code == Tape::OpCode::ADD_VARIABLE_NUMBER) {
+          m_stack.emplace_back(left.getNumber() + right);
+        } else {
+          left = left.getNumber() + right;
+          m_stack.push_back(left);
+          ++pc;
+        }
+        pc += 2;
+        break;
+      }
+      case Tape::OpCode::EQUAL_VARIABLES:
+        variables<Tape::OpCode::EQUAL>(instructions, pc, env);
+        break;
+      case Tape::OpCode::NOT_EQUAL_VARIABLES:
+        variables<Tape::OpCode::NOT_EQUAL>(instructions, pc, env);
+        break;
+      case Tape::OpCode::LESS_VARIABLES:
+        variables<Tape::OpCode::LESS>(instructions, pc, env);
+        break;
+      case Tape::OpCode::LESS_EQUAL_VARIABLES:
+        variables<Tape::OpCode::LESS_EQUAL>(instructions, pc, env);
+        break;
+      case Tape::OpCode::GREATER_VARIABLES:
+        variables<Tape::OpCode::GREATER>(instructions, pc, env);
+        break;
+      case Tape::OpCode::GREATER_EQUAL_VARIABLES:
+        variables<Tape::OpCode::GREATER_EQUAL>(instructions, pc, env);
+        break;
+      case Tape::OpCode::ADD_VARIABLES:
+        variables<Tape::OpCode::ADD>(instructions, pc, env);
+        break;
+      case Tape::OpCode::SUBTRACT_VARIABLES:
+        variables<Tape::OpCode::SUBTRACT>(instructions, pc, env);
+        break;
+      case Tape::OpCode::MULTIPLY_VARIABLES:
+        variables<Tape::OpCode::MULTIPLY>(instructions, pc, env);
+        break;
+      case Tape::OpCode::DIVIDE_VARIABLES:
+        variables<Tape::OpCode::DIVIDE>(instructions, pc, env);
+        break;
+    }
+    // pc is on the last instruction of a superinstruction
+    if (instructions[pc].store != 0) {
+      m_temporaries[instructions[pc].store - 1] = m_stack.back();
+    }
   }
+  return std::move(m_stack.back());
+}
 
-  throw m_interpreter.error(e->getOperator(), "Operands must be numbers");
+auto Interpreter::provenNumbers() -> std::pair<double, double> {
+  std::pair<double, double> operands{m_stack.end()[-2].getNumber(),
+                                     m_stack.back().getNumber()};
+  m_stack.pop_back();
+  return operands;
 }
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<BinaryExpression<TokenType::TOKEN_SLASH>> const& e) -> ExpressionValue {
-  auto left_value = std::visit(*this, e->getLeftExpression());
-  auto right_value = std::visit(*this, e->getRightExpression());
 
-  auto const* pl_val = std::get_if<double>(&left_value);
-  auto const* pr_val = std::get_if<double>(&right_value);
-  if ((pl_val != nullptr) && (pr_val != nullptr)) {
-    return *pl_val / *pr_val;
+auto Interpreter::numberOperands(SourcePosition const& position)
+    -> std::pair<double, double> {
+  auto const& left = m_stack.end()[-2];
+  auto const& right = m_stack.back();
+  if (!left.isNumber() || !right.isNumber()) {
+    throw error(position, "Operands must be numbers");
   }
-
-  throw m_interpreter.error(e->getOperator(), "Operands must be numbers");
-}
-auto Interpreter::ExpressionVisitor::operator()(
-    Box<BinaryExpression<TokenType::TOKEN_COMMA>> const& e) -> ExpressionValue {
-  std::visit(*this, e->getLeftExpression());
-  return std::visit(*this, e->getRightExpression());
+  std::pair<double, double> operands{left.getNumber(), right.getNumber()};
+  m_stack.pop_back();
+  return operands;
 }
 
 auto Interpreter::TruthyVisitor::operator()(bool const& v) -> bool { return v; }
@@ -308,7 +623,7 @@ auto Interpreter::TruthyVisitor::operator()([[maybe_unused]] double const& v)
   return true;
 }
 auto Interpreter::TruthyVisitor::operator()(
-    [[maybe_unused]] std::string const& v) -> bool {
+    [[maybe_unused]] std::string_view const& v) -> bool {
   return true;
 }
 auto Interpreter::TruthyVisitor::operator()(
@@ -327,7 +642,7 @@ auto Interpreter::EqualityVisitor::operator()(
 }
 auto Interpreter::EqualityVisitor::operator()(
     [[maybe_unused]] bool const& left,
-    [[maybe_unused]] std::string const& right) -> bool {
+    [[maybe_unused]] std::string_view const& right) -> bool {
   return false;
 }
 auto Interpreter::EqualityVisitor::operator()(
@@ -346,7 +661,7 @@ auto Interpreter::EqualityVisitor::operator()(double const& left,
 }
 auto Interpreter::EqualityVisitor::operator()(
     [[maybe_unused]] double const& left,
-    [[maybe_unused]] std::string const& right) -> bool {
+    [[maybe_unused]] std::string_view const& right) -> bool {
   return false;
 }
 auto Interpreter::EqualityVisitor::operator()(
@@ -355,22 +670,22 @@ auto Interpreter::EqualityVisitor::operator()(
   return false;
 }
 auto Interpreter::EqualityVisitor::operator()(
-    [[maybe_unused]] std::string const& left,
+    [[maybe_unused]] std::string_view const& left,
     [[maybe_unused]] bool const& right) -> bool {
   return false;
 }
 auto Interpreter::EqualityVisitor::operator()(
-    [[maybe_unused]] std::string const& left,
+    [[maybe_unused]] std::string_view const& left,
     [[maybe_unused]] double const& right) -> bool {
   return false;
 }
-auto Interpreter::EqualityVisitor::operator()(std::string const& left,
-                                              std::string const& right)
+auto Interpreter::EqualityVisitor::operator()(std::string_view const& left,
+                                              std::string_view const& right)
     -> bool {
   return left == right;
 }
 auto Interpreter::EqualityVisitor::operator()(
-    [[maybe_unused]] std::string const& left,
+    [[maybe_unused]] std::string_view const& left,
     [[maybe_unused]] std::nullptr_t const& right) -> bool {
   return false;
 }
@@ -386,7 +701,7 @@ auto Interpreter::EqualityVisitor::operator()(
 }
 auto Interpreter::EqualityVisitor::operator()(
     [[maybe_unused]] std::nullptr_t const& left,
-    [[maybe_unused]] std::string const& right) -> bool {
+    [[maybe_unused]] std::string_view const& right) -> bool {
   return false;
 }
 auto Interpreter::EqualityVisitor::operator()(
@@ -401,9 +716,9 @@ auto Interpreter::StringifyVisitor::operator()(bool const& v) -> std::string {
 auto Interpreter::StringifyVisitor::operator()(double const& v) -> std::string {
   return std::to_string(v);
 }
-auto Interpreter::StringifyVisitor::operator()(std::string const& v)
+auto Interpreter::StringifyVisitor::operator()(std::string_view const& v)
     -> std::string {
-  return v;
+  return std::string{v};
 }
 auto Interpreter::StringifyVisitor::operator()(
     [[maybe_unused]] std::nullptr_t const& v) -> std::string {
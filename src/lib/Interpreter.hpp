@@ -2,97 +2,60 @@
 #define CPPLOX_INTERPRETER_HPP
 
 // #include <cstddef>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include "ErrorReporter.hpp"
 #include "Expression.hpp"
 #include "Statement.hpp"
-#include "utils/Box.hpp"
+#include "StatementWalker.hpp"
+#include "Tape.hpp"
+#include "Value.hpp"
+#include "utils/Arena.hpp"
 
 class Environment;
 
 class Interpreter {
  public:
-  using ExpressionValue =
-      std::variant<bool, double, std::string, std::nullptr_t>;
+  using ExpressionValue = Value;
 
  private:
+  // runs the statements a StatementWalker visits, each block in an
+  // environment of its own
   struct StatementVisitor {
     StatementVisitor(Interpreter &interpreter, Environment &env);
 
-    auto operator()(Box<PrintStatement> const &s) -> void;
-    auto operator()(Box<ExpressionStatement> const &s) -> void;
-    auto operator()(Box<VariableDeclaration> const &s) -> void;
-    auto operator()(Box<BlockStatement> const &s) -> void;
+    auto operator()(Node<PrintStatement> const &s) -> void;
+    auto operator()(Node<ExpressionStatement> const &s) -> void;
+    auto operator()(Node<VariableDeclaration> const &s) -> void;
+    void enterBlock(Node<BlockStatement> const &s);
+    void leaveBlock(Node<BlockStatement> const &s);
 
     [[nodiscard]] auto getValues() const -> std::vector<std::string> const &;
 
    private:
+    // of the innermost block being run
+    auto environment() -> Environment &;
+
     Interpreter &m_interpreter;
     std::vector<std::string> m_values;
     Environment &m_env;
+    // of the blocks being run, innermost last
+    std::vector<std::unique_ptr<Environment> > m_blocks;
   };
 
-  struct ExpressionVisitor {
-    ExpressionVisitor(Interpreter &interpreter, Environment &env);
-
-    auto operator()(Box<LiteralNumberExpression> const &e) -> ExpressionValue;
-    auto operator()([[maybe_unused]] Box<LiteralStringExpression> const &e)
-        -> ExpressionValue;
-    auto operator()(
-        [[maybe_unused]] Box<LiteralExpression<TokenType::TOKEN_TRUE>> const &e)
-        -> ExpressionValue;
-    auto operator()(
-        [[maybe_unused]] Box<LiteralExpression<TokenType::TOKEN_FALSE>> const
-            &e) -> ExpressionValue;
-    auto operator()(
-        [[maybe_unused]] Box<LiteralExpression<TokenType::TOKEN_NIL>> const &e)
-        -> ExpressionValue;
-    auto operator()(Box<VariableExpression> const &e) -> ExpressionValue;
-    auto operator()(Box<GroupingExpression> const &e) -> ExpressionValue;
-    auto operator()(Box<TernaryExpression> const &e) -> ExpressionValue;
-    auto operator()(Box<AssignExpression> const &e) -> ExpressionValue;
-    auto operator()(Box<UnaryExpression<TokenType::TOKEN_MINUS>> const &e)
-        -> ExpressionValue;
-    auto operator()(Box<UnaryExpression<TokenType::TOKEN_BANG>> const &e)
-        -> ExpressionValue;
-    auto operator()(
-        Box<BinaryExpression<TokenType::TOKEN_EQUAL_EQUAL>> const &e)
-        -> ExpressionValue;
-    auto operator()(Box<BinaryExpression<TokenType::TOKEN_BANG_EQUAL>> const &e)
-        -> ExpressionValue;
-    auto operator()(Box<BinaryExpression<TokenType::TOKEN_LESS>> const &e)
-        -> ExpressionValue;
-    auto operator()(Box<BinaryExpression<TokenType::TOKEN_LESS_EQUAL>> const &e)
-        -> ExpressionValue;
-    auto operator()(Box<BinaryExpression<TokenType::TOKEN_GREATER>> const &e)
-        -> ExpressionValue;
-    auto operator()(
-        Box<BinaryExpression<TokenType::TOKEN_GREATER_EQUAL>> const &e)
-        -> ExpressionValue;
-    auto operator()(Box<BinaryExpression<TokenType::TOKEN_PLUS>> const &e)
-        -> ExpressionValue;
-    auto operator()(Box<BinaryExpression<TokenType::TOKEN_MINUS>> const &e)
-        -> ExpressionValue;
-    auto operator()(Box<BinaryExpression<TokenType::TOKEN_STAR>> const &e)
-        -> ExpressionValue;
-    auto operator()(Box<BinaryExpression<TokenType::TOKEN_SLASH>> const &e)
-        -> ExpressionValue;
-    auto operator()(Box<BinaryExpression<TokenType::TOKEN_COMMA>> const &e)
-        -> ExpressionValue;
-
-   private:
-    Interpreter &m_interpreter;
-    Environment &m_env;
-  };
+  struct ExpressionVisitor;
 
   struct TruthyVisitor {
     auto operator()(bool const &v) -> bool;
     auto operator()([[maybe_unused]] double const &v) -> bool;
-    auto operator()([[maybe_unused]] std::string const &v) -> bool;
+    auto operator()([[maybe_unused]] std::string_view const &v) -> bool;
     auto operator()([[maybe_unused]] std::nullptr_t const &v) -> bool;
   };
 
@@ -101,7 +64,7 @@ class Interpreter {
     auto operator()([[maybe_unused]] bool const &left,
                     [[maybe_unused]] double const &right) -> bool;
     auto operator()([[maybe_unused]] bool const &left,
-                    [[maybe_unused]] std::string const &right) -> bool;
+                    [[maybe_unused]] std::string_view const &right) -> bool;
     auto operator()([[maybe_unused]] bool const &left,
                     [[maybe_unused]] std::nullptr_t const &right) -> bool;
 
@@ -109,16 +72,17 @@ class Interpreter {
                     [[maybe_unused]] bool const &right) -> bool;
     auto operator()(double const &left, double const &right) -> bool;
     auto operator()([[maybe_unused]] double const &left,
-                    [[maybe_unused]] std::string const &right) -> bool;
+                    [[maybe_unused]] std::string_view const &right) -> bool;
     auto operator()([[maybe_unused]] double const &left,
                     [[maybe_unused]] std::nullptr_t const &right) -> bool;
 
-    auto operator()([[maybe_unused]] std::string const &left,
+    auto operator()([[maybe_unused]] std::string_view const &left,
                     [[maybe_unused]] bool const &right) -> bool;
-    auto operator()([[maybe_unused]] std::string const &left,
+    auto operator()([[maybe_unused]] std::string_view const &left,
                     [[maybe_unused]] double const &right) -> bool;
-    auto operator()(std::string const &left, std::string const &right) -> bool;
-    auto operator()([[maybe_unused]] std::string const &left,
+    auto operator()(std::string_view const &left,
+                    std::string_view const &right) -> bool;
+    auto operator()([[maybe_unused]] std::string_view const &left,
                     [[maybe_unused]] std::nullptr_t const &right) -> bool;
 
     auto operator()([[maybe_unused]] std::nullptr_t const &left,
@@ -126,7 +90,7 @@ class Interpreter {
     auto operator()([[maybe_unused]] std::nullptr_t const &left,
                     [[maybe_unused]] double const &right) -> bool;
     auto operator()([[maybe_unused]] std::nullptr_t const &left,
-                    [[maybe_unused]] std::string const &right) -> bool;
+                    [[maybe_unused]] std::string_view const &right) -> bool;
     auto operator()([[maybe_unused]] std::nullptr_t const &left,
                     [[maybe_unused]] std::nullptr_t const &right) -> bool;
   };
@@ -134,7 +98,7 @@ class Interpreter {
   struct StringifyVisitor {
     auto operator()(bool const &v) -> std::string;
     auto operator()([[maybe_unused]] double const &v) -> std::string;
-    auto operator()([[maybe_unused]] std::string const &v) -> std::string;
+    auto operator()([[maybe_unused]] std::string_view const &v) -> std::string;
     auto operator()([[maybe_unused]] std::nullptr_t const &v) -> std::string;
   };
 
@@ -142,6 +106,12 @@ class Interpreter {
   Environment &m_environment;
   ErrorReporter &m_error_reporter;
 
+  StatementWalker m_walker;
+  // the expression being evaluated and its values, kept between expressions
+  Tape m_tape;
+  std::vector<ExpressionValue> m_stack;
+  std::vector<ExpressionValue> m_temporaries;
+
  public:
   Interpreter(std::vector<Statement> const &statements,
               Environment &environment, ErrorReporter &error_reporter);
@@ -153,12 +123,37 @@ class Interpreter {
 
   auto interpret() -> std::optional<std::vector<std::string> const>;
 
- private:
+  // computes the common subexpressions of every expression once, see Tape
+  inline void setSharing(bool enabled) { m_tape.setSharing(enabled); }
+
+  // the semantics of the values, shared with the VirtualMachine
   static auto isTruthy(ExpressionValue const &value) -> bool;
   static auto isEqual(ExpressionValue const &left_value,
                       ExpressionValue const &right_value) -> bool;
+  static auto stringify(ExpressionValue const &value) -> std::string;
 
-  auto error(std::optional<Token const *> token, std::string const &msg)
+ private:
+  // evaluates expr by native recursion up to a depth and with the tape below
+  // it, or entirely with the tape while sharing
+  auto evaluate(Expression const &expr, Environment &env) -> ExpressionValue;
+  // runs the tape of expr, the native stack does not grow with its depth
+  auto run(Expression const &expr, Environment &env) -> ExpressionValue;
+  // the value of variable, which must be initialized
+  auto read(Node<VariableExpression> const &variable, Environment &env)
+      -> ExpressionValue &;
+  // runs the binary superinstruction on two variables at pc, which is moved to
+  // its last instruction
+  template <Tape::OpCode code>
+  void variables(std::span<Tape::Instruction const> instructions,
+                 std::size_t &pc, Environment &env);
+  // pops the right operand, the left one is replaced by the result
+  auto numberOperands(SourcePosition const &position)
+      -> std::pair<double, double>;
+  // numberOperands without the checks, for the operands the type inference
+  // proved to be numbers
+  auto provenNumbers() -> std::pair<double, double>;
+
+  auto error(std::optional<SourcePosition> position, std::string const &msg)
       -> InterpreterException;
 };
 
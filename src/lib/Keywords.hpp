@@ -0,0 +1,89 @@
+#ifndef CPPLOX_KEYWORDS_HPP
+#define CPPLOX_KEYWORDS_HPP
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+#include "Token.hpp"
+#include "utils/Enums.hpp"
+
+/*
+Perfect hash of the reserved words, built at compile time from the names of the
+TokenType values between TOKEN_AND and TOKEN_WHILE ("TOKEN_WHILE" -> "while").
+A lexeme is hashed from its length and its first and last characters, so a
+lookup is one probe in the table and one comparison.
+*/
+namespace Keywords {
+constexpr std::size_t max_length = 8;
+constexpr std::size_t table_size = 32;
+
+struct Entry {
+  std::array<char, max_length> spelling{};
+  std::size_t length = 0;
+  TokenType type = TokenType::TOKEN_IDENTIFIER;
+};
+
+constexpr auto is_keyword(TokenType type) -> bool {
+  return type >= TokenType::TOKEN_AND && type <= TokenType::TOKEN_WHILE;
+}
+
+constexpr auto hash(std::size_t length, char first, char last) -> std::size_t {
+  return (length + static_cast<std::size_t>(first) * 7 +
+          static_cast<std::size_t>(last)) %
+         table_size;
+}
+
+constexpr auto spelling(std::string_view name) -> Entry {
+  constexpr std::string_view prefix = "TOKEN_";
+  name.remove_prefix(prefix.size());
+
+  Entry entry;
+  entry.length = name.size();
+  for (std::size_t i = 0; i < name.size(); ++i) {
+    entry.spelling[i] = static_cast<char>(name[i] - 'A' + 'a');
+  }
+  return entry;
+}
+
+constexpr auto build() {
+  std::array<Entry, table_size> table{};
+  for (auto const &[type, name] : Enums::entries_v<TokenType>) {
+    if (!is_keyword(type)) {
+      continue;
+    }
+
+    auto entry = spelling(name);
+    entry.type = type;
+
+    auto &slot = table[hash(entry.length, entry.spelling[0],
+                            entry.spelling[entry.length - 1])];
+    if (slot.length != 0) {
+      throw "keyword hash collision";
+    }
+    slot = entry;
+  }
+  return table;
+}
+
+inline constexpr auto table_v = build();
+
+constexpr auto lookup(std::string_view lexeme) -> TokenType {
+  if (lexeme.size() < 2 || lexeme.size() > max_length) {
+    return TokenType::TOKEN_IDENTIFIER;
+  }
+
+  auto const &entry =
+      table_v[hash(lexeme.size(), lexeme.front(), lexeme.back())];
+  if (std::string_view{entry.spelling.data(), entry.length} == lexeme) {
+    return entry.type;
+  }
+  return TokenType::TOKEN_IDENTIFIER;
+}
+
+static_assert(lookup("while") == TokenType::TOKEN_WHILE);
+static_assert(lookup("and") == TokenType::TOKEN_AND);
+static_assert(lookup("whale") == TokenType::TOKEN_IDENTIFIER);
+}  // namespace Keywords
+
+#endif /* CPPLOX_KEYWORDS_HPP */
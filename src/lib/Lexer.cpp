@@ -1,33 +1,52 @@
 #include "Lexer.hpp"
 
+#include <algorithm>
 #include <charconv>
+#include <exception>
+#include <vector>
 
-Lexer::Lexer(std::string_view source, ErrorReporter &error_reporter)
-    : m_source(source), m_error_reporter(error_reporter) {}
+#include "Keywords.hpp"
+#include "LexerTable.hpp"
+#include "utils/Scan.hpp"
+
+Lexer::Lexer(std::string_view source, ErrorReporter &error_reporter,
+             SymbolTable &symbols)
+    : m_source(source),
+      m_error_reporter(error_reporter),
+      m_symbols(symbols) {}
 
 [[nodiscard]] auto Lexer::isAtEnd() const -> bool {
   return m_cur_cursor >= m_source.size();
 }
 
-void Lexer::nextLine() {
-  ++m_current_line;
-  m_current_line_position = 0;
+void Lexer::moveCursor(std::size_t i) { m_cur_cursor += i; }
+
+void Lexer::moveCursorTo(char const *it) {
+  m_cur_cursor = it - m_source.data();
 }
 
-void Lexer::moveCursor(std::uint32_t i) {
-  m_cur_cursor += i;
-  m_current_line_position += i;
+auto Lexer::cursor() const -> char const * {
+  return m_source.data() + m_cur_cursor;
 }
 
-auto Lexer::scanTokens() -> std::optional<
-    std::reference_wrapper<std::vector<std::unique_ptr<Token> > > > {
-  try {
-    while (!isAtEnd() && !m_error_reporter.hasErrors()) {
-      scanToken();
-      m_prev_cursor = m_cur_cursor;
+auto Lexer::end() const -> char const * {
+  return m_source.data() + m_source.size();
+}
+
+auto Lexer::scanTokens(unsigned int threads)
+    -> std::optional<std::reference_wrapper<TokenBuffer> > {
+  if (m_source.size() > SourcePosition::max_offset) {
+    m_error_reporter.setError("Source is too large");
+    return std::nullopt;
+  }
 
-      m_start_line = m_current_line;
-      m_start_line_position = m_current_line_position;
+  try {
+    auto chunks =
+        std::min<std::size_t>(threads, m_source.size() / parallel_chunk_size);
+    if (chunks > 1) {
+      scanParallel(chunks);
+    } else {
+      scan();
     }
     return m_tokens;
   } catch (std::exception &e) {
@@ -36,87 +55,229 @@ auto Lexer::scanTokens() -> std::optional<
   }
 }
 
-void Lexer::scanToken()  // NOLINT(readability-function-cognitive-complexity)
-{
-  if (match('(')) {
-    addToken<TokenType::TOKEN_LEFT_PAREN>();
-  } else if (match(')')) {
-    addToken<TokenType::TOKEN_RIGHT_PAREN>();
-  } else if (match('{')) {
-    addToken<TokenType::TOKEN_LEFT_BRACE>();
-  } else if (match('}')) {
-    addToken<TokenType::TOKEN_RIGHT_BRACE>();
-  } else if (match(',')) {
-    addToken<TokenType::TOKEN_COMMA>();
-  } else if (match('.')) {
-    addToken<TokenType::TOKEN_DOT>();
-  } else if (match('-')) {
-    addToken<TokenType::TOKEN_MINUS>();
-  } else if (match('+')) {
-    addToken<TokenType::TOKEN_PLUS>();
-  } else if (match(';')) {
-    addToken<TokenType::TOKEN_SEMICOLON>();
-  } else if (match('*')) {
-    addToken<TokenType::TOKEN_STAR>();
-  } else if (match('?')) {
-    addToken<TokenType::TOKEN_QUESTION>();
-  } else if (match(':')) {
-    addToken<TokenType::TOKEN_COLON>();
-  } else if (match('!')) {
-    if (match('=')) {
-      addToken<TokenType::TOKEN_BANG_EQUAL>();
-    } else {
-      addToken<TokenType::TOKEN_BANG>();
+void Lexer::scan() {
+  // a token is on average a few bytes long, avoid regrowing the arrays but do
+  // not allocate gigabytes upfront for huge, possibly mostly comment, sources
+  m_tokens.reserve(std::min<std::size_t>(m_source.size() / 4, 1 << 24));
+
+  while (!isAtEnd() && !m_error_reporter.hasErrors()) {
+    if (m_cur_cursor >= m_validated && !validate()) {
+      break;
     }
-  } else if (match('=')) {
-    if (match('=')) {
-      addToken<TokenType::TOKEN_EQUAL_EQUAL>();
-    } else {
-      addToken<TokenType::TOKEN_EQUAL>();
+
+    scanToken();
+    m_prev_cursor = m_cur_cursor;
+
+    if (m_progress && m_cur_cursor - m_reported >= progress_step) {
+      reportProgress();
     }
-  } else if (match('<')) {
-    if (match('=')) {
-      addToken<TokenType::TOKEN_LESS_EQUAL>();
-    } else {
-      addToken<TokenType::TOKEN_LESS>();
+  }
+  // the end of the last token is not validated yet
+  if (!m_error_reporter.hasErrors() && m_validated < m_source.size()) {
+    validate();
+  }
+  if (m_progress) {
+    reportProgress();
+  }
+}
+
+auto Lexer::validate() -> bool {
+  if (m_invalid) {
+    m_error_reporter.setError("Invalid UTF-8 sequence",
+                              SourcePosition{m_validated, 1});
+    return false;
+  }
+
+  auto window_end = std::min(m_source.size(),
+                             std::max(m_validated, m_cur_cursor) +
+                                 validation_window);
+  // do not cut a character in two
+  while (window_end < m_source.size() &&
+         (static_cast<unsigned char>(m_source[window_end]) & 0xC0) == 0x80) {
+    ++window_end;
+  }
+
+  auto const *begin = m_source.data();
+  auto const *invalid =
+      Scan::validateUtf8(begin + m_validated, begin + window_end);
+  m_validated = invalid - begin;
+  m_invalid = invalid != begin + window_end;
+  // the lexer may already be on the invalid sequence, or past it within a
+  // string
+  if (m_invalid && m_cur_cursor >= m_validated) {
+    return validate();
+  }
+  return true;
+}
+
+void Lexer::setProgress(Progress progress) {
+  m_progress = std::move(progress);
+}
+
+void Lexer::reportProgress() {
+  if (m_cur_cursor > m_reported) {
+    m_progress(m_reported, m_cur_cursor - m_reported);
+    m_reported = m_cur_cursor;
+  }
+}
+
+namespace {
+// splits the source in about count chunks ending on a newline outside of any
+// string or comment, so that each chunk can be lexed on its own
+auto findChunkBoundaries(std::string_view source, std::size_t count)
+    -> std::vector<std::size_t> {
+  std::vector<std::size_t> boundaries{0};
+
+  auto const *begin = source.data();
+  auto const *end = begin + source.size();
+  auto const step = source.size() / count;
+  auto const *target = begin + step;
+
+  for (auto const *it = begin; it != end && boundaries.size() < count;) {
+    auto const *next = Scan::findEither(it, end, '"', '/');
+
+    // [it, next) is code, any newline past the target is a boundary
+    if (next > target) {
+      auto const *newline = Scan::findByte(std::max(it, target), next, '\n');
+      if (newline != next) {
+        it = newline + 1;
+        boundaries.push_back(it - begin);
+        target = std::max(begin + step * boundaries.size(), it);
+        continue;
+      }
+    }
+
+    if (next == end) {
+      break;
     }
-  } else if (match('>')) {
-    if (match('=')) {
-      addToken<TokenType::TOKEN_GREATER_EQUAL>();
+    if (*next == '"') {
+      it = Scan::findByte(next + 1, end, '"');
+      it = it == end ? end : it + 1;
+    } else if (next + 1 != end && next[1] == '/') {
+      it = Scan::findByte(next + 2, end, '\n');
+    } else if (next + 1 != end && next[1] == '*') {
+      it = Scan::findBlockCommentEnd(next + 2, end);
+      it = it == end ? end : it + 2;
     } else {
-      addToken<TokenType::TOKEN_GREATER>();
+      it = next + 1;
     }
-  } else if (match('/')) {
-    if (match('*')) {
-      while (!isAtEnd() && (peek() != '*' || peekNext() != '/')) {
-        if (match('\n')) {
-          nextLine();
-        } else {
-          moveCursor(1);
-        }
-      }
-      if (!isAtEnd()) {
-        moveCursor(2);
-      }
-    } else if (match('/')) {
-      while (!isAtEnd() && peek() != '\n') {
-        moveCursor(1);
+  }
+
+  if (boundaries.back() != source.size()) {
+    boundaries.push_back(source.size());
+  }
+  return boundaries;
+}
+}  // namespace
+
+void Lexer::scanParallel(std::size_t chunks) {
+  auto boundaries = findChunkBoundaries(m_source, chunks);
+  auto count = boundaries.size() - 1;
+
+  // identifiers are interned in a table per chunk, then in m_symbols in order
+  std::vector<ErrorReporter> error_reporters(count);
+  std::vector<SymbolTable> symbol_tables(count);
+  std::vector<Lexer> lexers;
+  lexers.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    lexers.emplace_back(
+        m_source.substr(boundaries[i], boundaries[i + 1] - boundaries[i]),
+        error_reporters[i], symbol_tables[i]);
+    if (m_progress) {
+      lexers.back().setProgress(
+          [this, offset = boundaries[i]](std::size_t start, std::size_t size) {
+            m_progress(offset + start, size);
+          });
+    }
+  }
+
+  std::vector<std::exception_ptr> exceptions(count);
+  std::vector<std::thread> workers;
+  workers.reserve(count - 1);
+  for (std::size_t i = 1; i < count; ++i) {
+    workers.emplace_back([&lexer = lexers[i], &exception = exceptions[i]] {
+      try {
+        lexer.scan();
+      } catch (...) {
+        exception = std::current_exception();
       }
-    } else {
-      addToken<TokenType::TOKEN_SLASH>();
+    });
+  }
+  lexers[0].scan();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  for (auto const &exception : exceptions) {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+
+  std::size_t size = 0;
+  for (auto const &lexer : lexers) {
+    size += lexer.m_tokens.size();
+  }
+  m_tokens.reserve(size);
+
+  // positions are relative to the start of each chunk and identifiers to its
+  // symbol table
+  for (std::size_t i = 0; i < count; ++i) {
+    auto offset = boundaries[i];
+    auto const &symbols = symbol_tables[i];
+    std::vector<SymbolTable::Symbol> remap(symbols.size());
+    for (SymbolTable::Symbol symbol = 0; symbol < symbols.size(); ++symbol) {
+      remap[symbol] =
+          m_symbols.intern(symbols.getName(symbol), symbols.getHash(symbol));
+    }
+    m_tokens.append(lexers[i].m_tokens, offset, remap);
+    if (error_reporters[i].hasErrors()) {
+      m_error_reporter.addErrors(error_reporters[i], offset);
+      break;
     }
-  } else if (match('"')) {
-    string();
-  } else if (std::isdigit(peek()) != 0) {
-    number();
-  } else if (peek() == '_' || std::isalpha(peek()) != 0) {
-    identifier();
-  } else if (match('\n')) {
-    nextLine();
-  } else if (std::isspace(peek()) != 0) {
-    moveCursor(1);
-  } else {
-    error("Unexpected character");
+  }
+}
+
+void Lexer::scanToken() {
+  auto const &entry = LexerTable::lookup(peek());
+
+  switch (entry.action) {
+    case LexerTable::Action::WHITESPACE:
+      moveCursorTo(Scan::skipWhitespace(cursor(), end()));
+      break;
+    case LexerTable::Action::SINGLE:
+      moveCursor(1);
+      addToken(entry.single);
+      break;
+    case LexerTable::Action::PAIR:
+      moveCursor(1);
+      addToken(match(entry.second) ? entry.pair : entry.single);
+      break;
+    case LexerTable::Action::SLASH:
+      moveCursor(1);
+      if (match('*')) {
+        moveCursorTo(Scan::findBlockCommentEnd(cursor(), end()));
+        if (!isAtEnd()) {
+          moveCursor(2);
+        }
+      } else if (match('/')) {
+        moveCursorTo(Scan::findByte(cursor(), end(), '\n'));
+      } else {
+        addToken<TokenType::TOKEN_SLASH>();
+      }
+      break;
+    case LexerTable::Action::STRING:
+      moveCursor(1);
+      string();
+      break;
+    case LexerTable::Action::DIGIT:
+      number();
+      break;
+    case LexerTable::Action::ALPHA:
+      identifier();
+      break;
+    case LexerTable::Action::INVALID:
+      error("Unexpected character");
+      break;
   }
 }
 
@@ -132,42 +293,40 @@ void Lexer::scanToken()  // NOLINT(readability-function-cognitive-complexity)
   if (isAtEnd()) {
     return '\0';
   }
-  return m_source.at(m_cur_cursor);
+  return m_source[m_cur_cursor];
 }
 
 [[nodiscard]] auto Lexer::peekNext() const -> char {
   if (m_cur_cursor + 1 >= m_source.size()) {
     return '\0';
   }
-  return m_source.at(m_cur_cursor + 1);
+  return m_source[m_cur_cursor + 1];
 }
 
 void Lexer::string() {
-  while (!isAtEnd()) {
-    if (match('"')) {
-      auto string =
-          m_source.substr(m_prev_cursor + 1, m_cur_cursor - m_prev_cursor - 2);
-      addToken<TokenType::TOKEN_STRING>(string);
-      return;
-    }
+  moveCursorTo(Scan::findByte(cursor(), end(), '"'));
 
-    if (match('\n')) {
-      nextLine();
-    } else {
-      moveCursor(1);
-    }
+  if (match('"')) {
+    auto string =
+        m_source.substr(m_prev_cursor + 1, m_cur_cursor - m_prev_cursor - 2);
+    addToken<TokenType::TOKEN_STRING>(string);
+    return;
   }
 
   error("Unterminated string");
 }
 
+namespace {
+constexpr auto isDigit(char c) -> bool { return c >= '0' && c <= '9'; }
+}  // namespace
+
 void Lexer::number() {
-  while (!isAtEnd() && std::isdigit(m_source.at(m_cur_cursor)) != 0) {
+  while (!isAtEnd() && isDigit(m_source[m_cur_cursor])) {
     moveCursor(1);
   }
 
-  if ((std::isdigit(peekNext()) != 0) && match('.')) {
-    while (!isAtEnd() && std::isdigit(m_source.at(m_cur_cursor)) != 0) {
+  if (isDigit(peekNext()) && match('.')) {
+    while (!isAtEnd() && isDigit(m_source[m_cur_cursor])) {
       moveCursor(1);
     }
   }
@@ -185,53 +344,18 @@ void Lexer::number() {
 }
 
 void Lexer::identifier() {
-  for (auto next = peek(); std::isalnum(next) != 0 || next == '_';
-       next = peek()) {
-    moveCursor(1);
-  }
+  moveCursorTo(Scan::skipIdentifier(cursor(), end()));
 
   auto lexeme = m_source.substr(m_prev_cursor, m_cur_cursor - m_prev_cursor);
 
-  if (lexeme == "and") {
-    addToken<TokenType::TOKEN_AND>();
-  } else if (lexeme == "class") {
-    addToken<TokenType::TOKEN_CLASS>();
-  } else if (lexeme == "else") {
-    addToken<TokenType::TOKEN_ELSE>();
-  } else if (lexeme == "false") {
-    addToken<TokenType::TOKEN_FALSE>();
-  } else if (lexeme == "fun") {
-    addToken<TokenType::TOKEN_FUN>();
-  } else if (lexeme == "for") {
-    addToken<TokenType::TOKEN_FOR>();
-  } else if (lexeme == "if") {
-    addToken<TokenType::TOKEN_IF>();
-  } else if (lexeme == "nil") {
-    addToken<TokenType::TOKEN_NIL>();
-  } else if (lexeme == "or") {
-    addToken<TokenType::TOKEN_OR>();
-  } else if (lexeme == "print") {
-    addToken<TokenType::TOKEN_PRINT>();
-  } else if (lexeme == "return") {
-    addToken<TokenType::TOKEN_RETURN>();
-  } else if (lexeme == "super") {
-    addToken<TokenType::TOKEN_SUPER>();
-  } else if (lexeme == "this") {
-    addToken<TokenType::TOKEN_THIS>();
-  } else if (lexeme == "true") {
-    addToken<TokenType::TOKEN_TRUE>();
-  } else if (lexeme == "var") {
-    addToken<TokenType::TOKEN_VAR>();
-  } else if (lexeme == "while") {
-    addToken<TokenType::TOKEN_WHILE>();
+  auto type = Keywords::lookup(lexeme);
+  if (type == TokenType::TOKEN_IDENTIFIER) {
+    addToken<TokenType::TOKEN_IDENTIFIER>(m_symbols.intern(lexeme));
   } else {
-    addToken<TokenType::TOKEN_IDENTIFIER>(lexeme);
+    addToken(type);
   }
 }
 
 void Lexer::error(std::string const &error_msg) {
-  m_error_reporter.setError(
-      error_msg,
-      SourcePosition(m_start_line, m_current_line, m_start_line_position,
-                     m_current_line_position));
+  m_error_reporter.setError(error_msg, tokenPosition());
 }
\ No newline at end of file
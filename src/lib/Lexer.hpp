@@ -1,75 +1,101 @@
 #ifndef CPPLOX_LEXER_HPP
 #define CPPLOX_LEXER_HPP
 
-#include <memory>
+#include <cstddef>
+#include <functional>
 #include <optional>
 #include <string_view>
-#include <vector>
+#include <thread>
 
 #include "ErrorReporter.hpp"
 #include "SourcePosition.hpp"
+#include "SymbolTable.hpp"
 #include "Token.hpp"
 
 class Lexer {
-  std::vector<std::unique_ptr<Token> > m_tokens;
+  TokenBuffer m_tokens;
   std::string_view m_source;
   ErrorReporter &m_error_reporter;
+  SymbolTable &m_symbols;
 
-  std::uint32_t m_prev_cursor = 0;
-  std::uint32_t m_cur_cursor = 0;
+  std::size_t m_prev_cursor = 0;
+  std::size_t m_cur_cursor = 0;
+  // the source is valid UTF-8 up to there, an invalid sequence starts there
+  // when m_invalid is set
+  std::size_t m_validated = 0;
+  bool m_invalid = false;
 
-  std::uint32_t m_start_line = 1;
-  std::uint32_t m_current_line = m_start_line;
-  std::uint32_t m_start_line_position = 0;
-  std::uint32_t m_current_line_position = 0;
+ public:
+  // receives the ranges of the source that have been lexed, from the lexing
+  // threads when the source is lexed in parallel
+  using Progress = std::function<void(std::size_t offset, std::size_t size)>;
+
+ private:
+  Progress m_progress;
+  std::size_t m_reported = 0;
 
  public:
-  Lexer(std::string_view source, ErrorReporter &error_reporter);
+  // sources are split in chunks of at least this size to be lexed in parallel
+  static constexpr std::size_t parallel_chunk_size = 1 << 20;
+  // the progress is reported every time this many bytes have been lexed
+  static constexpr std::size_t progress_step = 64 << 20;
+  // the source is validated as UTF-8 this many bytes ahead of the lexer, so
+  // that the bytes are still in cache when they are lexed. An invalid sequence
+  // is only reported once the lexer reaches it, after the errors before it
+  static constexpr std::size_t validation_window = 64 << 10;
 
-  auto scanTokens() -> std::optional<
-      std::reference_wrapper<std::vector<std::unique_ptr<Token> > > >;
+  Lexer(std::string_view source, ErrorReporter &error_reporter,
+        SymbolTable &symbols);
+
+  void setProgress(Progress progress);
+
+  auto scanTokens(unsigned int threads = std::thread::hardware_concurrency())
+      -> std::optional<std::reference_wrapper<TokenBuffer> >;
 
  private:
+  void scan();
+  void scanParallel(std::size_t chunks);
+  void reportProgress();
+  auto validate() -> bool;
+
   [[nodiscard]] auto isAtEnd() const -> bool;
 
-  void nextLine();
-  void moveCursor(std::uint32_t i);
+  void moveCursor(std::size_t i);
+  void moveCursorTo(char const *it);
+
+  [[nodiscard]] auto cursor() const -> char const *;
+  [[nodiscard]] auto end() const -> char const *;
 
   void scanToken();
 
+  [[nodiscard]] auto tokenPosition() const -> SourcePosition {
+    return {m_prev_cursor, m_cur_cursor - m_prev_cursor};
+  }
+
   template <TokenType type>
     requires(!is_value_token<type>())
   void addToken() {
-    m_tokens.emplace_back(std::make_unique<BasicToken<type> >(
-        SourcePosition(m_start_line, m_current_line, m_start_line_position,
-                       m_current_line_position - 1)));
+    m_tokens.push<type>(tokenPosition());
   }
 
+  void addToken(TokenType type) { m_tokens.push(type, tokenPosition()); }
+
   template <TokenType type>
     requires(type == TokenType::TOKEN_NUMBER)
   void addToken(double value) {
-    m_tokens.emplace_back(std::make_unique<ValueToken<type> >(
-        value,
-        SourcePosition(m_start_line, m_current_line, m_start_line_position,
-                       m_current_line_position - 1)));
+    m_tokens.push<type>(tokenPosition(), value);
   }
 
   template <TokenType type>
     requires(type == TokenType::TOKEN_STRING)
   void addToken(std::string_view value) {
-    m_tokens.emplace_back(std::make_unique<ValueToken<type> >(
-        value,
-        SourcePosition(m_start_line, m_current_line, m_start_line_position,
-                       m_current_line_position - 1)));
+    m_tokens.push<type>(tokenPosition(), value);
   }
 
   template <TokenType type>
     requires(type == TokenType::TOKEN_IDENTIFIER)
-  void addToken(std::string_view value) {
-    m_tokens.emplace_back(std::make_unique<ValueToken<type> >(
-        value,
-        SourcePosition(m_start_line, m_current_line, m_start_line_position,
-                       m_current_line_position - 1)));
+  void addToken(SymbolTable::Symbol symbol) {
+    m_tokens.push<type>(tokenPosition(), symbol);
   }
 
   [[nodiscard]] auto match(char c) -> bool;
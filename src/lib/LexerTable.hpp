@@ -0,0 +1,99 @@
+#ifndef CPPLOX_LEXERTABLE_HPP
+#define CPPLOX_LEXERTABLE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "Token.hpp"
+#include "utils/Enums.hpp"
+
+/*
+Dispatch table indexed by the first byte of a token. The punctuation entries
+are generated from token_lexeme so that adding a punctuation TokenType is
+enough for the lexer to recognize it: a one character lexeme becomes a Single
+entry and a two character lexeme turns the entry of its first character into a
+Pair that needs one extra byte of lookahead.
+*/
+namespace LexerTable {
+enum class Action : std::uint8_t {
+  INVALID,
+  WHITESPACE,
+  SINGLE,
+  PAIR,
+  SLASH,
+  STRING,
+  DIGIT,
+  ALPHA
+};
+
+struct Entry {
+  Action action = Action::INVALID;
+  char second = '\0';
+  TokenType single = TokenType::TOKEN_EOF;
+  TokenType pair = TokenType::TOKEN_EOF;
+};
+
+constexpr auto build() {
+  std::array<Entry, 256> table{};
+
+  auto at = [&table](char c) -> Entry & {
+    return table[static_cast<unsigned char>(c)];
+  };
+
+  for (auto type : Enums::values_v<TokenType>) {
+    auto lexeme = token_lexeme(type);
+    if (lexeme.size() == 1) {
+      auto &entry = at(lexeme[0]);
+      entry.single = type;
+      if (entry.action == Action::INVALID) {
+        entry.action = Action::SINGLE;
+      }
+    } else if (lexeme.size() == 2) {
+      auto &entry = at(lexeme[0]);
+      if (entry.action == Action::PAIR) {
+        throw "only one two character lexeme per first character";
+      }
+      entry.action = Action::PAIR;
+      entry.second = lexeme[1];
+      entry.pair = type;
+    }
+  }
+
+  // a pair needs its one character prefix to be a token as well
+  for (auto const &entry : table) {
+    if (entry.action == Action::PAIR && entry.single == TokenType::TOKEN_EOF) {
+      throw "two character lexeme without a one character prefix";
+    }
+  }
+
+  at('/').action = Action::SLASH;
+  at('"').action = Action::STRING;
+  for (auto c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+    at(c).action = Action::WHITESPACE;
+  }
+  for (auto c = '0'; c <= '9'; ++c) {
+    at(c).action = Action::DIGIT;
+  }
+  for (auto c = 'a'; c <= 'z'; ++c) {
+    at(c).action = Action::ALPHA;
+    at(static_cast<char>(c - 'a' + 'A')).action = Action::ALPHA;
+  }
+  at('_').action = Action::ALPHA;
+  // the lexer validates the source, any other byte is part of a UTF-8
+  // character in an identifier
+  for (std::size_t c = 0x80; c < table.size(); ++c) {
+    table[c].action = Action::ALPHA;
+  }
+
+  return table;
+}
+
+inline constexpr auto table_v = build();
+
+constexpr auto lookup(char c) -> Entry const & {
+  return table_v[static_cast<unsigned char>(c)];
+}
+}  // namespace LexerTable
+
+#endif /* CPPLOX_LEXERTABLE_HPP */
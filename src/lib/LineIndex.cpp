@@ -0,0 +1,55 @@
+#include "LineIndex.hpp"
+
+#include <algorithm>
+
+#include "utils/Scan.hpp"
+
+LineIndex::LineIndex(std::string_view source) : m_source(source) {
+  auto const *begin = source.data();
+  auto const *end = begin + source.size();
+
+  m_line_starts.push_back(0);
+  for (auto const *it = Scan::findByte(begin, end, '\n'); it != end;
+       it = Scan::findByte(it + 1, end, '\n')) {
+    m_line_starts.push_back(it + 1 - begin);
+  }
+}
+
+[[nodiscard]] auto LineIndex::getLine(std::uint64_t offset) const
+    -> std::uint32_t {
+  auto it = std::upper_bound(m_line_starts.begin(), m_line_starts.end(),
+                             std::min<std::uint64_t>(offset, m_source.size()));
+  return static_cast<std::uint32_t>(it - m_line_starts.begin());
+}
+
+namespace {
+// offset of the last character of the span, an empty span points at its start
+auto lastOffset(SourcePosition position) -> std::uint64_t {
+  return position.getLength() == 0
+             ? position.getOffset()
+             : position.getOffset() + position.getLength() - 1;
+}
+}  // namespace
+
+[[nodiscard]] auto LineIndex::locate(SourcePosition position) const
+    -> SourceLocation {
+  auto start = position.getOffset();
+  auto last = lastOffset(position);
+  auto start_line = getLine(start);
+  auto end_line = getLine(last);
+
+  return {start_line, end_line, start - m_line_starts[start_line - 1],
+          last - m_line_starts[end_line - 1]};
+}
+
+[[nodiscard]] auto LineIndex::getLines(SourcePosition position) const
+    -> std::string_view {
+  auto start_line = getLine(position.getOffset());
+  auto end_line = getLine(lastOffset(position));
+
+  std::size_t line_start = m_line_starts[start_line - 1];
+  std::size_t line_end = end_line < m_line_starts.size()
+                             ? m_line_starts[end_line] - 1
+                             : m_source.size();
+  return m_source.substr(line_start, line_end - line_start);
+}
@@ -0,0 +1,37 @@
+#ifndef CPPLOX_LINEINDEX_HPP
+#define CPPLOX_LINEINDEX_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "SourcePosition.hpp"
+
+/*
+Offsets of the start of every line of a source, built in one pass over it so
+that the line of a position is found with a binary search instead of walking
+the source from its first byte.
+*/
+class LineIndex {
+  std::string_view m_source;
+  std::vector<std::uint64_t> m_line_starts;
+
+ public:
+  LineIndex(std::string_view source);
+
+  [[nodiscard]] inline auto getSource() const { return m_source; }
+  [[nodiscard]] inline auto getLineCount() const {
+    return static_cast<std::uint32_t>(m_line_starts.size());
+  }
+
+  // line, starting at 1, of the character at offset
+  [[nodiscard]] auto getLine(std::uint64_t offset) const -> std::uint32_t;
+
+  [[nodiscard]] auto locate(SourcePosition position) const -> SourceLocation;
+
+  // the lines of the source the position spans
+  [[nodiscard]] auto getLines(SourcePosition position) const
+      -> std::string_view;
+};
+
+#endif /* CPPLOX_LINEINDEX_HPP */
@@ -1,7 +1,10 @@
 #include "Lox.hpp"
 
+#include <span>
+
 #include "Lexer.hpp"
 #include "Parser.hpp"
+#include "VirtualMachine.hpp"
 
 Lox::Lox() : m_environment(m_error_reporter) {}
 
@@ -9,33 +12,143 @@ Lox::Lox(ErrorReporter::Formater error_formater)
     : m_error_reporter(std::move(error_formater)),
       m_environment(m_error_reporter) {}
 
-auto Lox::run(std::string_view source)
+auto Lox::run(std::string_view source, std::uint32_t first_line,
+              std::string_view line_prefix)
     -> std::optional<std::vector<std::string> const> {
   m_error_reporter.clearErrors();
 
-  m_error_reporter.setSource(source);
+  m_error_reporter.setSource(source, first_line, line_prefix);
+
+  auto pipeline = m_passes.getName();
+  auto compiled = m_backend == Backend::VIRTUAL_MACHINE;
+  if (m_cache.has_value()) {
+    auto entry = m_cache->load(source, pipeline, m_symbols);
+    if (entry.has_value() && compiled && entry->getBytecode().has_value()) {
+      // the program is only decoded to locate an error
+      VirtualMachine vm{std::move(entry->getBytecode().value()),
+                        [&entry] {
+                          auto const *program = entry->getProgram();
+                          return program != nullptr
+                                     ? std::span{program->getStatements()}
+                                     : std::span<Statement const>{};
+                        },
+                        m_environment, m_error_reporter};
+      return vm.interpret();
+    }
+    auto const *program = entry.has_value() ? entry->getProgram() : nullptr;
+    if (program != nullptr) {
+      return compiled ? compile(source, pipeline, *program)
+                      : execute(program->getStatements());
+    }
+  }
 
-  Lexer lexer{source, m_error_reporter};
+  Lexer lexer{source, m_error_reporter, m_symbols};
+  lexer.setProgress(m_lexer_progress);
   auto tokens = lexer.scanTokens();
 
   if (!hasErrors() && tokens.has_value()) {
-    Parser parser{tokens.value(), m_error_reporter};
-    auto statements = parser.parse();
+    Parser parser{tokens.value(), m_error_reporter, m_symbols};
+    auto program = parser.parse();
 
-    if (!hasErrors() && statements.has_value()) {
-      Interpreter interpreter{statements.value(), m_environment,
-                              m_error_reporter};
-      return interpreter.interpret();
+    if (!hasErrors() && program.has_value()) {
+      m_passes.run(program.value());
+      if (compiled) {
+        return compile(source, pipeline, program.value());
+      }
+      if (m_cache.has_value()) {
+        m_cache->store(source, pipeline, program.value());
+      }
+      return execute(program->getStatements());
     }
   }
 
   return std::nullopt;
 }
 
+auto Lox::run(Document const &document)
+    -> std::optional<std::vector<std::string> const> {
+  m_error_reporter.clearErrors();
+
+  std::uint32_t line = 1;
+  for (auto const &declaration : document.getDeclarations()) {
+    if (declaration->errors.hasErrors()) {
+      m_error_reporter.setSource(declaration->text, line);
+      m_error_reporter.addErrors(declaration->errors, 0);
+      return std::nullopt;
+    }
+    line += declaration->newlines;
+  }
+
+  std::vector<std::string> values;
+  line = 1;
+  for (auto const &declaration : document.getDeclarations()) {
+    m_error_reporter.setSource(declaration->text, line);
+    if (declaration->program.has_value()) {
+      auto result = execute(declaration->program->getStatements());
+      if (hasErrors() || !result.has_value()) {
+        return std::nullopt;
+      }
+      values.insert(values.end(), result->begin(), result->end());
+    }
+    line += declaration->newlines;
+  }
+  return values;
+}
+
+auto Lox::execute(std::vector<Statement> const &statements)
+    -> std::optional<std::vector<std::string> const> {
+  if (m_backend == Backend::VIRTUAL_MACHINE) {
+    VirtualMachine vm{statements, m_environment, m_error_reporter};
+    return vm.interpret();
+  }
+  Interpreter interpreter{statements, m_environment, m_error_reporter};
+  interpreter.setSharing(m_sharing);
+  return interpreter.interpret();
+}
+
+auto Lox::compile(std::string_view source, std::string_view pipeline,
+                  Program const &program)
+    -> std::optional<std::vector<std::string> const> {
+  VirtualMachine vm{program.getStatements(), m_environment, m_error_reporter};
+  if (!vm.compile()) {
+    return std::nullopt;
+  }
+  if (m_cache.has_value()) {
+    m_cache->store(source, pipeline, program, vm.getBytecode(), m_symbols);
+  }
+  return vm.interpret();
+}
+
+[[nodiscard]] auto Lox::getSymbols() -> SymbolTable & { return m_symbols; }
+
+void Lox::setLexerProgress(Lexer::Progress progress) {
+  m_lexer_progress = std::move(progress);
+}
+
+void Lox::setOptimizing(bool enabled) {
+  PassManager passes = enabled ? PassManager::standard() : PassManager{};
+  passes.setCounting(m_passes.isCounting());
+  m_passes = std::move(passes);
+}
+
+void Lox::setSubexpressionSharing(bool enabled) { m_sharing = enabled; }
+
+void Lox::setBackend(Backend backend) { m_backend = backend; }
+
+[[nodiscard]] auto Lox::getPasses() -> PassManager & { return m_passes; }
+
+void Lox::setProgramCache(std::optional<ProgramCache> cache) {
+  m_cache = std::move(cache);
+}
+
 [[nodiscard]] auto Lox::getErrors() const -> std::vector<std::string> {
   return m_error_reporter.getErrors();
 }
 
+void Lox::reportErrors(ErrorReporter::Sink const &sink) const {
+  m_error_reporter.report(sink);
+}
+
 [[nodiscard]] auto Lox::hasErrors() const -> bool {
   return m_error_reporter.hasErrors();
 }
\ No newline at end of file
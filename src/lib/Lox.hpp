@@ -1,26 +1,85 @@
 #ifndef CPPLOX_LOX_HPP
 #define CPPLOX_LOX_HPP
 
+#include <cstdint>
 #include <optional>
 #include <string_view>
 #include <vector>
 
+#include "Document.hpp"
 #include "Environment.hpp"
 #include "ErrorReporter.hpp"
+#include "Lexer.hpp"
+#include "PassManager.hpp"
+#include "ProgramCache.hpp"
+#include "SymbolTable.hpp"
 
 class Lox {
+ public:
+  // runs the programs
+  enum class Backend : std::uint8_t {
+    // on the ASTs, see Interpreter
+    INTERPRETER,
+    // compiled to bytecode, see VirtualMachine
+    VIRTUAL_MACHINE,
+  };
+
+ private:
   ErrorReporter m_error_reporter;
+  SymbolTable m_symbols;
   Environment m_environment;
+  Lexer::Progress m_lexer_progress;
+  PassManager m_passes = PassManager::standard();
+  std::optional<ProgramCache> m_cache;
+  bool m_sharing = false;
+  Backend m_backend = Backend::INTERPRETER;
 
  public:
   Lox();
   Lox(ErrorReporter::Formater error_formater);
 
-  auto run(std::string_view source)
+  // first_line numbers the first line of source in error messages, for
+  // sources that are a part of a bigger input, and line_prefix is the start of
+  // that line before source, see ErrorReporter::setSource
+  auto run(std::string_view source, std::uint32_t first_line = 1,
+           std::string_view line_prefix = {})
       -> std::optional<std::vector<std::string> const>;
 
+  // runs the declarations of a document lexed and parsed with this
+  // interpreter's symbols, errors are reported as for a stream: those of the
+  // first declaration that has some
+  auto run(Document const &document)
+      -> std::optional<std::vector<std::string> const>;
+
+  [[nodiscard]] auto getSymbols() -> SymbolTable &;
+
+  void setLexerProgress(Lexer::Progress progress);
+  // runs the standard passes of the PassManager on the parsed sources, enabled
+  // by default. Disabling it runs none of them, not only the folding
+  void setOptimizing(bool enabled);
+  // the interpreter computes the common subexpressions of an expression once,
+  // disabled by default
+  void setSubexpressionSharing(bool enabled);
+  // the backend that runs the programs, both print the same values and report
+  // the same errors. The interpreter is the default.
+  void setBackend(Backend backend);
+  // passes run on the parsed sources and their reports
+  [[nodiscard]] auto getPasses() -> PassManager &;
+  // run(source) loads the programs of its sources from cache instead of
+  // parsing them, and stores those it parses
+  void setProgramCache(std::optional<ProgramCache> cache);
+
   [[nodiscard]] auto getErrors() const -> std::vector<std::string>;
+  void reportErrors(ErrorReporter::Sink const &sink) const;
   [[nodiscard]] auto hasErrors() const -> bool;
+
+ private:
+  auto execute(std::vector<Statement> const &statements)
+      -> std::optional<std::vector<std::string> const>;
+  // runs program on the VirtualMachine, the cache stores its code with it
+  auto compile(std::string_view source, std::string_view pipeline,
+               Program const &program)
+      -> std::optional<std::vector<std::string> const>;
 };
 
 #endif /* CPPLOX_LOX_HPP */
@@ -1,23 +1,21 @@
 #include "Parser.hpp"
 
 #include <algorithm>
+#include <utility>
 
-Parser::Parser(std::vector<std::unique_ptr<Token> > const &tokens,
-               ErrorReporter &error_reporter)
-    : m_tokens(tokens),
-      m_token_it(tokens.begin()),
-      m_error_reporter(error_reporter) {}
+Parser::Parser(TokenBuffer const &tokens, ErrorReporter &error_reporter,
+               SymbolTable const &symbols)
+    : m_tokens(tokens), m_error_reporter(error_reporter), m_symbols(symbols) {}
 
-auto Parser::parse() -> std::optional<std::vector<Statement> > {
+auto Parser::parse() -> std::optional<Program> {
   try {
-    std::vector<Statement> statements;
+    m_blocks.emplace_back();
 
-    auto it_end = m_tokens.end();
-    while (m_token_it != it_end) {
-      declarations(statements);
+    while (!isAtEnd() || m_blocks.size() > 1) {
+      declarations();
     }
 
-    return statements;
+    return Program{std::move(m_arena), std::move(m_blocks.back())};
   } catch (Parser::ParserException &e) {
     return std::nullopt;
   } catch (...) {
@@ -26,36 +24,55 @@ auto Parser::parse() -> std::optional<std::vector<Statement> > {
   }
 }
 
-void Parser::declarations(std::vector<Statement> &statements) {
+void Parser::declarations() {
   try {
+    // blocks are pushed on m_blocks instead of being parsed by native
+    // recursion, their nesting is not limited by the native stack
+    if (m_blocks.size() > 1) {
+      if (isAtEnd()) {
+        // the enclosing block goes on without the unterminated one
+        m_blocks.pop_back();
+        throw error(peek(), "'}' expected after block");
+      }
+      if (match(TokenType::TOKEN_RIGHT_BRACE)) {
+        endBlock();
+        return;
+      }
+    }
+
     if (match(TokenType::TOKEN_VAR)) {
-      statements.emplace_back(variableDeclaration());
+      m_blocks.back().emplace_back(variableDeclaration());
       while (match(TokenType::TOKEN_COMMA)) {
-        statements.emplace_back(variableDeclaration());
+        m_blocks.back().emplace_back(variableDeclaration());
       }
+    } else if (match(TokenType::TOKEN_LEFT_BRACE)) {
+      m_blocks.emplace_back();
     } else {
-      statements.emplace_back(statement());
+      m_blocks.back().emplace_back(statement());
     }
   } catch (Parser::ParserException &e) {
+    // drops the operators and operands of the expressions left unfinished
+    m_operators.clear();
+    m_operands.clear();
+    m_ternaries.clear();
     synchronize();
   }
 }
 
-auto Parser::variableDeclaration() -> VariableDeclaration {
+auto Parser::variableDeclaration() -> Node<VariableDeclaration> {
   if (!match(TokenType::TOKEN_IDENTIFIER)) {
     throw error(peek(), "Variable name expected");
   }
 
-  auto *id = static_cast<ValueToken<TokenType::TOKEN_IDENTIFIER> *>(
-      previous().value());
+  auto id = identifier(previous().value());
 
   if (match(TokenType::TOKEN_EQUAL)) {
-    auto initializer = assign();
+    auto initializer = expression(ParserTable::Precedence::ASSIGNMENT);
     if (match({TokenType::TOKEN_SEMICOLON, TokenType::TOKEN_COMMA})) {
-      return {id, std::move(initializer)};
+      return m_arena.make<VariableDeclaration>(id, std::move(initializer));
     }
   } else if (match(TokenType::TOKEN_SEMICOLON)) {
-    return {id};
+    return m_arena.make<VariableDeclaration>(id);
   }
 
   throw error(previous(), "';' expected after value");
@@ -65,291 +82,246 @@ auto Parser::statement() -> Statement {
   if (match(TokenType::TOKEN_PRINT)) {
     return printStatement();
   }
-  if (match(TokenType::TOKEN_LEFT_BRACE)) {
-    return blockStatement();
-  }
 
   return expressionStatement();
 }
 
-auto Parser::printStatement() -> PrintStatement {
+auto Parser::printStatement() -> Node<PrintStatement> {
   auto value = expression();
 
   if (!match(TokenType::TOKEN_SEMICOLON)) {
     throw error(previous(), "';' expected after value");
   }
 
-  return value;
+  return m_arena.make<PrintStatement>(std::move(value));
 }
 
-auto Parser::expressionStatement() -> ExpressionStatement {
+auto Parser::expressionStatement() -> Node<ExpressionStatement> {
   auto value = expression();
 
   if (!match(TokenType::TOKEN_SEMICOLON)) {
     throw error(previous(), "';' expected after value");
   }
 
-  return value;
+  return m_arena.make<ExpressionStatement>(std::move(value));
 }
 
-auto Parser::blockStatement() -> BlockStatement {
-  std::vector<Statement> statements;
-
-  for (auto curr = peek(); curr.has_value() && curr.value()->getType() !=
-                                                   TokenType::TOKEN_RIGHT_BRACE;
-       curr = peek()) {
-    std::vector<Statement> stmts;
-    declarations(stmts);
-    for (auto const &s : stmts) {
-      statements.emplace_back(s);
-    }
-  }
-
-  if (!match(TokenType::TOKEN_RIGHT_BRACE)) {
-    throw error(peek(), "'}' expected after block");
-  }
-
-  return statements;
+void Parser::endBlock() {
+  auto statements = std::move(m_blocks.back());
+  m_blocks.pop_back();
+  m_blocks.back().emplace_back(m_arena.make<BlockStatement>(
+      m_arena.copy(std::span<Statement const>{statements})));
 }
 
-auto Parser::expression() -> Expression {
-  auto expr = assign();
-
-  while (match(TokenType::TOKEN_COMMA)) {
-    auto *op = previous().value();
-
-    expr = BinaryExpression<TokenType::TOKEN_COMMA>{
-        std::move(expr), static_cast<BasicToken<TokenType::TOKEN_COMMA> *>(op),
-        expression()};
-  }
-
-  return expr;
-}
-
-auto Parser::assign() -> Expression {
-  auto expr = equality();
-
-  if (match(TokenType::TOKEN_EQUAL)) {
-    if (auto *expr_ptr = std::get_if<Box<VariableExpression> >(&expr)) {
-      auto value = assign();
-      return AssignExpression{(*expr_ptr)->getIdentifier(), std::move(value)};
+auto Parser::expression(ParserTable::Precedence lowest) -> Expression {
+  using ParserTable::Kind;
+  using ParserTable::Precedence;
+
+  auto base = m_operators.size();
+  auto groups = m_ternaries.size();
+  // of the innermost open parenthesis, or of the expression outside of them
+  std::size_t open_ternaries = 0;
+
+  while (true) {
+    for (auto token = peek(); token.has_value(); token = peek()) {
+      auto type = m_tokens.getType(token.value());
+      if (type == TokenType::TOKEN_LEFT_PAREN) {
+        m_operators.push_back(
+            {token.value(), Kind::GROUPING, Precedence::NONE});
+        m_ternaries.push_back(std::exchange(open_ternaries, 0));
+      } else if (ParserTable::prefix[ParserTable::index(type)] != nullptr) {
+        m_operators.push_back({token.value(), Kind::PREFIX, Precedence::UNARY});
+      } else {
+        break;
+      }
+      ++m_current;
+    }
+    m_operands.push_back(primary());
+
+    auto token = peek();
+    for (; token.has_value() && m_ternaries.size() > groups &&
+           m_tokens.getType(token.value()) == TokenType::TOKEN_RIGHT_PAREN;
+         token = peek()) {
+      if (open_ternaries != 0) {
+        throw error(previous(), "':' expected after expression");
+      }
+      while (m_operators.back().kind != Kind::GROUPING) {
+        reduce();
+      }
+      m_operators.pop_back();
+      open_ternaries = m_ternaries.back();
+      m_ternaries.pop_back();
+      m_operands.back() =
+          m_arena.make<GroupingExpression>(std::move(m_operands.back()));
+      ++m_current;
     }
+    if (!token.has_value()) {
+      break;
+    }
+    auto type = m_tokens.getType(token.value());
 
-    throw error(previous(), "Invalid assignment target");
-  }
+    if (type == TokenType::TOKEN_COLON && open_ternaries != 0) {
+      while (m_operators.back().kind != Kind::TERNARY) {
+        reduce();
+      }
+      m_operators.back().kind = Kind::ALTERNATIVE;
+      --open_ternaries;
+      ++m_current;
+      continue;
+    }
 
-  while (match(TokenType::TOKEN_QUESTION)) {
-    auto left = assign();
+    auto const &infix = ParserTable::infix[ParserTable::index(type)];
+    // any operator goes between parentheses
+    if (infix.kind == Kind::NONE ||
+        (m_ternaries.size() == groups && infix.precedence < lowest)) {
+      break;
+    }
 
-    if (match(TokenType::TOKEN_COLON)) {
-      expr = TernaryExpression{std::move(expr), std::move(left), assign()};
-    } else {
+    while (m_operators.size() > base &&
+           bindsTighter(m_operators.back(), infix)) {
+      reduce();
+    }
+    // a ternary only takes an assignment between its '?' and ':'
+    if (m_operators.size() > base && m_operators.back().kind == Kind::TERNARY &&
+        infix.precedence < Precedence::ASSIGNMENT) {
       throw error(previous(), "':' expected after expression");
     }
-  }
 
-  return expr;
-}
-
-auto Parser::equality() -> Expression {
-  auto expr = comparison();
-
-  while (match({TokenType::TOKEN_BANG_EQUAL, TokenType::TOKEN_EQUAL_EQUAL})) {
-    auto *op = previous().value();
-    auto right = comparison();
-
-    if (op->getType() == TokenType::TOKEN_BANG_EQUAL) {
-      expr = BinaryExpression<TokenType::TOKEN_BANG_EQUAL>{
-          std::move(expr),
-          static_cast<BasicToken<TokenType::TOKEN_BANG_EQUAL> *>(op),
-          std::move(right)};
-    } else if (op->getType() == TokenType::TOKEN_EQUAL_EQUAL) {
-      expr = BinaryExpression<TokenType::TOKEN_EQUAL_EQUAL>{
-          std::move(expr),
-          static_cast<BasicToken<TokenType::TOKEN_EQUAL_EQUAL> *>(op),
-          std::move(right)};
+    ++m_current;
+    if (infix.kind == Kind::ASSIGN &&
+        !std::holds_alternative<Node<VariableExpression> >(m_operands.back())) {
+      throw error(previous(), "Invalid assignment target");
     }
-  }
-
-  return expr;
-}
-
-auto Parser::comparison() -> Expression {
-  auto expr = term();
-
-  while (match({TokenType::TOKEN_GREATER, TokenType::TOKEN_GREATER_EQUAL,
-                TokenType::TOKEN_LESS, TokenType::TOKEN_LESS_EQUAL})) {
-    auto *op = previous().value();
-    auto right = term();
-
-    if (op->getType() == TokenType::TOKEN_GREATER) {
-      expr = BinaryExpression<TokenType::TOKEN_GREATER>{
-          std::move(expr),
-          static_cast<BasicToken<TokenType::TOKEN_GREATER> *>(op),
-          std::move(right)};
-    } else if (op->getType() == TokenType::TOKEN_GREATER_EQUAL) {
-      expr = BinaryExpression<TokenType::TOKEN_GREATER_EQUAL>{
-          std::move(expr),
-          static_cast<BasicToken<TokenType::TOKEN_GREATER_EQUAL> *>(op),
-          std::move(right)};
-    } else if (op->getType() == TokenType::TOKEN_LESS) {
-      expr = BinaryExpression<TokenType::TOKEN_LESS>{
-          std::move(expr),
-
-          static_cast<BasicToken<TokenType::TOKEN_LESS> *>(op),
-          std::move(right)};
-    } else if (op->getType() == TokenType::TOKEN_LESS_EQUAL) {
-      expr = BinaryExpression<TokenType::TOKEN_LESS_EQUAL>{
-          std::move(expr),
-          static_cast<BasicToken<TokenType::TOKEN_LESS_EQUAL> *>(op),
-          std::move(right)};
+    if (infix.kind == Kind::TERNARY) {
+      ++open_ternaries;
     }
+    m_operators.push_back({token.value(), infix.kind, infix.precedence});
   }
 
-  return expr;
-}
-
-auto Parser::term() -> Expression {
-  auto expr = factor();
-
-  while (match({TokenType::TOKEN_MINUS, TokenType::TOKEN_PLUS})) {
-    auto *op = previous().value();
-    auto right = factor();
-
-    if (op->getType() == TokenType::TOKEN_MINUS) {
-      expr = BinaryExpression<TokenType::TOKEN_MINUS>{
-          std::move(expr),
-          static_cast<BasicToken<TokenType::TOKEN_MINUS> *>(op),
-          std::move(right)};
-    } else if (op->getType() == TokenType::TOKEN_PLUS) {
-      expr = BinaryExpression<TokenType::TOKEN_PLUS>{
-          std::move(expr), static_cast<BasicToken<TokenType::TOKEN_PLUS> *>(op),
-          std::move(right)};
-    }
+  if (open_ternaries != 0) {
+    throw error(previous(), "':' expected after expression");
+  }
+  if (m_ternaries.size() > groups) {
+    throw error(previous(), "')' expected after expression");
+  }
+  while (m_operators.size() > base) {
+    reduce();
   }
 
+  auto expr = std::move(m_operands.back());
+  m_operands.pop_back();
   return expr;
 }
 
-auto Parser::factor() -> Expression {
-  auto expr = unary();
-
-  while (match({TokenType::TOKEN_SLASH, TokenType::TOKEN_STAR})) {
-    auto *op = previous().value();
-    auto right = unary();
-
-    if (op->getType() == TokenType::TOKEN_SLASH) {
-      expr = BinaryExpression<TokenType::TOKEN_SLASH>{
-          std::move(expr),
-          static_cast<BasicToken<TokenType::TOKEN_SLASH> *>(op),
-          std::move(right)};
-    } else if (op->getType() == TokenType::TOKEN_STAR) {
-      expr = BinaryExpression<TokenType::TOKEN_STAR>{
-          std::move(expr), static_cast<BasicToken<TokenType::TOKEN_STAR> *>(op),
-          std::move(right)};
-    }
+auto Parser::bindsTighter(Operator const &pending,
+                          ParserTable::Infix const &next) -> bool {
+  if (pending.kind == ParserTable::Kind::TERNARY ||
+      pending.kind == ParserTable::Kind::GROUPING) {
+    return false;
   }
-
-  return expr;
+  return pending.precedence > next.precedence ||
+         (pending.precedence == next.precedence && !next.right_associative);
 }
 
-auto Parser::unary() -> Expression {
-  while (match({TokenType::TOKEN_BANG, TokenType::TOKEN_MINUS})) {
-    auto *op = previous().value();
-    auto right = unary();
+void Parser::reduce() {
+  using ParserTable::Kind;
 
-    if (op->getType() == TokenType::TOKEN_BANG) {
-      return UnaryExpression<TokenType::TOKEN_BANG>{
-          static_cast<BasicToken<TokenType::TOKEN_BANG> *>(op),
-          std::move(right)};
-    }
+  auto op = m_operators.back();
+  m_operators.pop_back();
+  auto position = m_tokens.getPosition(op.token);
 
-    if (op->getType() == TokenType::TOKEN_MINUS) {
-      return UnaryExpression<TokenType::TOKEN_MINUS>{
-          static_cast<BasicToken<TokenType::TOKEN_MINUS> *>(op),
-          std::move(right)};
-    }
+  auto right = std::move(m_operands.back());
+  m_operands.pop_back();
+  if (op.kind == Kind::PREFIX) {
+    m_operands.push_back(ParserTable::prefix[ParserTable::index(
+        m_tokens.getType(op.token))](m_arena, position, std::move(right)));
+    return;
   }
 
-  return primary();
+  auto &left = m_operands.back();
+  switch (op.kind) {
+    case Kind::BINARY:
+      left = ParserTable::infix[ParserTable::index(m_tokens.getType(op.token))]
+                 .build(m_arena, std::move(left), position, std::move(right));
+      break;
+    case Kind::ASSIGN:
+      left = m_arena.make<AssignExpression>(
+          std::get<Node<VariableExpression> >(left)->getIdentifier(),
+          std::move(right));
+      break;
+    case Kind::ALTERNATIVE: {
+      auto middle = std::move(left);
+      m_operands.pop_back();
+      auto &condition = m_operands.back();
+      condition = m_arena.make<TernaryExpression>(
+          std::move(condition), std::move(middle), std::move(right));
+      break;
+    }
+    default:
+      break;
+  }
 }
 
 auto Parser::primary() -> Expression {
   if (match(TokenType::TOKEN_FALSE)) {
-    return LiteralExpression<TokenType::TOKEN_FALSE>{};
+    return m_arena.make<LiteralExpression<TokenType::TOKEN_FALSE> >();
   }
 
   if (match(TokenType::TOKEN_TRUE)) {
-    return LiteralExpression<TokenType::TOKEN_TRUE>{};
+    return m_arena.make<LiteralExpression<TokenType::TOKEN_TRUE> >();
   }
 
   if (match(TokenType::TOKEN_NIL)) {
-    return LiteralExpression<TokenType::TOKEN_NIL>{};
+    return m_arena.make<LiteralExpression<TokenType::TOKEN_NIL> >();
   }
 
   if (match({TokenType::TOKEN_NUMBER, TokenType::TOKEN_STRING})) {
-    auto *op = previous().value();
-    if (op->getType() == TokenType::TOKEN_NUMBER) {
-      return LiteralNumberExpression{
-          (static_cast<ValueToken<TokenType::TOKEN_NUMBER> *>(op)->getValue())};
+    auto op = previous().value();
+    if (m_tokens.getType(op) == TokenType::TOKEN_NUMBER) {
+      return m_arena.make<LiteralNumberExpression>(m_tokens.getNumber(op));
     }
-    if (op->getType() == TokenType::TOKEN_STRING) {
-      return LiteralStringExpression{
-          (static_cast<ValueToken<TokenType::TOKEN_STRING> *>(op)->getValue())};
+    if (m_tokens.getType(op) == TokenType::TOKEN_STRING) {
+      return m_arena.make<LiteralStringExpression>(m_tokens.getString(op));
     }
   }
 
   if (match(TokenType::TOKEN_IDENTIFIER)) {
-    return VariableExpression{
-        static_cast<ValueToken<TokenType::TOKEN_IDENTIFIER> *>(
-            previous().value())};
-  }
-
-  if (match(TokenType::TOKEN_LEFT_PAREN)) {
-    auto expr = expression();
-    if (!match(TokenType::TOKEN_RIGHT_PAREN)) {
-      throw error(previous(), "')' expected after expression");
-    }
-    return GroupingExpression{std::move(expr)};
+    return m_arena.make<VariableExpression>(identifier(previous().value()));
   }
 
   throw error(previous(), "Expression expected");
 }
 
 void Parser::synchronize() {
-  if (m_token_it != m_tokens.end()) {
-    std::optional<Token const *> token = peek();
-    while (token.has_value()) {
-      switch (token.value()->getType()) {
-        case TokenType::TOKEN_CLASS:
-        case TokenType::TOKEN_FUN:
-        case TokenType::TOKEN_VAR:
-        case TokenType::TOKEN_FOR:
-        case TokenType::TOKEN_IF:
-        case TokenType::TOKEN_WHILE:
-        case TokenType::TOKEN_PRINT:
-        case TokenType::TOKEN_RETURN:
-          return;
-        default: {
-        }
+  for (auto token = peek(); token.has_value();) {
+    switch (m_tokens.getType(token.value())) {
+      case TokenType::TOKEN_CLASS:
+      case TokenType::TOKEN_FUN:
+      case TokenType::TOKEN_VAR:
+      case TokenType::TOKEN_FOR:
+      case TokenType::TOKEN_IF:
+      case TokenType::TOKEN_WHILE:
+      case TokenType::TOKEN_PRINT:
+      case TokenType::TOKEN_RETURN:
+        return;
+      default: {
       }
+    }
 
-      ++m_token_it;
-      token = peek();
+    ++m_current;
+    token = peek();
 
-      std::optional<Token const *> prev_token = previous();
-      if (prev_token.has_value() &&
-          prev_token.value()->getType() == TokenType::TOKEN_SEMICOLON) {
-        return;
-      }
+    auto prev_token = previous();
+    if (prev_token.has_value() &&
+        m_tokens.getType(prev_token.value()) == TokenType::TOKEN_SEMICOLON) {
+      return;
     }
   }
 }
 
 auto Parser::match(TokenType type) -> bool {
-  std::optional<Token const *> token = peek();
-  if (token.has_value() && token.value()->getType() == type) {
-    ++m_token_it;
+  if (!isAtEnd() && m_tokens.getType(m_current) == type) {
+    ++m_current;
     return true;
   }
 
@@ -361,24 +333,34 @@ inline auto Parser::match(std::initializer_list<TokenType> types) -> bool {
                              [this](TokenType type) { return match(type); });
 }
 
-[[nodiscard]] auto Parser::peek() const -> std::optional<Token *> {
-  if (m_token_it != m_tokens.end()) {
-    return m_token_it->get();
+[[nodiscard]] auto Parser::isAtEnd() const -> bool {
+  return m_current >= m_tokens.size();
+}
+
+[[nodiscard]] auto Parser::peek() const -> std::optional<TokenBuffer::Index> {
+  if (!isAtEnd()) {
+    return m_current;
   }
   return std::nullopt;
 }
 
-[[nodiscard]] auto Parser::previous() const -> std::optional<Token *> {
-  if (m_token_it != m_tokens.begin()) {
-    return (m_token_it - 1)->get();
+[[nodiscard]] auto Parser::previous() const
+    -> std::optional<TokenBuffer::Index> {
+  if (m_current > 0) {
+    return m_current - 1;
   }
   return std::nullopt;
 }
 
-auto Parser::error(std::optional<Token const *> token, std::string const &msg)
-    -> ParserException {
+auto Parser::identifier(TokenBuffer::Index token) const -> Identifier {
+  auto symbol = m_tokens.getSymbol(token);
+  return {symbol, m_symbols.getName(symbol), m_tokens.getPosition(token)};
+}
+
+auto Parser::error(std::optional<TokenBuffer::Index> token,
+                   std::string const &msg) -> ParserException {
   if (token.has_value()) {
-    m_error_reporter.setError(msg, token.value()->getPosition());
+    m_error_reporter.setError(msg, m_tokens.getPosition(token.value()));
   } else {
     m_error_reporter.setError(msg);
   }
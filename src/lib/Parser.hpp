@@ -1,60 +1,89 @@
 #ifndef CPPLOX_PARSER_HPP
 #define CPPLOX_PARSER_HPP
 
-#include <memory>
+#include <cstddef>
 #include <optional>
 #include <stdexcept>
 #include <vector>
 
 #include "ErrorReporter.hpp"
 #include "Expression.hpp"
+#include "ParserTable.hpp"
 #include "Statement.hpp"
+#include "SymbolTable.hpp"
 #include "Token.hpp"
+#include "utils/Arena.hpp"
 
 class Parser {
-  std::vector<std::unique_ptr<Token> > const &m_tokens;
-  std::vector<std::unique_ptr<Token> >::const_iterator m_token_it;
+  TokenBuffer const &m_tokens;
+  TokenBuffer::Index m_current = 0;
   ErrorReporter &m_error_reporter;
+  SymbolTable const &m_symbols;
+  Arena m_arena;
+
+  // operator waiting for its right operand while an expression is parsed
+  struct Operator {
+    TokenBuffer::Index token;
+    ParserTable::Kind kind;
+    ParserTable::Precedence precedence;
+  };
+  // shared by the nested expressions, each one only touches the entries it
+  // pushed
+  std::vector<Operator> m_operators;
+  std::vector<Expression> m_operands;
+  // ternaries left open outside of each open parenthesis
+  std::vector<std::size_t> m_ternaries;
+  // statements of the blocks being parsed, the first ones are those of the
+  // program and the last ones those of the innermost block
+  std::vector<std::vector<Statement> > m_blocks;
 
  public:
-  Parser(std::vector<std::unique_ptr<Token> > const &tokens,
-         ErrorReporter &error_reporter);
+  Parser(TokenBuffer const &tokens, ErrorReporter &error_reporter,
+         SymbolTable const &symbols);
 
   class ParserException : public std::runtime_error {
    public:
     ParserException(std::string const &what);
   };
 
-  auto parse() -> std::optional<std::vector<Statement> >;
+  // the program owns the nodes of the tree, they are valid as long as it is
+  auto parse() -> std::optional<Program>;
 
  private:
-  void declarations(std::vector<Statement> &statements);
+  // parses a declaration into the innermost block, or opens or closes a block
+  void declarations();
 
-  auto variableDeclaration() -> VariableDeclaration;
+  auto variableDeclaration() -> Node<VariableDeclaration>;
 
   auto statement() -> Statement;
 
-  auto printStatement() -> PrintStatement;
-  auto expressionStatement() -> ExpressionStatement;
-  auto blockStatement() -> BlockStatement;
-
-  auto expression() -> Expression;
-  auto assign() -> Expression;
-  auto equality() -> Expression;
-  auto comparison() -> Expression;
-  auto term() -> Expression;
-  auto factor() -> Expression;
-  auto unary() -> Expression;
+  auto printStatement() -> Node<PrintStatement>;
+  auto expressionStatement() -> Node<ExpressionStatement>;
+  void endBlock();
+
+  // parses the operators binding at least as tight as lowest, and the
+  // parentheses, with an explicit stack instead of native recursion
+  auto expression(
+      ParserTable::Precedence lowest = ParserTable::Precedence::COMMA)
+      -> Expression;
   auto primary() -> Expression;
 
+  static auto bindsTighter(Operator const &pending,
+                           ParserTable::Infix const &next) -> bool;
+  // replaces the top operator and its operands by their node
+  void reduce();
+
   void synchronize();
 
   auto match(TokenType type) -> bool;
   inline auto match(std::initializer_list<TokenType> types) -> bool;
-  [[nodiscard]] auto peek() const -> std::optional<Token *>;
-  [[nodiscard]] auto previous() const -> std::optional<Token *>;
+  [[nodiscard]] auto isAtEnd() const -> bool;
+  [[nodiscard]] auto peek() const -> std::optional<TokenBuffer::Index>;
+  [[nodiscard]] auto previous() const -> std::optional<TokenBuffer::Index>;
+
+  auto identifier(TokenBuffer::Index token) const -> Identifier;
 
-  auto error(std::optional<Token const *> token, std::string const &msg)
+  auto error(std::optional<TokenBuffer::Index> token, std::string const &msg)
       -> ParserException;
 };
 
@@ -0,0 +1,114 @@
+#ifndef CPPLOX_PARSERTABLE_HPP
+#define CPPLOX_PARSERTABLE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "Expression.hpp"
+#include "Token.hpp"
+#include "utils/Arena.hpp"
+#include "utils/Enums.hpp"
+
+/*
+Operator table of the expression parser, indexed by token type. Every infix
+operator has a precedence, an associativity and the function building its
+node, so that the parser handles all of them with a single loop instead of one
+function per precedence level.
+*/
+namespace ParserTable {
+// from the loosest to the tightest binding
+enum class Precedence : std::uint8_t {
+  NONE,
+  COMMA,
+  ASSIGNMENT,
+  EQUALITY,
+  COMPARISON,
+  TERM,
+  FACTOR,
+  UNARY
+};
+
+// ALTERNATIVE is a ternary operator whose ':' has been read, GROUPING an open
+// parenthesis waiting for its ')'
+enum class Kind : std::uint8_t {
+  NONE,
+  PREFIX,
+  BINARY,
+  ASSIGN,
+  TERNARY,
+  ALTERNATIVE,
+  GROUPING
+};
+
+using Binary = auto (*)(Arena &arena, Expression &&left, SourcePosition op,
+                        Expression &&right) -> Expression;
+using Prefix = auto (*)(Arena &arena, SourcePosition op, Expression &&right)
+    -> Expression;
+
+struct Infix {
+  Kind kind = Kind::NONE;
+  Precedence precedence = Precedence::NONE;
+  bool right_associative = false;
+  Binary build = nullptr;
+};
+
+template <TokenType type>
+auto makeBinary(Arena &arena, Expression &&left, SourcePosition op,
+                Expression &&right) -> Expression {
+  return arena.make<BinaryExpression<type> >(std::move(left), op,
+                                             std::move(right));
+}
+
+template <TokenType type>
+auto makeUnary(Arena &arena, SourcePosition op, Expression &&right)
+    -> Expression {
+  return arena.make<UnaryExpression<type> >(op, std::move(right));
+}
+
+constexpr auto index(TokenType type) -> std::size_t {
+  return static_cast<std::size_t>(type);
+}
+
+constexpr auto buildInfix() {
+  std::array<Infix, Enums::values_v<TokenType>.size()> table{};
+
+  auto binary = [&table]<TokenType type>(Precedence precedence,
+                                         bool right_associative = false) {
+    table[index(type)] = {Kind::BINARY, precedence, right_associative,
+                          makeBinary<type>};
+  };
+
+  binary.operator()<TokenType::TOKEN_COMMA>(Precedence::COMMA, true);
+  binary.operator()<TokenType::TOKEN_EQUAL_EQUAL>(Precedence::EQUALITY);
+  binary.operator()<TokenType::TOKEN_BANG_EQUAL>(Precedence::EQUALITY);
+  binary.operator()<TokenType::TOKEN_LESS>(Precedence::COMPARISON);
+  binary.operator()<TokenType::TOKEN_LESS_EQUAL>(Precedence::COMPARISON);
+  binary.operator()<TokenType::TOKEN_GREATER>(Precedence::COMPARISON);
+  binary.operator()<TokenType::TOKEN_GREATER_EQUAL>(Precedence::COMPARISON);
+  binary.operator()<TokenType::TOKEN_PLUS>(Precedence::TERM);
+  binary.operator()<TokenType::TOKEN_MINUS>(Precedence::TERM);
+  binary.operator()<TokenType::TOKEN_STAR>(Precedence::FACTOR);
+  binary.operator()<TokenType::TOKEN_SLASH>(Precedence::FACTOR);
+
+  table[index(TokenType::TOKEN_EQUAL)] = {Kind::ASSIGN, Precedence::ASSIGNMENT,
+                                          true, nullptr};
+  table[index(TokenType::TOKEN_QUESTION)] = {
+      Kind::TERNARY, Precedence::ASSIGNMENT, true, nullptr};
+
+  return table;
+}
+
+constexpr auto buildPrefix() {
+  std::array<Prefix, Enums::values_v<TokenType>.size()> table{};
+  table[index(TokenType::TOKEN_MINUS)] = makeUnary<TokenType::TOKEN_MINUS>;
+  table[index(TokenType::TOKEN_BANG)] = makeUnary<TokenType::TOKEN_BANG>;
+  return table;
+}
+
+constexpr auto infix = buildInfix();
+constexpr auto prefix = buildPrefix();
+}  // namespace ParserTable
+
+#endif /* CPPLOX_PARSERTABLE_HPP */
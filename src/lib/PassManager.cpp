@@ -0,0 +1,97 @@
+#include "PassManager.hpp"
+
+#include <span>
+#include <utility>
+#include <variant>
+
+#include "CommaSimplifier.hpp"
+#include "ConstantFolder.hpp"
+#include "DeadStoreEliminator.hpp"
+#include "ExpressionWalker.hpp"
+#include "StatementWalker.hpp"
+#include "TypeInference.hpp"
+
+namespace {
+class NodeCounter {
+  StatementWalker m_statements;
+  ExpressionWalker m_walker;
+  std::size_t m_count = 0;
+
+ public:
+  auto count(std::span<Statement const> statements) -> std::size_t {
+    m_statements.walk(statements, *this);
+    return m_count;
+  }
+
+  void operator()(Node<ExpressionStatement> const &s) {
+    ++m_count;
+    m_walker.walk(s->getExpression(), *this);
+  }
+  void operator()(Node<PrintStatement> const &s) {
+    ++m_count;
+    m_walker.walk(s->getExpression(), *this);
+  }
+  void operator()(Node<VariableDeclaration> const &s) {
+    ++m_count;
+    auto const &initializer = s->getInitializer();
+    if (initializer.has_value()) {
+      m_walker.walk(initializer.value(), *this);
+    }
+  }
+  void enterBlock([[maybe_unused]] Node<BlockStatement> const &s) {
+    ++m_count;
+  }
+  void leaveBlock([[maybe_unused]] Node<BlockStatement> const &s) {}
+
+  void next([[maybe_unused]] Expression const &expr,
+            [[maybe_unused]] std::uint8_t operand) {}
+  void leave([[maybe_unused]] Expression const &expr) { ++m_count; }
+};
+}  // namespace
+
+auto PassManager::standard() -> PassManager {
+  PassManager passes;
+  passes.add("propagate", ConstantFolder::propagate);
+  passes.add("dead-stores", DeadStoreEliminator::eliminate);
+  passes.add("commas", CommaSimplifier::simplify);
+  passes.add("types", TypeInference::infer);
+  return passes;
+}
+
+void PassManager::add(std::string name, Pass pass) {
+  m_passes.push_back(std::move(pass));
+  m_reports.push_back({std::move(name)});
+}
+
+void PassManager::run(Program &program) {
+  std::size_t nodes = m_counting ? countNodes(program) : 0;
+  for (std::size_t i = 0; i < m_passes.size(); ++i) {
+    auto start = std::chrono::steady_clock::now();
+    m_passes[i](program);
+    m_reports[i].time += std::chrono::steady_clock::now() - start;
+
+    if (m_counting) {
+      auto remaining = countNodes(program);
+      m_reports[i].removed += static_cast<std::int64_t>(nodes) -
+                              static_cast<std::int64_t>(remaining);
+      nodes = remaining;
+    }
+  }
+}
+
+auto PassManager::getName() const -> std::string {
+  std::string name;
+  for (auto const &report : m_reports) {
+    if (!name.empty()) {
+      name += ',';
+    }
+    name += report.name;
+  }
+  return name;
+}
+
+void PassManager::setCounting(bool enabled) { m_counting = enabled; }
+
+auto PassManager::countNodes(Program const &program) -> std::size_t {
+  return NodeCounter{}.count(program.getStatements());
+}
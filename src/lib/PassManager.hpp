@@ -0,0 +1,57 @@
+#ifndef CPPLOX_PASSMANAGER_HPP
+#define CPPLOX_PASSMANAGER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Statement.hpp"
+
+/*
+Pipeline of the passes run on a parsed program before it is interpreted. Every
+pass is timed, and while counting is enabled the nodes of the program are
+counted after each of them to report how many it removed. The reports add up
+over the programs the pipeline runs on.
+*/
+class PassManager {
+ public:
+  // rewrites the statements of a program, allocating the new nodes in its
+  // arena
+  using Pass = std::function<void(Program &)>;
+
+  struct Report {
+    std::string name;
+    std::chrono::steady_clock::duration time{};
+    // statements and expressions, negative when the pass added some, 0 while
+    // counting is disabled
+    std::int64_t removed = 0;
+  };
+
+ private:
+  std::vector<Pass> m_passes;
+  std::vector<Report> m_reports;
+  bool m_counting = false;
+
+ public:
+  // propagation of the constants, which folds them, removal of the dead
+  // stores and of the effect-free commas, then inference of the types
+  static auto standard() -> PassManager;
+
+  void add(std::string name, Pass pass);
+  void run(Program &program);
+
+  // names of the passes separated by commas, empty without passes
+  [[nodiscard]] auto getName() const -> std::string;
+  [[nodiscard]] inline auto getReports() const -> std::vector<Report> const & {
+    return m_reports;
+  }
+  [[nodiscard]] inline auto isCounting() const -> bool { return m_counting; }
+  void setCounting(bool enabled);
+
+  [[nodiscard]] static auto countNodes(Program const &program) -> std::size_t;
+};
+
+#endif /* CPPLOX_PASSMANAGER_HPP */
@@ -0,0 +1,629 @@
+#include "ProgramCache.hpp"
+
+#include <fmt/core.h>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ExpressionWalker.hpp"
+#include "StatementWalker.hpp"
+
+namespace {
+constexpr std::string_view magic = "LOXC";
+constexpr std::uint64_t end_of_expression = std::variant_size_v<Expression>;
+// the statements of the blocks are read without native recursion
+constexpr std::uint64_t block_statement = std::variant_size_v<Statement> - 1;
+static_assert(
+    std::is_same_v<std::variant_alternative_t<block_statement, Statement>,
+                   Node<BlockStatement> >);
+
+// thrown while decoding an entry that was not written by this version
+class InvalidEntry : public std::runtime_error {
+ public:
+  InvalidEntry() : std::runtime_error("invalid program cache entry") {}
+};
+
+// integers are written as LEB128 varints, numbers as their 8 bytes
+class Encoder {
+  std::string m_bytes;
+
+ public:
+  void varint(std::uint64_t value) {
+    while (value >= 0x80) {
+      m_bytes.push_back(static_cast<char>(value | 0x80));
+      value >>= 7;
+    }
+    m_bytes.push_back(static_cast<char>(value));
+  }
+
+  void number(double value) {
+    std::array<char, sizeof(double)> bytes{};
+    std::memcpy(bytes.data(), &value, sizeof(double));
+    m_bytes.append(bytes.data(), bytes.size());
+  }
+
+  void string(std::string_view value) {
+    varint(value.size());
+    m_bytes.append(value);
+  }
+
+  void position(SourcePosition const &position) {
+    varint(position.getOffset());
+    varint(position.getLength());
+  }
+
+  void raw(std::string_view bytes) { m_bytes.append(bytes); }
+
+  auto take() -> std::string { return std::move(m_bytes); }
+};
+
+class Decoder {
+  std::string_view m_bytes;
+  std::size_t m_offset = 0;
+
+ public:
+  Decoder(std::string_view bytes) : m_bytes(bytes) {}
+
+  auto varint() -> std::uint64_t {
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      auto byte = static_cast<unsigned char>(raw(1).front());
+      value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    throw InvalidEntry();
+  }
+
+  auto number() -> double {
+    double value = 0;
+    std::memcpy(&value, raw(sizeof(double)).data(), sizeof(double));
+    return value;
+  }
+
+  auto string() -> std::string_view { return raw(varint()); }
+
+  auto position() -> SourcePosition {
+    auto offset = varint();
+    auto length = varint();
+    if (offset > SourcePosition::max_offset ||
+        length > SourcePosition::max_length) {
+      throw InvalidEntry();
+    }
+    return {offset, length};
+  }
+
+  auto raw(std::uint64_t size) -> std::string_view {
+    if (size > remaining()) {
+      throw InvalidEntry();
+    }
+    auto bytes = m_bytes.substr(m_offset, size);
+    m_offset += size;
+    return bytes;
+  }
+
+  [[nodiscard]] auto remaining() const -> std::size_t {
+    return m_bytes.size() - m_offset;
+  }
+};
+
+// writes a node as the index of its alternative followed by its fields, the
+// name of an identifier is only written the first time it is used. The nodes of
+// an expression are written in postorder and followed by end_of_expression,
+// so that they are read back without recursion.
+class TreeWriter {
+  Encoder &m_encoder;
+  StatementWalker m_statements;
+  ExpressionWalker m_walker;
+  std::unordered_map<SymbolTable::Symbol, std::uint64_t> m_names;
+
+ public:
+  TreeWriter(Encoder &encoder) : m_encoder(encoder) {}
+
+  // the number of statements followed by each of them
+  void list(std::span<Statement const> statements) {
+    m_encoder.varint(statements.size());
+    m_statements.walk(statements, *this);
+  }
+
+  void expression(Expression const &expr) {
+    m_walker.walk(expr, *this);
+    m_encoder.varint(end_of_expression);
+  }
+
+  void next([[maybe_unused]] Expression const &expr,
+            [[maybe_unused]] std::uint8_t operand) {}
+  void leave(Expression const &expr) {
+    m_encoder.varint(expr.index());
+    std::visit(*this, expr);
+  }
+
+  void operator()(Node<ExpressionStatement> const &s) {
+    index(s);
+    expression(s->getExpression());
+  }
+  void operator()(Node<PrintStatement> const &s) {
+    index(s);
+    expression(s->getExpression());
+  }
+  void operator()(Node<VariableDeclaration> const &s) {
+    index(s);
+    identifier(s->getIdentifier());
+    auto const &initializer = s->getInitializer();
+    m_encoder.varint(initializer.has_value() ? 1 : 0);
+    if (initializer.has_value()) {
+      expression(initializer.value());
+    }
+  }
+  void enterBlock(Node<BlockStatement> const &s) {
+    m_encoder.varint(block_statement);
+    m_encoder.varint(s->getStatements().size());
+  }
+  void leaveBlock([[maybe_unused]] Node<BlockStatement> const &s) {}
+
+  void operator()(Node<LiteralNumberExpression> const &e) {
+    m_encoder.number(e->getValue());
+  }
+  void operator()(Node<LiteralStringExpression> const &e) {
+    m_encoder.string(e->getValue());
+  }
+  template <TokenType type>
+  void operator()([[maybe_unused]] Node<LiteralExpression<type> > const &e) {}
+  void operator()(Node<VariableExpression> const &e) {
+    identifier(e->getIdentifier());
+  }
+  void operator()([[maybe_unused]] Node<GroupingExpression> const &e) {}
+  void operator()([[maybe_unused]] Node<TernaryExpression> const &e) {}
+  void operator()(Node<AssignExpression> const &e) {
+    identifier(e->getIdentifier());
+  }
+  template <TokenType type>
+  void operator()(Node<UnaryExpression<type> > const &e) {
+    m_encoder.position(e->getOperator());
+  }
+  template <TokenType type>
+  void operator()(Node<BinaryExpression<type> > const &e) {
+    m_encoder.position(e->getOperator());
+    m_encoder.varint(static_cast<std::uint64_t>(e->getOperandTypes()));
+  }
+
+ private:
+  template <typename T>
+  void index(Node<T> const &s) {
+    m_encoder.varint(Statement{s}.index());
+  }
+
+  void identifier(Identifier const &identifier) {
+    auto [name, inserted] =
+        m_names.try_emplace(identifier.getSymbol(), m_names.size());
+    m_encoder.varint(name->second);
+    if (inserted) {
+      m_encoder.string(identifier.getName());
+    }
+    m_encoder.position(identifier.getPosition());
+  }
+};
+
+class TreeReader;
+
+// reads the alternative of Variant at index, with one function per alternative
+template <typename Variant, std::size_t... indices>
+auto readAlternative(TreeReader &reader, std::uint64_t index,
+                     std::index_sequence<indices...> /*unused*/) -> Variant;
+
+class TreeReader {
+  Decoder &m_decoder;
+  Arena &m_arena;
+  SymbolTable &m_symbols;
+  std::vector<std::pair<SymbolTable::Symbol, std::string_view> > m_names;
+  // operands of the nodes of the expression being read
+  std::vector<Expression> m_operands;
+
+ public:
+  TreeReader(Decoder &decoder, Arena &arena, SymbolTable &symbols)
+      : m_decoder(decoder), m_arena(arena), m_symbols(symbols) {}
+
+  auto expression() -> Expression {
+    for (auto index = m_decoder.varint(); index != end_of_expression;
+         index = m_decoder.varint()) {
+      m_operands.push_back(readAlternative<Expression>(
+          *this, index,
+          std::make_index_sequence<std::variant_size_v<Expression> >()));
+    }
+    if (m_operands.size() != 1) {
+      throw InvalidEntry();
+    }
+    return pop();
+  }
+
+  // the fields of a node are read in locals first, the order in which the
+  // arguments of a call are evaluated is unspecified
+  auto read(std::type_identity<Node<ExpressionStatement> > /*unused*/)
+      -> Node<ExpressionStatement> {
+    return m_arena.make<ExpressionStatement>(expression());
+  }
+  auto read(std::type_identity<Node<PrintStatement> > /*unused*/)
+      -> Node<PrintStatement> {
+    return m_arena.make<PrintStatement>(expression());
+  }
+  auto read(std::type_identity<Node<VariableDeclaration> > /*unused*/)
+      -> Node<VariableDeclaration> {
+    auto name = identifier();
+    std::optional<Expression> initializer;
+    if (m_decoder.varint() != 0) {
+      initializer = expression();
+    }
+    return m_arena.make<VariableDeclaration>(name, std::move(initializer));
+  }
+  // the blocks are read by list
+  auto read(std::type_identity<Node<BlockStatement> > /*unused*/)
+      -> Node<BlockStatement> {
+    throw InvalidEntry();
+  }
+
+  auto read(std::type_identity<Node<LiteralNumberExpression> > /*unused*/)
+      -> Node<LiteralNumberExpression> {
+    return m_arena.make<LiteralNumberExpression>(m_decoder.number());
+  }
+  auto read(std::type_identity<Node<LiteralStringExpression> > /*unused*/)
+      -> Node<LiteralStringExpression> {
+    auto value = m_arena.copy(std::span<char const>{m_decoder.string()});
+    return m_arena.make<LiteralStringExpression>(
+        std::string_view{value.data(), value.size()});
+  }
+  template <TokenType type>
+  auto read(std::type_identity<Node<LiteralExpression<type> > > /*unused*/)
+      -> Node<LiteralExpression<type> > {
+    return m_arena.make<LiteralExpression<type> >();
+  }
+  auto read(std::type_identity<Node<VariableExpression> > /*unused*/)
+      -> Node<VariableExpression> {
+    return m_arena.make<VariableExpression>(identifier());
+  }
+  auto read(std::type_identity<Node<GroupingExpression> > /*unused*/)
+      -> Node<GroupingExpression> {
+    return m_arena.make<GroupingExpression>(pop());
+  }
+  auto read(std::type_identity<Node<TernaryExpression> > /*unused*/)
+      -> Node<TernaryExpression> {
+    auto false_expr = pop();
+    auto true_expr = pop();
+    auto condition = pop();
+    return m_arena.make<TernaryExpression>(
+        std::move(condition), std::move(true_expr), std::move(false_expr));
+  }
+  auto read(std::type_identity<Node<AssignExpression> > /*unused*/)
+      -> Node<AssignExpression> {
+    return m_arena.make<AssignExpression>(identifier(), pop());
+  }
+  template <TokenType type>
+  auto read(std::type_identity<Node<UnaryExpression<type> > > /*unused*/)
+      -> Node<UnaryExpression<type> > {
+    return m_arena.make<UnaryExpression<type> >(m_decoder.position(), pop());
+  }
+  template <TokenType type>
+  auto read(std::type_identity<Node<BinaryExpression<type> > > /*unused*/)
+      -> Node<BinaryExpression<type> > {
+    auto op = m_decoder.position();
+    auto operand_types = m_decoder.varint();
+    if (operand_types > static_cast<std::uint64_t>(OperandTypes::STRINGS)) {
+      throw InvalidEntry();
+    }
+    auto right = pop();
+    auto left = pop();
+    auto binary = m_arena.make<BinaryExpression<type> >(std::move(left), op,
+                                                        std::move(right));
+    binary->setOperandTypes(static_cast<OperandTypes>(operand_types));
+    return binary;
+  }
+
+  // the statements of the nested blocks are read in a frame of their own
+  // instead of by native recursion
+  auto list() -> std::vector<Statement> {
+    struct Block {
+      std::uint64_t left;
+      std::vector<Statement> statements;
+    };
+    auto block = [this] {
+      auto size = m_decoder.varint();
+      // every statement takes at least a byte, do not trust a bigger size
+      if (size > m_decoder.remaining()) {
+        throw InvalidEntry();
+      }
+      Block block{size, {}};
+      block.statements.reserve(size);
+      return block;
+    };
+    std::vector<Block> blocks;
+    blocks.push_back(block());
+    while (true) {
+      auto &innermost = blocks.back();
+      if (innermost.left == 0) {
+        auto statements = std::move(innermost.statements);
+        blocks.pop_back();
+        if (blocks.empty()) {
+          return statements;
+        }
+        blocks.back().statements.push_back(m_arena.make<BlockStatement>(
+            m_arena.copy(std::span<Statement const>{statements})));
+        continue;
+      }
+      --innermost.left;
+      auto index = m_decoder.varint();
+      if (index == block_statement) {
+        blocks.push_back(block());
+        continue;
+      }
+      innermost.statements.push_back(readAlternative<Statement>(
+          *this, index,
+          std::make_index_sequence<std::variant_size_v<Statement> >()));
+    }
+  }
+
+ private:
+  auto pop() -> Expression {
+    if (m_operands.empty()) {
+      throw InvalidEntry();
+    }
+    auto expr = m_operands.back();
+    m_operands.pop_back();
+    return expr;
+  }
+
+  auto identifier() -> Identifier {
+    auto index = m_decoder.varint();
+    if (index == m_names.size()) {
+      auto symbol = m_symbols.intern(m_decoder.string());
+      m_names.emplace_back(symbol, m_symbols.getName(symbol));
+    } else if (index > m_names.size()) {
+      throw InvalidEntry();
+    }
+    auto [symbol, name] = m_names[index];
+    return {symbol, name, m_decoder.position()};
+  }
+};
+
+template <typename Variant, std::size_t... indices>
+auto readAlternative(TreeReader &reader, std::uint64_t index,
+                     std::index_sequence<indices...> /*unused*/) -> Variant {
+  using Read = auto (*)(TreeReader &) -> Variant;
+  static constexpr std::array<Read, sizeof...(indices)> reads{
+      [](TreeReader &r) -> Variant {
+        using Alternative = std::variant_alternative_t<indices, Variant>;
+        return r.read(std::type_identity<Alternative>());
+      }...};
+  if (index >= reads.size()) {
+    throw InvalidEntry();
+  }
+  return reads[index](reader);
+}
+
+// the code and the pools of bytecode, the globals are written as their names
+void writeBytecode(Encoder &encoder, Bytecode const &bytecode,
+                   SymbolTable const &symbols) {
+  auto code = bytecode.getCode();
+  encoder.string({reinterpret_cast<char const *>(code.data()), code.size()});
+  encoder.varint(bytecode.getNumbers().size());
+  for (auto number : bytecode.getNumbers()) {
+    encoder.number(number);
+  }
+  encoder.varint(bytecode.getStrings().size());
+  for (auto string : bytecode.getStrings()) {
+    encoder.string(string);
+  }
+  encoder.varint(bytecode.getGlobals().size());
+  for (auto symbol : bytecode.getGlobals()) {
+    encoder.string(symbols.getName(symbol));
+  }
+  encoder.varint(bytecode.getLocals());
+}
+
+auto readBytecode(Decoder &decoder, SymbolTable &symbols) -> Bytecode {
+  auto bytes = decoder.string();
+  std::vector<std::uint8_t> code{bytes.begin(), bytes.end()};
+  std::vector<double> numbers;
+  for (auto size = decoder.varint(); numbers.size() < size;) {
+    numbers.push_back(decoder.number());
+  }
+  std::vector<std::string_view> strings;
+  for (auto size = decoder.varint(); strings.size() < size;) {
+    strings.push_back(decoder.string());
+  }
+  std::vector<SymbolTable::Symbol> globals;
+  for (auto size = decoder.varint(); globals.size() < size;) {
+    globals.push_back(symbols.intern(decoder.string()));
+  }
+  auto locals = decoder.varint();
+  if (locals > std::numeric_limits<std::uint32_t>::max()) {
+    throw InvalidEntry();
+  }
+  auto bytecode =
+      Bytecode::load(std::move(code), std::move(numbers), std::move(strings),
+                     std::move(globals), static_cast<std::uint32_t>(locals));
+  if (!bytecode.has_value()) {
+    throw InvalidEntry();
+  }
+  return std::move(bytecode.value());
+}
+
+struct Header {
+  std::string_view version;
+  std::string_view pipeline;
+  std::uint64_t source_size;
+  std::uint64_t source_hash;
+};
+}  // namespace
+
+ProgramCache::Entry::Entry(std::vector<char> bytes, std::string_view tree,
+                           std::uint64_t checksum, SymbolTable &symbols,
+                           std::optional<Bytecode> bytecode)
+    : m_bytes(std::move(bytes)),
+      m_tree(tree),
+      m_checksum(checksum),
+      m_symbols(&symbols),
+      m_bytecode(std::move(bytecode)) {}
+
+auto ProgramCache::Entry::getProgram() -> Program const * {
+  if (!m_decoded && SymbolTable::hash(m_tree) == m_checksum) {
+    m_program = deserialize(m_tree, *m_symbols);
+  }
+  m_decoded = true;
+  return m_program.has_value() ? &m_program.value() : nullptr;
+}
+
+ProgramCache::ProgramCache(std::filesystem::path directory,
+                           std::string_view script, std::string_view version)
+    : m_directory(std::move(directory)), m_script(script), m_version(version) {}
+
+[[nodiscard]] auto ProgramCache::load(std::string_view source,
+                                      std::string_view pipeline,
+                                      SymbolTable &symbols) const
+    -> std::optional<Entry> {
+  auto source_hash = SymbolTable::hash(source);
+  std::ifstream file{getPath(pipeline), std::ios::binary | std::ios::ate};
+  auto size = file.tellg();
+  if (!file || size < 0) {
+    return std::nullopt;
+  }
+  // the views of the entry in its bytes are kept when they are moved into it
+  std::vector<char> bytes(static_cast<std::size_t>(size));
+  if (!file.seekg(0).read(bytes.data(), size)) {
+    return std::nullopt;
+  }
+
+  try {
+    Decoder decoder{{bytes.data(), bytes.size()}};
+    if (decoder.raw(magic.size()) != magic || decoder.varint() != format) {
+      return std::nullopt;
+    }
+    Header header{decoder.string(), decoder.string(), decoder.varint(),
+                  decoder.varint()};
+    if (header.version != m_version || header.pipeline != pipeline ||
+        header.source_size != source.size() ||
+        header.source_hash != source_hash) {
+      return std::nullopt;
+    }
+    // the tree, and the bytecode if it was stored, each followed by its
+    // checksum. That of the tree is checked when it is decoded.
+    auto tree = decoder.string();
+    auto tree_checksum = decoder.varint();
+    std::optional<Bytecode> bytecode;
+    if (decoder.varint() != 0) {
+      auto code = decoder.string();
+      if (decoder.varint() != SymbolTable::hash(code)) {
+        return std::nullopt;
+      }
+      Decoder contents{code};
+      bytecode = readBytecode(contents, symbols);
+      if (contents.remaining() != 0) {
+        return std::nullopt;
+      }
+    }
+    if (decoder.remaining() != 0) {
+      return std::nullopt;
+    }
+    return Entry{std::move(bytes), tree, tree_checksum, symbols,
+                 std::move(bytecode)};
+  } catch (InvalidEntry const &) {
+    return std::nullopt;
+  }
+}
+
+void ProgramCache::store(std::string_view source, std::string_view pipeline,
+                         Program const &program) const {
+  write(source, pipeline, serialize(program), std::nullopt);
+}
+
+void ProgramCache::store(std::string_view source, std::string_view pipeline,
+                         Program const &program, Bytecode const &bytecode,
+                         SymbolTable const &symbols) const {
+  Encoder encoder;
+  writeBytecode(encoder, bytecode, symbols);
+  write(source, pipeline, serialize(program), encoder.take());
+}
+
+void ProgramCache::write(std::string_view source, std::string_view pipeline,
+                         std::string_view tree,
+                         std::optional<std::string_view> code) const {
+  Encoder encoder;
+  encoder.raw(magic);
+  encoder.varint(format);
+  encoder.string(m_version);
+  encoder.string(pipeline);
+  encoder.varint(source.size());
+  encoder.varint(SymbolTable::hash(source));
+  encoder.string(tree);
+  encoder.varint(SymbolTable::hash(tree));
+  encoder.varint(code.has_value() ? 1 : 0);
+  if (code.has_value()) {
+    encoder.string(code.value());
+    encoder.varint(SymbolTable::hash(code.value()));
+  }
+  auto bytes = encoder.take();
+
+  // written next to the entry and renamed over it, so that a concurrent load
+  // never sees a partial entry
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+  auto entry = getPath(pipeline);
+  auto temporary = entry;
+  temporary += fmt::format(".{:08x}.tmp", std::random_device{}());
+  {
+    std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+    if (!file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()))
+             .flush()) {
+      file.close();
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+  }
+  std::filesystem::rename(temporary, entry, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+  }
+}
+
+[[nodiscard]] auto ProgramCache::getPath(std::string_view pipeline) const
+    -> std::filesystem::path {
+  auto key = fmt::format("{}/{}", m_version, pipeline);
+  return m_directory /
+         fmt::format("{}.{:016x}", m_script, SymbolTable::hash(key));
+}
+
+[[nodiscard]] auto ProgramCache::serialize(Program const &program)
+    -> std::string {
+  Encoder encoder;
+  TreeWriter writer{encoder};
+  writer.list(program.getStatements());
+  return encoder.take();
+}
+
+[[nodiscard]] auto ProgramCache::deserialize(std::string_view bytes,
+                                             SymbolTable &symbols)
+    -> std::optional<Program> {
+  Arena arena;
+  Decoder decoder{bytes};
+  TreeReader reader{decoder, arena, symbols};
+  try {
+    auto statements = reader.list();
+    if (decoder.remaining() != 0) {
+      return std::nullopt;
+    }
+    return Program{std::move(arena), std::move(statements)};
+  } catch (InvalidEntry const &) {
+    return std::nullopt;
+  }
+}
@@ -0,0 +1,98 @@
+#ifndef CPPLOX_PROGRAMCACHE_HPP
+#define CPPLOX_PROGRAMCACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "Statement.hpp"
+#include "SymbolTable.hpp"
+
+/*
+Parsed programs of a script saved in a directory so that an unchanged source is
+not lexed and parsed again. An entry is named after the script, the version of
+the interpreter and the passes that ran on the program, and keeps the size and
+a hash of the source in its header: the entry of an edited script, as those
+that are truncated or fail a checksum, is ignored and overwritten by the next
+store instead of accumulating.
+
+Positions are kept as offsets in the source, a loaded program reports its
+errors against the same source it was stored for. The program run by the
+VirtualMachine is stored with its Bytecode, which runs without decoding the
+program unless an error must be located.
+*/
+class ProgramCache {
+  std::filesystem::path m_directory;
+  std::string m_script;
+  std::string m_version;
+
+ public:
+  // bumped when the layout of the entries changes
+  static constexpr std::uint64_t format = 4;
+
+  // a loaded entry, its program is decoded the first time it is read. It must
+  // not outlive the symbols it was loaded with.
+  class Entry {
+    std::vector<char> m_bytes;
+    std::string_view m_tree;
+    std::uint64_t m_checksum;
+    SymbolTable *m_symbols;
+    std::optional<Bytecode> m_bytecode;
+    bool m_decoded = false;
+    std::optional<Program> m_program;
+
+   public:
+    // tree and the strings of bytecode are in bytes, checksum is the hash of
+    // tree
+    Entry(std::vector<char> bytes, std::string_view tree,
+          std::uint64_t checksum, SymbolTable &symbols,
+          std::optional<Bytecode> bytecode);
+
+    // nullptr when the program is invalid or fails its checksum
+    [[nodiscard]] auto getProgram() -> Program const *;
+    // nullopt when the program was stored without its code
+    [[nodiscard]] inline auto getBytecode() -> std::optional<Bytecode> & {
+      return m_bytecode;
+    }
+  };
+
+  // script names the file the sources are read from, its entries are kept in
+  // directory
+  ProgramCache(std::filesystem::path directory, std::string_view script,
+               std::string_view version);
+
+  // pipeline names the passes that ran on the stored program, entries stored
+  // by a different pipeline are not loaded
+  [[nodiscard]] auto load(std::string_view source, std::string_view pipeline,
+                          SymbolTable &symbols) const -> std::optional<Entry>;
+  // failures to write the entry are ignored, the cache is only an optimization
+  void store(std::string_view source, std::string_view pipeline,
+             Program const &program) const;
+  // stores the bytecode compiled from program with it, symbols names its
+  // globals
+  void store(std::string_view source, std::string_view pipeline,
+             Program const &program, Bytecode const &bytecode,
+             SymbolTable const &symbols) const;
+
+  [[nodiscard]] auto getPath(std::string_view pipeline) const
+      -> std::filesystem::path;
+
+  // compact binary form of the statements of a program, identifiers are
+  // interned again in symbols when it is read
+  [[nodiscard]] static auto serialize(Program const &program) -> std::string;
+  [[nodiscard]] static auto deserialize(std::string_view bytes,
+                                        SymbolTable &symbols)
+      -> std::optional<Program>;
+
+ private:
+  // code is the encoded bytecode, if any
+  void write(std::string_view source, std::string_view pipeline,
+             std::string_view tree, std::optional<std::string_view> code) const;
+};
+
+#endif /* CPPLOX_PROGRAMCACHE_HPP */
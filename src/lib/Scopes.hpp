@@ -0,0 +1,90 @@
+#ifndef CPPLOX_SCOPES_HPP
+#define CPPLOX_SCOPES_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "SymbolTable.hpp"
+
+/*
+Variables declared by the program a pass walks, with one scope for its top
+level and one for every block it is in. A symbol is resolved as the
+interpreter does: the Environment of a block has the global environment for
+parent, so a block sees its own variables and those of the top level but not
+those of the blocks around it. The variables of the global environment that
+other programs declared are not known.
+
+Blocks declare few variables, theirs are kept in one stack and searched
+linearly instead of being hashed in a table per block.
+*/
+template <typename Binding>
+class Scopes {
+ public:
+  using Entry = std::pair<SymbolTable::Symbol, Binding>;
+
+ private:
+  std::unordered_map<SymbolTable::Symbol, Binding> m_top_level;
+  std::vector<Entry> m_blocks;
+  // start of the variables of every block in m_blocks
+  std::vector<std::size_t> m_starts;
+
+ public:
+  void push() { m_starts.push_back(m_blocks.size()); }
+  void pop() {
+    m_blocks.resize(m_starts.back());
+    m_starts.pop_back();
+  }
+
+  // a symbol declared again in the same scope gets the new binding, the
+  // bindings of the blocks move when another one is declared
+  auto declare(SymbolTable::Symbol symbol, Binding binding) -> Binding & {
+    if (m_starts.empty()) {
+      return m_top_level.insert_or_assign(symbol, std::move(binding))
+          .first->second;
+    }
+    auto *declared = findInScope(symbol);
+    if (declared != nullptr) {
+      *declared = std::move(binding);
+      return *declared;
+    }
+    return m_blocks.emplace_back(symbol, std::move(binding)).second;
+  }
+
+  // binding symbol resolves to, nullptr when the program did not declare it
+  auto find(SymbolTable::Symbol symbol) -> Binding * {
+    auto *binding = m_starts.empty() ? nullptr : findInScope(symbol);
+    if (binding != nullptr) {
+      return binding;
+    }
+    auto it = m_top_level.find(symbol);
+    return it != m_top_level.end() ? &it->second : nullptr;
+  }
+
+  // binding of symbol in the innermost scope only
+  auto findInScope(SymbolTable::Symbol symbol) -> Binding * {
+    if (m_starts.empty()) {
+      auto it = m_top_level.find(symbol);
+      return it != m_top_level.end() ? &it->second : nullptr;
+    }
+    auto scope = getBlockScope();
+    auto it = std::find_if(scope.begin(), scope.end(), [symbol](auto &entry) {
+      return entry.first == symbol;
+    });
+    return it != scope.end() ? &it->second : nullptr;
+  }
+
+  [[nodiscard]] inline auto isTopLevel() const -> bool {
+    return m_starts.empty();
+  }
+
+  // variables of the innermost block
+  [[nodiscard]] inline auto getBlockScope() -> std::span<Entry> {
+    return std::span{m_blocks}.subspan(m_starts.back());
+  }
+};
+
+#endif /* CPPLOX_SCOPES_HPP */
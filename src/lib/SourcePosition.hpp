@@ -1,30 +1,52 @@
 #ifndef CPPLOX_SOURCEPOSITION_HPP
 #define CPPLOX_SOURCEPOSITION_HPP
 
+#include <cstddef>
 #include <cstdint>
-#include <string_view>
 
+// lines and columns of a position, columns start at 0 and end is inclusive
+struct SourceLocation {
+  std::uint32_t start_line;
+  std::uint32_t end_line;
+  std::size_t start_column;
+  std::size_t end_column;
+};
+
+/*
+Span of bytes of the source a token or an error comes from. Only the offset and
+the length are stored, lines and columns are computed from a LineIndex of the
+source when a diagnostic is reported.
+
+Both are packed in 8 bytes: 40 bits of offset for sources up to 1 TiB and 24
+bits of length. Longer spans, such as a huge string literal, are clamped to
+the maximum length, which only shortens their diagnostics.
+*/
 class SourcePosition {
-  std::uint32_t const m_start_line;
-  std::uint32_t const m_end_line;
-  std::uint32_t const m_start_line_postion;
-  std::uint32_t const m_end_line_position;
+  static constexpr unsigned length_bits = 24;
 
  public:
-  SourcePosition(std::uint32_t start_line, std::uint32_t end_line,
-                 std::uint32_t start_line_postion,
-                 std::uint32_t end_line_position);
-
-  [[nodiscard]] inline auto getStartLine() const { return m_start_line; }
-  [[nodiscard]] inline auto getEndLine() const { return m_end_line; }
-  [[nodiscard]] inline auto getStartLinePosition() const {
-    return m_start_line_postion;
+  static constexpr std::uint64_t max_offset =
+      (std::uint64_t{1} << (64 - length_bits)) - 1;
+  static constexpr std::uint64_t max_length =
+      (std::uint64_t{1} << length_bits) - 1;
+
+ private:
+  std::uint64_t m_span;
+
+ public:
+  SourcePosition(std::uint64_t offset, std::uint64_t length);
+
+  [[nodiscard]] inline auto getOffset() const -> std::uint64_t {
+    return m_span >> length_bits;
   }
-  [[nodiscard]] inline auto getEndLinePosition() const {
-    return m_end_line_position;
+  [[nodiscard]] inline auto getLength() const -> std::uint64_t {
+    return m_span & max_length;
   }
-  [[nodiscard]] auto getSourceSubstr(std::string_view source) const
-      -> std::string_view;
+
+  // the same position in a source starting offset bytes earlier
+  [[nodiscard]] auto withOffset(std::uint64_t offset) const -> SourcePosition;
 };
 
+static_assert(sizeof(SourcePosition) == 8);
+
 #endif /* CPPLOX_SOURCEPOSITION_HPP */
@@ -0,0 +1,87 @@
+#include "SourceStream.hpp"
+
+#include "utils/Scan.hpp"
+
+SourceStream::SourceStream(Reader reader) : m_reader(std::move(reader)) {}
+
+[[nodiscard]] auto SourceStream::getLine() const -> std::uint32_t {
+  return m_line;
+}
+
+[[nodiscard]] auto SourceStream::getLinePrefix() const -> std::string_view {
+  return m_line_prefix;
+}
+
+[[nodiscard]] auto SourceStream::hasFailed() const -> bool {
+  return m_failed;
+}
+
+[[nodiscard]] auto SourceStream::next() -> std::optional<std::string_view> {
+  while (true) {
+    auto end = scan();
+    if (end.has_value()) {
+      auto declaration =
+          std::string_view{m_buffer}.substr(m_start, end.value() - m_start);
+      returned(declaration);
+      m_start = end.value();
+      m_line = m_next_line;
+      m_next_line += Scan::countNewlines(
+          declaration.data(), declaration.data() + declaration.size());
+      return declaration;
+    }
+
+    if (!fill()) {
+      if (m_start == m_buffer.size() || m_failed) {
+        return std::nullopt;
+      }
+      // unterminated trailing declaration, let the parser report it
+      auto declaration = std::string_view{m_buffer}.substr(m_start);
+      returned(declaration);
+      m_start = m_buffer.size();
+      m_line = m_next_line;
+      return declaration;
+    }
+  }
+}
+
+auto SourceStream::fill() -> bool {
+  if (m_eof) {
+    return false;
+  }
+
+  // drop the declarations already returned before growing the buffer, but the
+  // start of the line of the next one
+  m_buffer.erase(0, m_line_start);
+  m_scan -= m_line_start;
+  m_start -= m_line_start;
+  m_line_start = 0;
+
+  auto size = m_buffer.size();
+  m_buffer.resize(size + chunk_size);
+  auto read = m_reader(m_buffer.data() + size, chunk_size);
+  m_buffer.resize(size + (read > 0 ? static_cast<std::size_t>(read) : 0));
+
+  if (read <= 0) {
+    m_eof = true;
+    m_failed = read < 0;
+    return false;
+  }
+  return true;
+}
+
+// scans the buffered bytes for the end of the current declaration and returns
+// the offset right after it
+auto SourceStream::scan() -> std::optional<std::size_t> {
+  auto end = m_scanner.scan(m_buffer, m_scan);
+  m_scan = end.value_or(m_buffer.size());
+  return end;
+}
+
+void SourceStream::returned(std::string_view declaration) {
+  m_line_prefix =
+      std::string_view{m_buffer}.substr(m_line_start, m_start - m_line_start);
+  auto newline = declaration.rfind('\n');
+  if (newline != std::string_view::npos) {
+    m_line_start = m_start + newline + 1;
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef CPPLOX_SOURCESTREAM_HPP
+#define CPPLOX_SOURCESTREAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "DeclarationScanner.hpp"
+
+/*
+Splits a source read in chunks (stdin, a pipe, a FIFO...) into top-level
+declarations, so that each one can be lexed, parsed and run before the next
+one is read. Declarations are delimited by a DeclarationScanner. Only the
+declaration being returned, the start of the line it starts on and the start
+of the next one are kept in memory.
+*/
+class SourceStream {
+ public:
+  // fills the buffer and returns the number of bytes read, 0 at the end of
+  // the input and a negative value on error
+  using Reader = std::function<std::ptrdiff_t(char *, std::size_t)>;
+
+  static constexpr std::size_t chunk_size = 64 * 1024;
+
+ private:
+  Reader m_reader;
+  std::string m_buffer;
+
+  std::size_t m_start = 0;
+  // of the line m_start is on
+  std::size_t m_line_start = 0;
+  std::size_t m_scan = 0;
+  DeclarationScanner m_scanner;
+
+  std::uint32_t m_line = 1;
+  std::uint32_t m_next_line = 1;
+  std::string_view m_line_prefix;
+
+  bool m_eof = false;
+  bool m_failed = false;
+
+ public:
+  SourceStream(Reader reader);
+
+  // the next declaration, valid until the following call
+  [[nodiscard]] auto next() -> std::optional<std::string_view>;
+
+  // line of the first character of the last returned declaration
+  [[nodiscard]] auto getLine() const -> std::uint32_t;
+  // the characters of that line before the declaration, valid until the
+  // following call to next
+  [[nodiscard]] auto getLinePrefix() const -> std::string_view;
+
+  [[nodiscard]] auto hasFailed() const -> bool;
+
+ private:
+  auto fill() -> bool;
+  auto scan() -> std::optional<std::size_t>;
+  // keeps the line prefix of the declaration about to be returned, which
+  // starts at m_start
+  void returned(std::string_view declaration);
+};
+
+#endif /* CPPLOX_SOURCESTREAM_HPP */
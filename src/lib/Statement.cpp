@@ -1,36 +1,64 @@
 #include "Statement.hpp"
 
-ExpressionStatement::ExpressionStatement(Expression&& expr) : m_expr(expr) {}
+ExpressionStatement::ExpressionStatement(Expression&& expr)
+    : m_expr(std::move(expr)) {}
 
 [[nodiscard]] auto ExpressionStatement::getExpression() const
     -> Expression const& {
   return m_expr;
 }
 
-PrintStatement::PrintStatement(Expression&& expr) : m_expr(expr){};
+PrintStatement::PrintStatement(Expression&& expr) : m_expr(std::move(expr)){};
 
 [[nodiscard]] auto PrintStatement ::getExpression() const -> Expression const& {
   return m_expr;
 }
 
 VariableDeclaration::VariableDeclaration(
-    ValueToken<TokenType::TOKEN_IDENTIFIER> const* name,
-    std::optional<Expression>&& initializer)
-    : m_name(name), m_initializer(initializer) {}
+    Identifier name, std::optional<Expression>&& initializer)
+    : m_name(name), m_initializer(std::move(initializer)) {}
+
+[[nodiscard]] auto VariableDeclaration::getSymbol() const
+    -> SymbolTable::Symbol {
+  return m_name.getSymbol();
+}
 
 [[nodiscard]] auto VariableDeclaration::getName() const -> std::string_view {
-  return m_name->getValue();
+  return m_name.getName();
+}
+
+[[nodiscard]] auto VariableDeclaration::getIdentifier() const
+    -> Identifier const& {
+  return m_name;
 }
 
 [[nodiscard]] auto VariableDeclaration::getInitializer() const
-    -> std::optional<Expression> {
+    -> std::optional<Expression> const& {
   return m_initializer;
 }
 
-BlockStatement::BlockStatement(std::vector<Statement>&& stmts)
+BlockStatement::BlockStatement(std::span<Statement const> stmts)
     : m_stmts(stmts) {}
 
 [[nodiscard]] auto BlockStatement::getStatements() const
-    -> std::vector<Statement> const& {
+    -> std::span<Statement const> {
   return m_stmts;
-}
\ No newline at end of file
+}
+
+Program::Program(Arena&& arena, std::vector<Statement>&& statements)
+    : m_arena(std::move(arena)), m_statements(std::move(statements)) {}
+
+[[nodiscard]] auto Program::getStatements() const
+    -> std::vector<Statement> const& {
+  return m_statements;
+}
+
+[[nodiscard]] auto Program::getStatements() -> std::vector<Statement>& {
+  return m_statements;
+}
+
+[[nodiscard]] auto Program::getArena() const -> Arena const& {
+  return m_arena;
+}
+
+[[nodiscard]] auto Program::getArena() -> Arena& { return m_arena; }
\ No newline at end of file
@@ -2,12 +2,14 @@
 #define CPPLOX_STATEMENT_HPP
 
 #include <optional>
+#include <span>
 #include <variant>
 #include <vector>
 
 #include "Expression.hpp"
 #include "Token.hpp"
-#include "utils/Box.hpp"
+#include "utils/Arena.hpp"
+#include "utils/CopyCounter.hpp"
 
 /*
 program        → declaration* EOF ;
@@ -31,19 +33,21 @@ class PrintStatement;
 class VariableDeclaration;
 class BlockStatement;
 
-using Statement = std::variant<Box<ExpressionStatement>, Box<PrintStatement>,
-                               Box<VariableDeclaration>, Box<BlockStatement> >;
+using Statement =
+    std::variant<Node<ExpressionStatement>, Node<PrintStatement>,
+                 Node<VariableDeclaration>, Node<BlockStatement> >;
 
-class BlockStatement {
-  std::vector<Statement> m_stmts;
+// the statements of a block are stored in the arena of its program
+class BlockStatement : CopyCounter {
+  std::span<Statement const> m_stmts;
 
  public:
-  BlockStatement(std::vector<Statement> &&stmts);
+  BlockStatement(std::span<Statement const> stmts);
 
-  [[nodiscard]] auto getStatements() const -> std::vector<Statement> const &;
+  [[nodiscard]] auto getStatements() const -> std::span<Statement const>;
 };
 
-class ExpressionStatement {
+class ExpressionStatement : CopyCounter {
   Expression m_expr;
 
  public:
@@ -52,7 +56,7 @@ class ExpressionStatement {
   [[nodiscard]] auto getExpression() const -> Expression const &;
 };
 
-class PrintStatement {
+class PrintStatement : CopyCounter {
   Expression m_expr;
 
  public:
@@ -61,16 +65,36 @@ class PrintStatement {
   [[nodiscard]] auto getExpression() const -> Expression const &;
 };
 
-class VariableDeclaration {
-  ValueToken<TokenType::TOKEN_IDENTIFIER> const *m_name;
+class VariableDeclaration : CopyCounter {
+  Identifier m_name;
   std::optional<Expression> m_initializer;
 
  public:
-  VariableDeclaration(ValueToken<TokenType::TOKEN_IDENTIFIER> const *name,
+  VariableDeclaration(Identifier name,
                       std::optional<Expression> &&initializer = std::nullopt);
 
+  [[nodiscard]] auto getSymbol() const -> SymbolTable::Symbol;
   [[nodiscard]] auto getName() const -> std::string_view;
-  [[nodiscard]] auto getInitializer() const -> std::optional<Expression>;
+  [[nodiscard]] auto getIdentifier() const -> Identifier const &;
+  [[nodiscard]] auto getInitializer() const
+      -> std::optional<Expression> const &;
+};
+
+/*
+The statements of a parsed source, their nodes live in the arena of the program
+and are freed with it.
+*/
+class Program {
+  Arena m_arena;
+  std::vector<Statement> m_statements;
+
+ public:
+  Program(Arena &&arena, std::vector<Statement> &&statements);
+
+  [[nodiscard]] auto getStatements() const -> std::vector<Statement> const &;
+  [[nodiscard]] auto getStatements() -> std::vector<Statement> &;
+  [[nodiscard]] auto getArena() const -> Arena const &;
+  [[nodiscard]] auto getArena() -> Arena &;
 };
 
 #endif /* CPPLOX_STATEMENT_HPP */
@@ -0,0 +1,65 @@
+#ifndef CPPLOX_STATEMENTWALKER_HPP
+#define CPPLOX_STATEMENTWALKER_HPP
+
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "Statement.hpp"
+
+/*
+Walk of a list of statements and of the blocks nested in them with an explicit
+stack instead of native recursion, so that the nesting of the blocks the parser
+builds is not limited by the size of the native stack.
+
+The visitor is called with every statement that is not a block, in the order
+they run, and with enterBlock(block) and leaveBlock(block) around the
+statements of a block. The stack is kept between walks.
+*/
+class StatementWalker {
+  struct Frame {
+    // nullptr for the statements the walk started with
+    Node<BlockStatement> const *block;
+    std::span<Statement const> statements;
+    std::size_t next;
+  };
+
+  std::vector<Frame> m_stack;
+
+ public:
+  template <typename Visitor>
+  void walk(std::span<Statement const> statements, Visitor &visitor) {
+    auto const base = m_stack.size();
+    m_stack.push_back({nullptr, statements, 0});
+    while (m_stack.size() > base) {
+      auto &frame = m_stack.back();
+      if (frame.next == frame.statements.size()) {
+        auto const *block = frame.block;
+        m_stack.pop_back();
+        if (block != nullptr) {
+          visitor.leaveBlock(*block);
+        }
+        continue;
+      }
+      auto const &statement = frame.statements[frame.next++];
+      if (auto const *block = std::get_if<Node<BlockStatement> >(&statement)) {
+        visitor.enterBlock(*block);
+        // frame is invalidated by the push
+        m_stack.push_back({block, (*block)->getStatements(), 0});
+        continue;
+      }
+      std::visit(
+          [&visitor](auto const &s) {
+            if constexpr (!std::is_same_v<std::remove_cvref_t<decltype(s)>,
+                                          Node<BlockStatement> >) {
+              visitor(s);
+            }
+          },
+          statement);
+    }
+  }
+};
+
+#endif /* CPPLOX_STATEMENTWALKER_HPP */
@@ -0,0 +1,91 @@
+#include "SymbolTable.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// FNV-1a
+[[nodiscard]] auto SymbolTable::hash(std::string_view name) -> std::uint64_t {
+  std::uint64_t hash = 0xcbf29ce484222325;
+  for (auto c : name) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+auto SymbolTable::intern(std::string_view name) -> Symbol {
+  return intern(name, hash(name));
+}
+
+auto SymbolTable::intern(std::string_view name, std::uint64_t hash) -> Symbol {
+  auto index = slot(name, hash);
+  if (m_slots[index] != empty_slot) {
+    return m_slots[index];
+  }
+
+  if (m_entries.size() == empty_slot) {
+    throw std::length_error("Too many symbols");
+  }
+  auto symbol = static_cast<Symbol>(m_entries.size());
+  m_entries.push_back({store(name), hash});
+  m_slots[index] = symbol;
+
+  // keep the load factor under 1/2
+  if (m_entries.size() * 2 > m_slots.size()) {
+    grow();
+  }
+  return symbol;
+}
+
+[[nodiscard]] auto SymbolTable::find(std::string_view name) const
+    -> std::optional<Symbol> {
+  auto symbol = m_slots[slot(name, hash(name))];
+  if (symbol == empty_slot) {
+    return std::nullopt;
+  }
+  return symbol;
+}
+
+// the slot of name, or the empty slot where it would be inserted
+[[nodiscard]] auto SymbolTable::slot(std::string_view name,
+                                     std::uint64_t hash) const -> std::size_t {
+  auto mask = m_slots.size() - 1;
+  for (auto index = hash & mask;; index = (index + 1) & mask) {
+    auto symbol = m_slots[index];
+    if (symbol == empty_slot) {
+      return index;
+    }
+    auto const &entry = m_entries[symbol];
+    if (entry.hash == hash && entry.name == name) {
+      return index;
+    }
+  }
+}
+
+auto SymbolTable::store(std::string_view name) -> std::string_view {
+  if (name.size() > m_block_left) {
+    auto size = std::max(name.size(), block_size);
+    m_blocks.push_back(std::make_unique<char[]>(size));
+    m_block_cursor = m_blocks.back().get();
+    m_block_left = size;
+  }
+
+  std::memcpy(m_block_cursor, name.data(), name.size());
+  std::string_view stored{m_block_cursor, name.size()};
+  m_block_cursor += name.size();
+  m_block_left -= name.size();
+  return stored;
+}
+
+void SymbolTable::grow() {
+  m_slots.assign(m_slots.size() * 2, empty_slot);
+  auto mask = m_slots.size() - 1;
+  for (Symbol symbol = 0; symbol < m_entries.size(); ++symbol) {
+    auto index = m_entries[symbol].hash & mask;
+    while (m_slots[index] != empty_slot) {
+      index = (index + 1) & mask;
+    }
+    m_slots[index] = symbol;
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef CPPLOX_SYMBOLTABLE_HPP
+#define CPPLOX_SYMBOLTABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+/*
+Interned identifiers. Every distinct name gets a dense Symbol, its index in
+m_entries, and is copied once in blocks owned by the table so that symbols and
+names outlive the sources they come from. A name is hashed once when it is
+interned, the hash is kept to grow the table and to merge tables without
+hashing the names again.
+*/
+class SymbolTable {
+ public:
+  using Symbol = std::uint32_t;
+
+ private:
+  struct Entry {
+    std::string_view name;
+    std::uint64_t hash;
+  };
+
+  static constexpr Symbol empty_slot = std::numeric_limits<Symbol>::max();
+  static constexpr std::size_t block_size = 64 * 1024;
+
+  std::vector<Entry> m_entries;
+  // open addressing table of symbols, its size is a power of two
+  std::vector<Symbol> m_slots = std::vector<Symbol>(64, empty_slot);
+
+  std::vector<std::unique_ptr<char[]>> m_blocks;
+  char *m_block_cursor = nullptr;
+  std::size_t m_block_left = 0;
+
+ public:
+  [[nodiscard]] static auto hash(std::string_view name) -> std::uint64_t;
+
+  auto intern(std::string_view name) -> Symbol;
+  auto intern(std::string_view name, std::uint64_t hash) -> Symbol;
+  [[nodiscard]] auto find(std::string_view name) const
+      -> std::optional<Symbol>;
+
+  [[nodiscard]] inline auto getName(Symbol symbol) const -> std::string_view {
+    return m_entries[symbol].name;
+  }
+  [[nodiscard]] inline auto getHash(Symbol symbol) const -> std::uint64_t {
+    return m_entries[symbol].hash;
+  }
+  [[nodiscard]] inline auto size() const -> Symbol {
+    return static_cast<Symbol>(m_entries.size());
+  }
+
+ private:
+  [[nodiscard]] auto slot(std::string_view name, std::uint64_t hash) const
+      -> std::size_t;
+  auto store(std::string_view name) -> std::string_view;
+  void grow();
+};
+
+#endif /* CPPLOX_SYMBOLTABLE_HPP */
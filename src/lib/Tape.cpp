@@ -0,0 +1,504 @@
+#include "Tape.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <variant>
+
+namespace {
+auto instruction(Tape::OpCode code) -> Tape::Instruction {
+  Tape::Instruction instruction{};
+  instruction.code = code;
+  return instruction;
+}
+
+auto isLeaf(Expression const &expr) -> bool {
+  return std::holds_alternative<Node<LiteralNumberExpression> >(expr) ||
+         std::holds_alternative<Node<LiteralStringExpression> >(expr) ||
+         std::holds_alternative<
+             Node<LiteralExpression<TokenType::TOKEN_TRUE> > >(expr) ||
+         std::holds_alternative<
+             Node<LiteralExpression<TokenType::TOKEN_FALSE> > >(expr) ||
+         std::holds_alternative<
+             Node<LiteralExpression<TokenType::TOKEN_NIL> > >(expr) ||
+         std::holds_alternative<Node<VariableExpression> >(expr);
+}
+}  // namespace
+
+// emits the instruction of every node once its operands were emitted, and the
+// jumps of the ternaries and the pop of the comma between their operands. While
+// sharing, the values of the emitted nodes are kept on m_values.
+struct Tape::Emitter {
+  Tape &m_tape;
+  bool const m_sharing = m_tape.m_sharing;
+
+  void next(Expression const &expr, std::uint8_t operand) {
+    if (std::holds_alternative<Node<TernaryExpression> >(expr)) {
+      if (operand == 1) {
+        m_tape.m_jumps.push_back(m_tape.jump(OpCode::JUMP_IF_FALSE));
+        if (m_sharing) {
+          m_tape.enterBranch();
+        }
+      } else {
+        auto jump_if_false = m_tape.m_jumps.back();
+        m_tape.m_jumps.back() = m_tape.jump(OpCode::JUMP);
+        m_tape.patch(jump_if_false);
+        if (m_sharing) {
+          m_tape.leaveBranch();
+          m_tape.enterBranch();
+        }
+      }
+    } else if (std::holds_alternative<
+                   Node<BinaryExpression<TokenType::TOKEN_COMMA> > >(expr)) {
+      emit(instruction(OpCode::POP));
+    }
+  }
+  void leave(Expression const &expr) { std::visit(*this, expr); }
+
+  void operator()(Node<LiteralNumberExpression> const &e) {
+    auto number = instruction(OpCode::NUMBER);
+    number.number = e->getValue();
+    if (m_sharing) {
+      leaf(m_tape.number(
+          {OpCode::NUMBER, 0, std::bit_cast<std::uint64_t>(e->getValue())}));
+    }
+    emit(number);
+  }
+  void operator()(Node<LiteralStringExpression> const &e) {
+    auto string = instruction(OpCode::STRING);
+    string.string = e;
+    if (m_sharing) {
+      leaf(m_tape.string(e->getValue()));
+    }
+    emit(string);
+  }
+  void operator()(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_TRUE> > const
+          &e) {
+    constant(OpCode::TRUE);
+  }
+  void operator()(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_FALSE> > const
+          &e) {
+    constant(OpCode::FALSE);
+  }
+  void operator()(
+      [[maybe_unused]] Node<LiteralExpression<TokenType::TOKEN_NIL> > const
+          &e) {
+    constant(OpCode::NIL);
+  }
+  void operator()(Node<VariableExpression> const &e) {
+    auto get = instruction(OpCode::GET);
+    get.variable = e;
+    if (m_sharing) {
+      leaf(m_tape.variable(e->getSymbol()).number);
+    }
+    emit(get);
+  }
+  void operator()([[maybe_unused]] Node<GroupingExpression> const &e) {}
+  void operator()([[maybe_unused]] Node<TernaryExpression> const &e) {
+    m_tape.patch(m_tape.m_jumps.back());
+    m_tape.m_jumps.pop_back();
+    if (m_sharing) {
+      m_tape.leaveBranch();
+      unshared(3);
+    }
+  }
+  void operator()(Node<AssignExpression> const &e) {
+    auto set = instruction(OpCode::SET);
+    set.assignment = e;
+    increment(e);
+    emit(set);
+    if (m_sharing) {
+      m_tape.assign(e->getSymbol());
+      unshared(1);
+    }
+  }
+  template <TokenType type>
+  void operator()(Node<UnaryExpression<type> > const &e) {
+    auto unary = instruction(type == TokenType::TOKEN_MINUS ? OpCode::NEGATE
+                                                            : OpCode::NOT);
+    unary.position = e->getOperator();
+    shared(unary, 1);
+  }
+  void operator()(
+      [[maybe_unused]] Node<BinaryExpression<TokenType::TOKEN_COMMA> > const
+          &e) {
+    if (m_sharing) {
+      unshared(2);
+    }
+  }
+  template <TokenType type>
+  void operator()(Node<BinaryExpression<type> > const &e) {
+    auto binary = instruction(code<type>(e->getOperandTypes()));
+    binary.position = e->getOperator();
+    fuse<type>(e);
+    shared(binary, 2);
+  }
+
+  // the operands of e are its last two instructions when they are leaves
+  template <TokenType type>
+  void fuse(Node<BinaryExpression<type> > const &e) {
+    if (!std::holds_alternative<Node<VariableExpression> >(
+            e->getLeftExpression())) {
+      return;
+    }
+    auto &first = m_tape.m_instructions.end()[-2];
+    auto const &right = e->getRightExpression();
+    if (std::holds_alternative<Node<VariableExpression> >(right)) {
+      first.code = variables<type>();
+    } else if (std::holds_alternative<Node<LiteralNumberExpression> >(right)) {
+      if (type == TokenType::TOKEN_PLUS) {
+        first.code = OpCode::ADD_VARIABLE_NUMBER;
+      } else if (type == TokenType::TOKEN_LESS) {
+        first.code = OpCode::LESS_VARIABLE_NUMBER;
+      }
+    }
+  }
+
+  // x = x + n, when x + n was fused and not replaced by a load
+  void increment(Node<AssignExpression> const &e) {
+    auto &instructions = m_tape.m_instructions;
+    if (!std::holds_alternative<
+            Node<BinaryExpression<TokenType::TOKEN_PLUS> > >(e->getValue()) ||
+        (instructions.back().code != OpCode::ADD &&
+         instructions.back().code != OpCode::ADD_NUMBERS)) {
+      return;
+    }
+    auto &first = instructions.end()[-3];
+    if (first.code == OpCode::ADD_VARIABLE_NUMBER &&
+        first.variable->getSymbol() == e->getSymbol()) {
+      first.code = OpCode::INCREMENT;
+    }
+  }
+
+  // emits expr when it is a leaf, a binary expression of leaves or the
+  // assignment of one of them, in the order the walker would
+  auto shallow(Expression const &expr) -> bool {
+    if (isLeaf(expr)) {
+      leave(expr);
+      return true;
+    }
+    if (auto const *assign = std::get_if<Node<AssignExpression> >(&expr)) {
+      auto const &value = (*assign)->getValue();
+      // a chain of assignments is left to the walker, not to the native stack
+      if (std::holds_alternative<Node<AssignExpression> >(value) ||
+          !shallow(value)) {
+        return false;
+      }
+      (*this)(*assign);
+      return true;
+    }
+    return std::visit([this](auto const &e) { return binaryOfLeaves(e); },
+                      expr);
+  }
+  template <TokenType type>
+  auto binaryOfLeaves(Node<BinaryExpression<type> > const &e) -> bool {
+    if (type == TokenType::TOKEN_COMMA || !isLeaf(e->getLeftExpression()) ||
+        !isLeaf(e->getRightExpression())) {
+      return false;
+    }
+    leave(e->getLeftExpression());
+    leave(e->getRightExpression());
+    (*this)(e);
+    return true;
+  }
+  template <typename T>
+  auto binaryOfLeaves([[maybe_unused]] T const &e) -> bool {
+    return false;
+  }
+
+  void emit(Instruction const &instruction) {
+    m_tape.m_instructions.push_back(instruction);
+  }
+
+  void constant(OpCode code) {
+    if (m_sharing) {
+      leaf(m_tape.number({code, 0, 0}));
+    }
+    emit(instruction(code));
+  }
+
+  // the leaf is about to be emitted
+  void leaf(std::uint32_t number) {
+    m_tape.m_values.push_back(
+        {number, static_cast<std::uint32_t>(m_tape.m_instructions.size())});
+  }
+
+  // the operands have effects, or contain a ternary that does not compute
+  // them on every path
+  void unshared(std::size_t operands) {
+    auto &values = m_tape.m_values;
+    auto start = values[values.size() - operands].start;
+    values.resize(values.size() - operands);
+    values.push_back({0, start});
+  }
+
+  void shared(Instruction const &op, std::size_t operands) {
+    if (!m_sharing) {
+      emit(op);
+      return;
+    }
+    auto &values = m_tape.m_values;
+    auto const first = values.size() - operands;
+    Key key{op.code, values[first].number,
+            operands == 2 ? values[first + 1].number : 0U};
+    auto start = values[first].start;
+    auto has_effects =
+        std::any_of(values.begin() + first, values.end(),
+                    [](auto value) { return value.number == 0; });
+    values.resize(first);
+    if (has_effects) {
+      emit(op);
+      values.push_back({0, start});
+      return;
+    }
+
+    auto &entry = m_tape.find(key);
+    if (m_tape.isValid(entry, key)) {
+      // the operands have no effects, all their instructions can go
+      auto &instructions = m_tape.m_instructions;
+      instructions.erase(instructions.begin() + start, instructions.end());
+      if (!entry.reused) {
+        entry.reused = true;
+        entry.temporary = m_tape.m_temporaries++;
+        m_tape.m_instructions[entry.instruction].store = entry.temporary + 1;
+      }
+      auto load = instruction(OpCode::LOAD);
+      load.temporary = entry.temporary;
+      emit(load);
+      values.push_back({entry.number, start});
+      return;
+    }
+
+    if (!m_tape.m_branch_starts.empty()) {
+      m_tape.m_branch_entries.push_back(
+          static_cast<std::size_t>(&entry - m_tape.m_table.data()));
+    }
+    entry = {key, ++m_tape.m_numbers,
+             static_cast<std::uint32_t>(m_tape.m_instructions.size()), 0,
+             m_tape.m_generation, false};
+    emit(op);
+    values.push_back({entry.number, start});
+  }
+
+  template <TokenType type>
+  static constexpr auto code() -> OpCode {
+    switch (type) {
+      case TokenType::TOKEN_EQUAL_EQUAL:
+        return OpCode::EQUAL;
+      case TokenType::TOKEN_BANG_EQUAL:
+        return OpCode::NOT_EQUAL;
+      case TokenType::TOKEN_LESS:
+        return OpCode::LESS;
+      case TokenType::TOKEN_LESS_EQUAL:
+        return OpCode::LESS_EQUAL;
+      case TokenType::TOKEN_GREATER:
+        return OpCode::GREATER;
+      case TokenType::TOKEN_GREATER_EQUAL:
+        return OpCode::GREATER_EQUAL;
+      case TokenType::TOKEN_PLUS:
+        return OpCode::ADD;
+      case TokenType::TOKEN_MINUS:
+        return OpCode::SUBTRACT;
+      case TokenType::TOKEN_STAR:
+        return OpCode::MULTIPLY;
+      default:
+        return OpCode::DIVIDE;
+    }
+  }
+
+  template <TokenType type>
+  static constexpr auto code(OperandTypes operands) -> OpCode {
+    if (operands == OperandTypes::NUMBERS) {
+      switch (type) {
+        case TokenType::TOKEN_EQUAL_EQUAL:
+          return OpCode::EQUAL_NUMBERS;
+        case TokenType::TOKEN_BANG_EQUAL:
+          return OpCode::NOT_EQUAL_NUMBERS;
+        case TokenType::TOKEN_LESS:
+          return OpCode::LESS_NUMBERS;
+        case TokenType::TOKEN_LESS_EQUAL:
+          return OpCode::LESS_EQUAL_NUMBERS;
+        case TokenType::TOKEN_GREATER:
+          return OpCode::GREATER_NUMBERS;
+        case TokenType::TOKEN_GREATER_EQUAL:
+          return OpCode::GREATER_EQUAL_NUMBERS;
+        case TokenType::TOKEN_PLUS:
+          return OpCode::ADD_NUMBERS;
+        case TokenType::TOKEN_MINUS:
+          return OpCode::SUBTRACT_NUMBERS;
+        case TokenType::TOKEN_STAR:
+          return OpCode::MULTIPLY_NUMBERS;
+        default:
+          return OpCode::DIVIDE_NUMBERS;
+      }
+    }
+    if (operands == OperandTypes::STRINGS) {
+      switch (type) {
+        case TokenType::TOKEN_EQUAL_EQUAL:
+          return OpCode::EQUAL_STRINGS;
+        case TokenType::TOKEN_BANG_EQUAL:
+          return OpCode::NOT_EQUAL_STRINGS;
+        case TokenType::TOKEN_PLUS:
+          return OpCode::ADD_STRINGS;
+        default:
+          break;
+      }
+    }
+    return code<type>();
+  }
+
+  template <TokenType type>
+  static constexpr auto variables() -> OpCode {
+    switch (type) {
+      case TokenType::TOKEN_EQUAL_EQUAL:
+        return OpCode::EQUAL_VARIABLES;
+      case TokenType::TOKEN_BANG_EQUAL:
+        return OpCode::NOT_EQUAL_VARIABLES;
+      case TokenType::TOKEN_LESS:
+        return OpCode::LESS_VARIABLES;
+      case TokenType::TOKEN_LESS_EQUAL:
+        return OpCode::LESS_EQUAL_VARIABLES;
+      case TokenType::TOKEN_GREATER:
+        return OpCode::GREATER_VARIABLES;
+      case TokenType::TOKEN_GREATER_EQUAL:
+        return OpCode::GREATER_EQUAL_VARIABLES;
+      case TokenType::TOKEN_PLUS:
+        return OpCode::ADD_VARIABLES;
+      case TokenType::TOKEN_MINUS:
+        return OpCode::SUBTRACT_VARIABLES;
+      case TokenType::TOKEN_STAR:
+        return OpCode::MULTIPLY_VARIABLES;
+      default:
+        return OpCode::DIVIDE_VARIABLES;
+    }
+  }
+};
+
+void Tape::compile(Expression const &expr) {
+  m_instructions.clear();
+  m_temporaries = 0;
+  if (m_sharing) {
+    m_values.clear();
+    m_branch_entries.clear();
+    m_branch_starts.clear();
+    m_numbers = 0;
+    if (++m_generation == 0) {
+      std::fill(m_table.begin(), m_table.end(), Entry{});
+      std::fill(m_variables.begin(), m_variables.end(), Variable{});
+      m_generation = 1;
+    }
+  }
+  Emitter emitter{*this};
+  // most expressions are that small, the walker costs more than emitting them
+  if (!emitter.shallow(expr)) {
+    m_walker.walk(expr, emitter);
+  }
+}
+
+void Tape::setSharing(bool enabled) {
+  m_sharing = enabled;
+  if (enabled && m_table.empty()) {
+    m_table.resize(std::size_t{1} << table_bits);
+  }
+}
+
+auto Tape::jump(OpCode code) -> std::uint32_t {
+  if (m_instructions.size() >= std::numeric_limits<std::uint32_t>::max()) {
+    throw std::length_error("Expression too long");
+  }
+  auto index = static_cast<std::uint32_t>(m_instructions.size());
+  m_instructions.push_back(instruction(code));
+  return index;
+}
+
+// the jump lands after the last instruction emitted
+void Tape::patch(std::uint32_t jump) {
+  m_instructions[jump].target =
+      static_cast<std::uint32_t>(m_instructions.size());
+}
+
+// the table is 2-way associative, so that the reused values are not evicted by
+// the ones computed once: a new key replaces the empty entry of its bucket,
+// else the one that was not reused, else the oldest
+auto Tape::find(Key const &key) -> Entry & {
+  auto hash = (key.right ^ (std::uint64_t{key.left} << 8U) ^
+               static_cast<std::uint64_t>(key.code)) *
+              0x9E3779B97F4A7C15ULL;
+  auto *bucket = &m_table[(hash >> (64 - table_bits)) & ~std::uint64_t{1}];
+  for (auto *entry : {bucket, bucket + 1}) {
+    if (isValid(*entry, key)) {
+      return *entry;
+    }
+  }
+  auto replaceable = [this](Entry const &entry) {
+    return entry.generation != m_generation || !entry.reused;
+  };
+  if (replaceable(bucket[0]) &&
+      (!replaceable(bucket[1]) || bucket[0].number < bucket[1].number)) {
+    return bucket[0];
+  }
+  return bucket[1];
+}
+
+auto Tape::number(Key const &key) -> std::uint32_t {
+  auto &entry = find(key);
+  if (isValid(entry, key)) {
+    entry.reused = true;
+  } else {
+    entry = {key, ++m_numbers, 0, 0, m_generation, false};
+  }
+  return entry.number;
+}
+
+auto Tape::isValid(Entry const &entry, Key const &key) const -> bool {
+  return entry.generation == m_generation && entry.key == key;
+}
+
+// the entry of a string is keyed by the hash of its content, which is compared
+// with the literal of the instruction of the entry
+auto Tape::string(std::string_view value) -> std::uint32_t {
+  Key key{OpCode::STRING, static_cast<std::uint32_t>(value.size()),
+          SymbolTable::hash(value)};
+  auto &entry = find(key);
+  if (isValid(entry, key) &&
+      m_instructions[entry.instruction].string->getValue() == value) {
+    entry.reused = true;
+  } else {
+    entry = {key, ++m_numbers,
+             static_cast<std::uint32_t>(m_instructions.size()), 0,
+             m_generation, false};
+  }
+  return entry.number;
+}
+
+auto Tape::variable(SymbolTable::Symbol symbol) -> Variable & {
+  if (symbol >= m_variables.size()) {
+    m_variables.resize(symbol + 1);
+  }
+  auto &variable = m_variables[symbol];
+  if (variable.generation != m_generation) {
+    variable = {++m_numbers, m_generation};
+  }
+  return variable;
+}
+
+// the reads of the variable that follow get a new value number, so the values
+// computed from the previous one are not found anymore
+void Tape::assign(SymbolTable::Symbol symbol) {
+  variable(symbol).number = ++m_numbers;
+}
+
+void Tape::enterBranch() { m_branch_starts.push_back(m_branch_entries.size()); }
+
+void Tape::leaveBranch() {
+  auto start = m_branch_starts.back();
+  m_branch_starts.pop_back();
+  for (auto i = start; i < m_branch_entries.size(); ++i) {
+    m_table[m_branch_entries[i]].generation = 0;
+  }
+  m_branch_entries.resize(start);
+}
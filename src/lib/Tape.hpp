@@ -0,0 +1,223 @@
+#ifndef CPPLOX_TAPE_HPP
+#define CPPLOX_TAPE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "Expression.hpp"
+#include "ExpressionWalker.hpp"
+#include "SourcePosition.hpp"
+
+/*
+An expression flattened in postorder: the operands of an instruction are the
+values the instructions before it left on the stack, and every expression
+leaves exactly one. Ternaries jump over the branch they do not take and the
+comma pops its left operand.
+
+It is compiled by an ExpressionWalker instead of native recursion, so the depth
+of the expressions is not limited by the native stack. Every expression runs
+once, and compiling it costs more than walking its tree: the Interpreter walks
+the tree by recursion and only runs a tape for the nodes deeper than its
+recursion goes, and for the whole expressions while sharing.
+
+The frequent sequences of instructions are fused into superinstructions, the
+shapes the recursion of the Interpreter reads the variables of in place: the
+code of the first instruction of the sequence is replaced by the code of the
+superinstruction, which runs the whole sequence in a single dispatch without
+going through the stack. The other instructions of the sequence stay in place
+as its operands and are skipped, so the jumps are not moved. Only the
+sequences of a single node and its leaves are fused, no jump can land inside
+them.
+
+While sharing, common subexpressions are computed once: the side-effect free
+subexpressions are hash-consed on the code of their instruction and the value
+numbers of their operands, and the value number of a variable is renewed by
+every assignment to it. When an expression is emitted again while the value of
+its first occurrence is available, that is not in a branch of a ternary that
+ended since, its instructions are replaced by a load of the temporary the first
+occurrence stores its result to. The table is bounded, an evicted expression is
+computed again.
+
+Sharing is disabled by default: every expression of a program runs once, and
+hashing its nodes costs about as much as computing the repeated ones again.
+*/
+class Tape {
+ public:
+  enum class OpCode : std::uint8_t {
+    NUMBER,
+    STRING,
+    TRUE,
+    FALSE,
+    NIL,
+    GET,
+    SET,
+    NEGATE,
+    NOT,
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    POP,
+    // pops the condition, jumps to target when it is falsy
+    JUMP_IF_FALSE,
+    JUMP,
+    // pushes the value of a temporary
+    LOAD,
+
+    // the operators whose operands the type inference proved to be numbers or
+    // strings, which do not check them
+    EQUAL_NUMBERS,
+    NOT_EQUAL_NUMBERS,
+    LESS_NUMBERS,
+    LESS_EQUAL_NUMBERS,
+    GREATER_NUMBERS,
+    GREATER_EQUAL_NUMBERS,
+    ADD_NUMBERS,
+    SUBTRACT_NUMBERS,
+    MULTIPLY_NUMBERS,
+    DIVIDE_NUMBERS,
+    EQUAL_STRINGS,
+    NOT_EQUAL_STRINGS,
+    ADD_STRINGS,
+
+    // superinstructions, see Tape
+    // x + n, x < n: GET, NUMBER, ADD or LESS
+    ADD_VARIABLE_NUMBER,
+    LESS_VARIABLE_NUMBER,
+    // x = x + n: GET, NUMBER, ADD, SET
+    INCREMENT,
+    // x op y: GET, GET, op, in the order of the binary operators
+    EQUAL_VARIABLES,
+    NOT_EQUAL_VARIABLES,
+    LESS_VARIABLES,
+    LESS_EQUAL_VARIABLES,
+    GREATER_VARIABLES,
+    GREATER_EQUAL_VARIABLES,
+    ADD_VARIABLES,
+    SUBTRACT_VARIABLES,
+    MULTIPLY_VARIABLES,
+    DIVIDE_VARIABLES,
+  };
+
+  // the member of the operand is selected by the code
+  struct Instruction {
+    OpCode code;
+    // index + 1 of the temporary the result is copied to, 0 when it is not.
+    // The result of a superinstruction is copied by its last instruction.
+    std::uint32_t store = 0;
+    union {
+      double number = 0;
+      Node<LiteralStringExpression> string;
+      Node<VariableExpression> variable;
+      Node<AssignExpression> assignment;
+      // of the operator, for the instructions that can fail
+      SourcePosition position;
+      std::uint32_t target;
+      std::uint32_t temporary;
+    };
+  };
+
+ private:
+  // a leaf is keyed by its symbol or its literal, the other expressions by the
+  // value numbers of their operands
+  struct Key {
+    OpCode code;
+    std::uint32_t left;
+    std::uint64_t right;
+
+    auto operator==(Key const &) const -> bool = default;
+  };
+
+  struct Entry {
+    Key key;
+    std::uint32_t number;
+    // of the first occurrence, which computes the value
+    std::uint32_t instruction;
+    // of the value of an expression, set once it is reused
+    std::uint32_t temporary;
+    // the entries of the previous compilations are empty
+    std::uint32_t generation;
+    // kept over the other entry of its bucket
+    bool reused;
+  };
+
+  struct Variable {
+    std::uint32_t number;
+    std::uint32_t generation;
+  };
+
+  // value number of an emitted expression, 0 when it has side effects, and
+  // the index of its first instruction
+  struct Value {
+    std::uint32_t number;
+    std::uint32_t start;
+  };
+
+  static constexpr unsigned table_bits = 10;
+
+  std::vector<Instruction> m_instructions;
+  ExpressionWalker m_walker;
+  // jumps waiting for the end of the branch they skip
+  std::vector<std::uint32_t> m_jumps;
+
+  bool m_sharing = false;
+  std::vector<Entry> m_table;
+  // indexed by symbol
+  std::vector<Variable> m_variables;
+  std::uint32_t m_generation = 0;
+  std::uint32_t m_numbers = 0;
+  std::uint32_t m_temporaries = 0;
+  std::vector<Value> m_values;
+  // entries added in the branches of the ternaries being compiled, and the
+  // number of them when each branch started
+  std::vector<std::size_t> m_branch_entries;
+  std::vector<std::size_t> m_branch_starts;
+
+ public:
+  // replaces the content of the tape by expr, the nodes of expr must outlive
+  // the tape or its next compilation
+  void compile(Expression const &expr);
+
+  [[nodiscard]] inline auto getInstructions() const
+      -> std::span<Instruction const> {
+    return m_instructions;
+  }
+  // number of temporaries the instructions use
+  [[nodiscard]] inline auto getTemporaries() const -> std::uint32_t {
+    return m_temporaries;
+  }
+  [[nodiscard]] inline auto isSharing() const -> bool { return m_sharing; }
+  void setSharing(bool enabled);
+
+ private:
+  struct Emitter;
+
+  // emits a jump and returns its index, to patch its target
+  auto jump(OpCode code) -> std::uint32_t;
+  void patch(std::uint32_t jump);
+
+  // entry of key, or the entry it replaces when it is not in the table
+  auto find(Key const &key) -> Entry &;
+  // value number of a literal
+  auto number(Key const &key) -> std::uint32_t;
+  // value number of a string literal about to be emitted
+  auto string(std::string_view value) -> std::uint32_t;
+  auto variable(SymbolTable::Symbol symbol) -> Variable &;
+  auto isValid(Entry const &entry, Key const &key) const -> bool;
+  // the value of the variable changes
+  void assign(SymbolTable::Symbol symbol);
+  void enterBranch();
+  // the values computed in the branch are no longer available
+  void leaveBranch();
+};
+
+#endif /* CPPLOX_TAPE_HPP */
@@ -0,0 +1,67 @@
+#include "Token.hpp"
+
+#include <fmt/core.h>
+
+void TokenBuffer::reserve(std::size_t size) {
+  m_types.reserve(size);
+  m_positions.reserve(size);
+  m_values.reserve(size);
+}
+
+void TokenBuffer::clear() {
+  m_types.clear();
+  m_positions.clear();
+  m_values.clear();
+  m_numbers.clear();
+  m_strings.clear();
+}
+
+void TokenBuffer::append(TokenBuffer const &other, std::uint64_t offset,
+                         std::vector<SymbolTable::Symbol> const &symbols) {
+  auto number_offset = static_cast<Index>(m_numbers.size());
+  auto string_offset = static_cast<Index>(m_strings.size());
+
+  m_types.insert(m_types.end(), other.m_types.begin(), other.m_types.end());
+  m_numbers.insert(m_numbers.end(), other.m_numbers.begin(),
+                   other.m_numbers.end());
+  m_strings.insert(m_strings.end(), other.m_strings.begin(),
+                   other.m_strings.end());
+
+  m_positions.reserve(m_positions.size() + other.size());
+  m_values.reserve(m_values.size() + other.size());
+  for (Index i = 0; i < other.size(); ++i) {
+    m_positions.push_back(other.m_positions[i].withOffset(offset));
+    auto value = other.m_values[i];
+    switch (other.m_types[i]) {
+      case TokenType::TOKEN_NUMBER:
+        value += number_offset;
+        break;
+      case TokenType::TOKEN_STRING:
+        value += string_offset;
+        break;
+      case TokenType::TOKEN_IDENTIFIER:
+        value = symbols[value];
+        break;
+      default:
+        break;
+    }
+    m_values.push_back(value);
+  }
+}
+
+[[nodiscard]] auto TokenBuffer::toString(Index i) const -> std::string {
+  auto type = getType(i);
+  switch (type) {
+    case TokenType::TOKEN_NUMBER:
+      return fmt::format("[{}] - {}", Enums::enum_to_string(type),
+                         getNumber(i));
+    case TokenType::TOKEN_STRING:
+      return fmt::format("[{}] - {}", Enums::enum_to_string(type),
+                         getString(i));
+    case TokenType::TOKEN_IDENTIFIER:
+      return fmt::format("[{}] - #{}", Enums::enum_to_string(type),
+                         getSymbol(i));
+    default:
+      return fmt::format("[{}]", Enums::enum_to_string(type));
+  }
+}
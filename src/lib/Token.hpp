@@ -1,9 +1,15 @@
 #ifndef CPPLOX_TOKEN_HPP
 #define CPPLOX_TOKEN_HPP
 
-#include <fmt/core.h>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "SourcePosition.hpp"
+#include "SymbolTable.hpp"
 #include "utils/Enums.hpp"
 
 enum class TokenType {
@@ -55,26 +61,75 @@ enum class TokenType {
   TOKEN_EOF
 };
 
-class Token {
-  SourcePosition m_position;
-
- protected:
-  Token(SourcePosition position) : m_position(position) {}
-
- public:
-  virtual ~Token() = default;
-  Token(const Token&) = delete;
-  Token(Token&&) = delete;
-  auto operator=(const Token&) -> Token& = delete;
-  auto operator=(Token&&) -> Token& = delete;
-
-  [[nodiscard]] auto getPosition() const -> SourcePosition const& {
-    return m_position;
+// spelling of the punctuation tokens, empty for every other token type
+constexpr auto token_lexeme(TokenType type) -> std::string_view {
+  switch (type) {
+    case TokenType::TOKEN_LEFT_PAREN:
+      return "(";
+    case TokenType::TOKEN_RIGHT_PAREN:
+      return ")";
+    case TokenType::TOKEN_LEFT_BRACE:
+      return "{";
+    case TokenType::TOKEN_RIGHT_BRACE:
+      return "}";
+    case TokenType::TOKEN_COMMA:
+      return ",";
+    case TokenType::TOKEN_DOT:
+      return ".";
+    case TokenType::TOKEN_MINUS:
+      return "-";
+    case TokenType::TOKEN_PLUS:
+      return "+";
+    case TokenType::TOKEN_SEMICOLON:
+      return ";";
+    case TokenType::TOKEN_SLASH:
+      return "/";
+    case TokenType::TOKEN_STAR:
+      return "*";
+    case TokenType::TOKEN_QUESTION:
+      return "?";
+    case TokenType::TOKEN_COLON:
+      return ":";
+    case TokenType::TOKEN_BANG:
+      return "!";
+    case TokenType::TOKEN_BANG_EQUAL:
+      return "!=";
+    case TokenType::TOKEN_EQUAL:
+      return "=";
+    case TokenType::TOKEN_EQUAL_EQUAL:
+      return "==";
+    case TokenType::TOKEN_GREATER:
+      return ">";
+    case TokenType::TOKEN_GREATER_EQUAL:
+      return ">=";
+    case TokenType::TOKEN_LESS:
+      return "<";
+    case TokenType::TOKEN_LESS_EQUAL:
+      return "<=";
+    case TokenType::TOKEN_IDENTIFIER:
+    case TokenType::TOKEN_STRING:
+    case TokenType::TOKEN_NUMBER:
+    case TokenType::TOKEN_AND:
+    case TokenType::TOKEN_CLASS:
+    case TokenType::TOKEN_ELSE:
+    case TokenType::TOKEN_FALSE:
+    case TokenType::TOKEN_FUN:
+    case TokenType::TOKEN_FOR:
+    case TokenType::TOKEN_IF:
+    case TokenType::TOKEN_NIL:
+    case TokenType::TOKEN_OR:
+    case TokenType::TOKEN_PRINT:
+    case TokenType::TOKEN_RETURN:
+    case TokenType::TOKEN_SUPER:
+    case TokenType::TOKEN_THIS:
+    case TokenType::TOKEN_TRUE:
+    case TokenType::TOKEN_VAR:
+    case TokenType::TOKEN_WHILE:
+    case TokenType::TOKEN_EOF:
+      return "";
   }
-
-  [[nodiscard]] virtual auto getType() const -> TokenType = 0;
-  [[nodiscard]] virtual auto toString() const -> std::string = 0;
-};
+  return "";
+}
 
 template <TokenType type>
 constexpr auto is_value_token() -> bool {
@@ -82,60 +137,97 @@ constexpr auto is_value_token() -> bool {
          type == TokenType::TOKEN_IDENTIFIER;
 }
 
-template <TokenType type>
-  requires(!is_value_token<type>())
-class BasicToken : public Token {
+/*
+Tokens are stored as a struct of arrays: the type and position of every token
+live in parallel contiguous arrays, and the payload of value tokens is kept in
+side tables indexed through m_values. Identifiers are interned by the lexer,
+their m_values entry is their symbol.
+*/
+class TokenBuffer {
  public:
-  BasicToken(SourcePosition position) : Token(position) {}
+  using Index = std::uint32_t;
 
-  [[nodiscard]] auto getType() const -> TokenType override { return type; }
+ private:
+  std::vector<TokenType> m_types;
+  std::vector<SourcePosition> m_positions;
+  std::vector<Index> m_values;
 
-  [[nodiscard]] inline auto toString() const -> std::string override {
-    return fmt::format("[{}]", Enums::enum_to_string(type));
-  }
-};
-
-template <TokenType type>
-class ValueToken;
-
-template <>
-class ValueToken<TokenType::TOKEN_NUMBER> : public Token {
-  double const m_value;
+  std::vector<double> m_numbers;
+  std::vector<std::string_view> m_strings;
 
  public:
-  ValueToken(double value, SourcePosition position)
-      : Token(position), m_value(value) {}
+  template <TokenType type>
+    requires(!is_value_token<type>())
+  void push(SourcePosition position) {
+    pushToken(type, position, 0);
+  }
 
-  [[nodiscard]] auto getType() const -> TokenType override {
-    return TokenType::TOKEN_NUMBER;
+  // for token types only known at runtime, which must not be value tokens
+  void push(TokenType type, SourcePosition position) {
+    pushToken(type, position, 0);
   }
 
-  [[nodiscard]] inline auto toString() const -> std::string override {
-    return fmt::format("[{}] - {}",
-                       Enums::enum_to_string(TokenType::TOKEN_NUMBER), m_value);
+  template <TokenType type>
+    requires(type == TokenType::TOKEN_NUMBER)
+  void push(SourcePosition position, double value) {
+    pushToken(type, position, static_cast<Index>(m_numbers.size()));
+    m_numbers.push_back(value);
   }
 
-  [[nodiscard]] inline auto getValue() const -> double { return m_value; }
-};
+  template <TokenType type>
+    requires(type == TokenType::TOKEN_STRING)
+  void push(SourcePosition position, std::string_view value) {
+    pushToken(type, position, static_cast<Index>(m_strings.size()));
+    m_strings.push_back(value);
+  }
 
-template <TokenType type>
-  requires(type == TokenType::TOKEN_STRING ||
-           type == TokenType::TOKEN_IDENTIFIER)
-class ValueToken<type> : public Token {
-  std::string_view const m_value;
+  template <TokenType type>
+    requires(type == TokenType::TOKEN_IDENTIFIER)
+  void push(SourcePosition position, SymbolTable::Symbol symbol) {
+    pushToken(type, position, symbol);
+  }
 
- public:
-  ValueToken(std::string_view value, SourcePosition position)
-      : Token(position), m_value(value) {}
+  void reserve(std::size_t size);
+  void clear();
+
+  // appends the tokens of a buffer lexed from a part of the source starting
+  // offset bytes after the start of this buffer's source, its identifiers are
+  // translated through symbols
+  void append(TokenBuffer const &other, std::uint64_t offset,
+              std::vector<SymbolTable::Symbol> const &symbols);
 
-  [[nodiscard]] auto getType() const -> TokenType override { return type; }
+  [[nodiscard]] inline auto size() const -> Index {
+    return static_cast<Index>(m_types.size());
+  }
+  [[nodiscard]] inline auto empty() const -> bool { return m_types.empty(); }
 
-  [[nodiscard]] inline auto toString() const -> std::string override {
-    return fmt::format("[{}] - {}", Enums::enum_to_string(type), m_value);
+  [[nodiscard]] inline auto getType(Index i) const -> TokenType {
+    return m_types[i];
+  }
+  [[nodiscard]] inline auto getPosition(Index i) const
+      -> SourcePosition const & {
+    return m_positions[i];
+  }
+  [[nodiscard]] inline auto getNumber(Index i) const -> double {
+    return m_numbers[m_values[i]];
   }
+  [[nodiscard]] inline auto getString(Index i) const -> std::string_view {
+    return m_strings[m_values[i]];
+  }
+  [[nodiscard]] inline auto getSymbol(Index i) const -> SymbolTable::Symbol {
+    return m_values[i];
+  }
+
+  [[nodiscard]] auto toString(Index i) const -> std::string;
 
-  [[nodiscard]] inline auto getValue() const -> std::string_view {
-    return m_value;
+ private:
+  inline void pushToken(TokenType type, SourcePosition position, Index value) {
+    if (m_types.size() == std::numeric_limits<Index>::max()) {
+      throw std::length_error("Too many tokens");
+    }
+    m_types.push_back(type);
+    m_positions.push_back(position);
+    m_values.push_back(value);
   }
 };
 
@@ -0,0 +1,146 @@
+#include "TypeInference.hpp"
+
+#include <cstdint>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include "Bindings.hpp"
+#include "ExpressionWalker.hpp"
+#include "StatementWalker.hpp"
+
+namespace {
+// of the value of an expression whenever it does not fail
+enum class Type : std::uint8_t { UNKNOWN, NUMBER, STRING };
+
+// walks the program in the order it runs, the types of the operands of a node
+// are on top of m_types when it is left
+class Inference {
+  Bindings<Type> m_bindings;
+  StatementWalker m_statements;
+  ExpressionWalker m_walker;
+  std::vector<Type> m_types;
+
+ public:
+  void infer(std::span<Statement const> statements) {
+    m_statements.walk(statements, *this);
+  }
+
+  void operator()(Node<ExpressionStatement> const &s) {
+    typeOf(s->getExpression());
+  }
+  void operator()(Node<PrintStatement> const &s) {
+    typeOf(s->getExpression());
+  }
+  void operator()(Node<VariableDeclaration> const &s) {
+    auto const &initializer = s->getInitializer();
+    auto type = initializer.has_value() ? typeOf(initializer.value())
+                                        : Type::UNKNOWN;
+    m_bindings.declare(s->getSymbol(), type);
+  }
+  void enterBlock([[maybe_unused]] Node<BlockStatement> const &s) {
+    m_bindings.push();
+  }
+  void leaveBlock([[maybe_unused]] Node<BlockStatement> const &s) {
+    m_bindings.pop();
+  }
+
+  void next(Expression const &expr, std::uint8_t operand) {
+    if (!std::holds_alternative<Node<TernaryExpression> >(expr)) {
+      return;
+    }
+    if (operand == 1) {
+      m_bindings.enterTrueBranch();
+    } else {
+      m_bindings.enterFalseBranch();
+    }
+  }
+  void leave(Expression const &expr) { std::visit(*this, expr); }
+
+  void operator()([[maybe_unused]] Node<LiteralNumberExpression> const &e) {
+    m_types.push_back(Type::NUMBER);
+  }
+  void operator()([[maybe_unused]] Node<LiteralStringExpression> const &e) {
+    m_types.push_back(Type::STRING);
+  }
+  template <TokenType type>
+  void operator()([[maybe_unused]] Node<LiteralExpression<type> > const &e) {
+    m_types.push_back(Type::UNKNOWN);
+  }
+  void operator()(Node<VariableExpression> const &e) {
+    auto const *type = m_bindings.find(e->getSymbol());
+    m_types.push_back(type != nullptr ? *type : Type::UNKNOWN);
+  }
+  void operator()([[maybe_unused]] Node<GroupingExpression> const &e) {}
+  void operator()([[maybe_unused]] Node<TernaryExpression> const &e) {
+    auto false_type = pop();
+    auto true_type = pop();
+    m_types.back() = true_type == false_type ? true_type : Type::UNKNOWN;
+    m_bindings.leaveTernary();
+  }
+  void operator()(Node<AssignExpression> const &e) {
+    m_bindings.assign(e->getSymbol(), m_types.back());
+  }
+  template <TokenType type>
+  void operator()([[maybe_unused]] Node<UnaryExpression<type> > const &e) {
+    m_types.back() =
+        type == TokenType::TOKEN_MINUS ? Type::NUMBER : Type::UNKNOWN;
+  }
+  void operator()(
+      [[maybe_unused]] Node<BinaryExpression<TokenType::TOKEN_COMMA> > const
+          &e) {
+    auto right = pop();
+    m_types.back() = right;
+  }
+  template <TokenType type>
+  void operator()(Node<BinaryExpression<type> > const &e) {
+    auto right = pop();
+    auto left = m_types.back();
+    auto numbers = left == Type::NUMBER && right == Type::NUMBER;
+    auto strings = left == Type::STRING && right == Type::STRING;
+    constexpr auto takes_strings = type == TokenType::TOKEN_PLUS ||
+                                   type == TokenType::TOKEN_EQUAL_EQUAL ||
+                                   type == TokenType::TOKEN_BANG_EQUAL;
+    e->setOperandTypes(numbers                    ? OperandTypes::NUMBERS
+                       : strings && takes_strings ? OperandTypes::STRINGS
+                                                  : OperandTypes::UNKNOWN);
+
+    switch (type) {
+      case TokenType::TOKEN_MINUS:
+      case TokenType::TOKEN_STAR:
+      case TokenType::TOKEN_SLASH:
+        m_types.back() = Type::NUMBER;
+        break;
+      // once one operand is known, the other one has its type or the
+      // addition fails
+      case TokenType::TOKEN_PLUS:
+        m_types.back() = left == Type::NUMBER || right == Type::NUMBER
+                             ? Type::NUMBER
+                         : left == Type::STRING || right == Type::STRING
+                             ? Type::STRING
+                             : Type::UNKNOWN;
+        break;
+      default:
+        m_types.back() = Type::UNKNOWN;
+        break;
+    }
+  }
+
+ private:
+  auto typeOf(Expression const &expr) -> Type {
+    m_walker.walk(expr, *this);
+    return pop();
+  }
+
+  auto pop() -> Type {
+    auto type = m_types.back();
+    m_types.pop_back();
+    return type;
+  }
+};
+}  // namespace
+
+void TypeInference::infer(Program &program) {
+  Inference inference;
+  inference.infer(program.getStatements());
+}
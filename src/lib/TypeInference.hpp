@@ -0,0 +1,22 @@
+#ifndef CPPLOX_TYPEINFERENCE_HPP
+#define CPPLOX_TYPEINFERENCE_HPP
+
+#include "Statement.hpp"
+
+/*
+Pass that proves the binary expressions whose operands are always numbers, or
+always strings, and marks them with their OperandTypes so that the interpreter
+runs them without checking the types of their operands. The types of the
+variables follow the program in the order it runs, through the assignments and
+the branches of the ternaries. The variables of other programs, and those the
+branches of a ternary disagree on, have no known type.
+
+It does not rewrite the program, and has to run after the passes that do: the
+nodes they build are not marked.
+*/
+class TypeInference {
+ public:
+  static void infer(Program &program);
+};
+
+#endif /* CPPLOX_TYPEINFERENCE_HPP */
@@ -0,0 +1,73 @@
+#include "Value.hpp"
+
+#include <vector>
+
+auto Value::concatenate(Value const &left, Value const &right) -> Value {
+  auto &l = left.string();
+  auto &r = right.string();
+  auto size = l.size + r.size;
+  if (size <= flat_size) {
+    auto value = allocate(size);
+    auto *characters = value.string().characters;
+    auto left_string = left.getString();
+    auto right_string = right.getString();
+    std::memcpy(characters, left_string.data(), left_string.size());
+    std::memcpy(characters + left_string.size(), right_string.data(),
+                right_string.size());
+    return value;
+  }
+  ++l.references;
+  ++r.references;
+  auto *rope =
+      new (::operator new(sizeof(String))) String{size, nullptr, &l, &r};
+  return Value{string_tag | reinterpret_cast<std::uintptr_t>(rope), true};
+}
+
+void Value::flatten(String &rope) {
+  auto *characters = new char[rope.size];
+  auto *cursor = characters;
+  // the operands left to copy, in reverse order
+  std::vector<String const *> pending{rope.right, rope.left};
+  while (!pending.empty()) {
+    auto const *string = pending.back();
+    pending.pop_back();
+    if (string->characters != nullptr) {
+      std::memcpy(cursor, string->characters, string->size);
+      cursor += string->size;
+    } else {
+      pending.push_back(string->right);
+      pending.push_back(string->left);
+    }
+  }
+  for (auto *operand : {rope.left, rope.right}) {
+    if (--operand->references == 0) {
+      free(operand);
+    }
+  }
+  rope.left = nullptr;
+  rope.right = nullptr;
+  rope.characters = characters;
+  rope.flattened = true;
+}
+
+void Value::free(String *string) {
+  std::vector<String *> pending;
+  while (true) {
+    if (string->left != nullptr) {
+      for (auto *operand : {string->left, string->right}) {
+        if (--operand->references == 0) {
+          pending.push_back(operand);
+        }
+      }
+    }
+    if (string->flattened) {
+      delete[] string->characters;
+    }
+    ::operator delete(string);
+    if (pending.empty()) {
+      return;
+    }
+    string = pending.back();
+    pending.pop_back();
+  }
+}
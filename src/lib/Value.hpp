@@ -0,0 +1,168 @@
+#ifndef CPPLOX_VALUE_HPP
+#define CPPLOX_VALUE_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <utility>
+
+/*
+A value of the Interpreter in 8 bytes, NaN-boxed: a number is stored as its
+double, the other values in the payload of a quiet NaN with the bit below the
+quiet bit set, which no arithmetic on numbers produces. The booleans and nil
+are immediates, a string points to a heap object whose references are counted
+and which is freed with the last one.
+
+A long concatenation is a rope: it references its operands instead of copying
+them, so appending to a string costs O(1) however long it grew. Its characters
+are only joined, once, when they are read to be printed or compared.
+
+Undefined is the state of a variable declared without an initializer, no
+expression evaluates to it and it is never visited.
+*/
+class Value {
+  struct String {
+    std::size_t size;
+    // follow the object for the literals and the short concatenations,
+    // nullptr until a rope is flattened
+    char *characters;
+    // the operands of a rope until it is flattened
+    String *left;
+    String *right;
+    std::uint32_t references = 1;
+    // the characters were allocated by flatten
+    bool flattened = false;
+  };
+
+  // the concatenations up to this size are copied instead of being ropes
+  static constexpr std::size_t flat_size = 64;
+
+  static constexpr std::uint64_t quiet_nan = 0x7ffc000000000000;
+  static constexpr std::uint64_t sign = 0x8000000000000000;
+  static constexpr std::uint64_t nil_bits = quiet_nan | 1;
+  static constexpr std::uint64_t false_bits = quiet_nan | 2;
+  static constexpr std::uint64_t true_bits = quiet_nan | 3;
+  static constexpr std::uint64_t undefined_bits = quiet_nan | 4;
+  // tag of the strings, the pointer is in the low 48 bits
+  static constexpr std::uint64_t string_tag = sign | quiet_nan;
+
+  std::uint64_t m_bits = nil_bits;
+
+  explicit Value(std::uint64_t bits, [[maybe_unused]] bool tagged)
+      : m_bits(bits) {}
+
+ public:
+  Value() = default;
+  Value(double number) : m_bits(std::bit_cast<std::uint64_t>(number)) {}
+  Value(bool boolean) : m_bits(boolean ? true_bits : false_bits) {}
+  Value([[maybe_unused]] std::nullptr_t nil) {}
+  explicit Value(std::string_view string) : Value(allocate(string.size())) {
+    std::memcpy(this->string().characters, string.data(), string.size());
+  }
+  // not a bool
+  Value(char const *string) = delete;
+
+  Value(Value const &other) : m_bits(other.m_bits) {
+    if (isString()) {
+      ++string().references;
+    }
+  }
+  Value(Value &&other) noexcept
+      : m_bits(std::exchange(other.m_bits, nil_bits)) {}
+  auto operator=(Value const &other) -> Value & {
+    Value copy{other};
+    std::swap(m_bits, copy.m_bits);
+    return *this;
+  }
+  auto operator=(Value &&other) noexcept -> Value & {
+    std::swap(m_bits, other.m_bits);
+    return *this;
+  }
+  ~Value() {
+    if (isString() && --string().references == 0) {
+      free(&string());
+    }
+  }
+
+  [[nodiscard]] static auto undefined() -> Value {
+    return Value{undefined_bits, true};
+  }
+  // the string of the characters of the strings left and right
+  [[nodiscard]] static auto concatenate(Value const &left, Value const &right)
+      -> Value;
+
+  [[nodiscard]] inline auto isNumber() const -> bool {
+    return (m_bits & quiet_nan) != quiet_nan;
+  }
+  [[nodiscard]] inline auto isBool() const -> bool {
+    return (m_bits | 1) == true_bits;
+  }
+  [[nodiscard]] inline auto isNil() const -> bool { return m_bits == nil_bits; }
+  [[nodiscard]] inline auto isString() const -> bool {
+    return (m_bits & string_tag) == string_tag;
+  }
+  [[nodiscard]] inline auto isUndefined() const -> bool {
+    return m_bits == undefined_bits;
+  }
+
+  // the getters expect a value of their type
+  [[nodiscard]] inline auto getNumber() const -> double {
+    return std::bit_cast<double>(m_bits);
+  }
+  [[nodiscard]] inline auto getBool() const -> bool {
+    return m_bits == true_bits;
+  }
+  // flattens the string if it is a rope
+  [[nodiscard]] inline auto getString() const -> std::string_view {
+    auto &string = this->string();
+    if (string.characters == nullptr) {
+      flatten(string);
+    }
+    return {string.characters, string.size};
+  }
+
+  // calls visitor with the bool, double, std::string_view or std::nullptr_t
+  // the value holds, as std::visit would
+  template <typename Visitor>
+  auto visit(Visitor &&visitor) const {
+    if (isNumber()) {
+      return visitor(getNumber());
+    }
+    if (isString()) {
+      return visitor(getString());
+    }
+    if (isNil()) {
+      return visitor(nullptr);
+    }
+    return visitor(getBool());
+  }
+  template <typename Visitor>
+  static auto visit(Visitor &&visitor, Value const &left, Value const &right) {
+    return left.visit([&visitor, &right](auto const &l) {
+      return right.visit(
+          [&visitor, &l](auto const &r) { return visitor(l, r); });
+    });
+  }
+
+ private:
+  // a flat string of size characters, left uninitialized
+  static auto allocate(std::size_t size) -> Value {
+    auto *string = new (::operator new(sizeof(String) + size))
+        String{size, nullptr, nullptr, nullptr};
+    string->characters = reinterpret_cast<char *>(string + 1);
+    return Value{string_tag | reinterpret_cast<std::uintptr_t>(string), true};
+  }
+  [[nodiscard]] inline auto string() const -> String & {
+    return *reinterpret_cast<String *>(m_bits & ~string_tag);
+  }
+  // joins the characters of the operands of the rope, and releases them
+  static void flatten(String &rope);
+  // frees string and the operands it was the last reference of, without
+  // recursion: the ropes of long concatenations are deep
+  static void free(String *string);
+};
+
+#endif /* CPPLOX_VALUE_HPP */
@@ -0,0 +1,339 @@
+#include "VirtualMachine.hpp"
+
+#include <fmt/core.h>
+
+#include <cstring>
+#include <utility>
+
+#include "Environment.hpp"
+
+namespace {
+using OpCode = Bytecode::OpCode;
+using Value = Interpreter::ExpressionValue;
+
+auto operand(std::uint8_t const *&ip) -> std::uint32_t {
+  std::uint32_t value = 0;
+  std::memcpy(&value, ip, sizeof(value));
+  ip += sizeof(value);
+  return value;
+}
+
+// the operands of a binary instruction whose types were proven, the left one
+// is replaced by the result
+auto provenNumbers(Value *&sp) -> std::pair<double, double> {
+  --sp;
+  return {sp[-1].getNumber(), sp[0].getNumber()};
+}
+}  // namespace
+
+VirtualMachine::VirtualMachine(std::vector<Statement> const &statements,
+                               Environment &environment,
+                               ErrorReporter &error_reporter)
+    : m_source([&statements] {
+        return std::span<Statement const>{statements};
+      }),
+      m_environment(environment),
+      m_error_reporter(error_reporter) {}
+
+VirtualMachine::VirtualMachine(Bytecode bytecode, Source source,
+                               Environment &environment,
+                               ErrorReporter &error_reporter)
+    : m_source(std::move(source)),
+      m_environment(environment),
+      m_error_reporter(error_reporter),
+      m_bytecode(std::move(bytecode)) {}
+
+auto VirtualMachine::compile() -> bool {
+  if (m_compiled) {
+    return true;
+  }
+  try {
+    if (m_bytecode.getCode().empty()) {
+      m_bytecode.compile(m_source());
+    }
+    for (auto literal : m_bytecode.getStrings()) {
+      m_strings.emplace_back(literal);
+    }
+    m_stack.resize(m_bytecode.getStackSize());
+    m_locals.resize(m_bytecode.getLocals());
+  } catch (...) {
+    m_bytecode = Bytecode{};
+    m_strings.clear();
+    m_error_reporter.setError("Unexpected error while interpreting");
+    return false;
+  }
+  m_compiled = true;
+  return true;
+}
+
+auto VirtualMachine::interpret()
+    -> std::optional<std::vector<std::string> const> {
+  if (!compile()) {
+    return std::nullopt;
+  }
+  try {
+    m_globals.assign(m_bytecode.getGlobals().size(), nullptr);
+    m_values.clear();
+    run();
+    return m_values;
+  } catch (Interpreter::InterpreterException &e) {
+  } catch (...) {
+    m_error_reporter.setError("Unexpected error while interpreting");
+  }
+  return std::nullopt;
+}
+
+void VirtualMachine::run() {
+  auto const *const code = m_bytecode.getCode().data();
+  auto const numbers = m_bytecode.getNumbers();
+  auto const *const strings = m_strings.data();
+  auto const *ip = code;
+  // one past the top of the stack
+  auto *sp = m_stack.data();
+
+  // the operands of a binary instruction, the left one is replaced by the
+  // result
+  auto numberOperands = [this, &sp](std::uint32_t offset) {
+    if (!sp[-2].isNumber() || !sp[-1].isNumber()) {
+      throw error(offset, "Operands must be numbers");
+    }
+    --sp;
+    return std::pair{sp[-1].getNumber(), sp[0].getNumber()};
+  };
+
+  while (true) {
+    auto const offset = static_cast<std::uint32_t>(ip - code);
+    switch (static_cast<OpCode>(*ip++)) {
+      case OpCode::NUMBER:
+        *sp++ = numbers[operand(ip)];
+        break;
+      case OpCode::STRING:
+        *sp++ = strings[operand(ip)];
+        break;
+      case OpCode::TRUE:
+        *sp++ = true;
+        break;
+      case OpCode::FALSE:
+        *sp++ = false;
+        break;
+      case OpCode::NIL:
+        *sp++ = nullptr;
+        break;
+      case OpCode::GET_GLOBAL: {
+        auto *slot = m_globals[operand(ip)];
+        *sp++ = initialized(slot != nullptr ? *slot : global(offset), offset);
+        break;
+      }
+      case OpCode::SET_GLOBAL: {
+        auto *slot = m_globals[operand(ip)];
+        (slot != nullptr ? *slot : global(offset)) = sp[-1];
+        break;
+      }
+      case OpCode::STORE_GLOBAL: {
+        auto *slot = m_globals[operand(ip)];
+        (slot != nullptr ? *slot : global(offset)) = std::move(*--sp);
+        break;
+      }
+      case OpCode::DEFINE_GLOBAL: {
+        auto index = operand(ip);
+        m_globals[index] = &m_environment.define(
+            m_bytecode.getGlobals()[index], std::move(*--sp));
+        break;
+      }
+      case OpCode::DECLARE_GLOBAL: {
+        auto index = operand(ip);
+        m_globals[index] = &m_environment.define(
+            m_bytecode.getGlobals()[index], Value::undefined());
+        break;
+      }
+      case OpCode::GET_LOCAL:
+        *sp++ = initialized(m_locals[operand(ip)], offset);
+        break;
+      case OpCode::SET_LOCAL:
+        m_locals[operand(ip)] = sp[-1];
+        break;
+      case OpCode::STORE_LOCAL:
+        m_locals[operand(ip)] = std::move(*--sp);
+        break;
+      case OpCode::DECLARE_LOCAL:
+        m_locals[operand(ip)] = Value::undefined();
+        break;
+      case OpCode::NEGATE: {
+        if (!sp[-1].isNumber()) {
+          throw error(offset, "Operand must be a number");
+        }
+        sp[-1] = -sp[-1].getNumber();
+        break;
+      }
+      case OpCode::NOT:
+        sp[-1] = !Interpreter::isTruthy(sp[-1]);
+        break;
+      case OpCode::EQUAL:
+      case OpCode::NOT_EQUAL: {
+        auto equal = Interpreter::isEqual(sp[-2], sp[-1]);
+        --sp;
+        sp[-1] = (code[offset] == static_cast<std::uint8_t>(OpCode::EQUAL)) ==
+                 equal;
+        break;
+      }
+      case OpCode::LESS: {
+        auto [l, r] = numberOperands(offset);
+        sp[-1] = l < r;
+        break;
+      }
+      case OpCode::LESS_EQUAL: {
+        auto [l, r] = numberOperands(offset);
+        sp[-1] = l <= r;
+        break;
+      }
+      case OpCode::GREATER: {
+        auto [l, r] = numberOperands(offset);
+        sp[-1] = l > r;
+        break;
+      }
+      case OpCode::GREATER_EQUAL: {
+        auto [l, r] = numberOperands(offset);
+        sp[-1] = l >= r;
+        break;
+      }
+      case OpCode::ADD: {
+        if (sp[-2].isNumber() && sp[-1].isNumber()) {
+          sp[-2] = sp[-2].getNumber() + sp[-1].getNumber();
+          --sp;
+          break;
+        }
+        if (sp[-2].isString() && sp[-1].isString()) {
+          sp[-2] = Value::concatenate(sp[-2], sp[-1]);
+          --sp;
+          break;
+        }
+        throw error(offset, "Operands must be two numbers or two strings");
+      }
+      case OpCode::SUBTRACT: {
+        auto [l, r] = numberOperands(offset);
+        sp[-1] = l - r;
+        break;
+      }
+      case OpCode::MULTIPLY: {
+        auto [l, r] = numberOperands(offset);
+        sp[-1] = l * r;
+        break;
+      }
+      case OpCode::DIVIDE: {
+        auto [l, r] = numberOperands(offset);
+        sp[-1] = l / r;
+        break;
+      }
+      case OpCode::EQUAL_NUMBERS: {
+        auto [l, r] = provenNumbers(sp);
+        sp[-1] = l == r;
+        break;
+      }
+      case OpCode::NOT_EQUAL_NUMBERS: {
+        auto [l, r] = provenNumbers(sp);
+        sp[-1] = l != r;
+        break;
+      }
+      case OpCode::LESS_NUMBERS: {
+        auto [l, r] = provenNumbers(sp);
+        sp[-1] = l < r;
+        break;
+      }
+      case OpCode::LESS_EQUAL_NUMBERS: {
+        auto [l, r] = provenNumbers(sp);
+        sp[-1] = l <= r;
+        break;
+      }
+      case OpCode::GREATER_NUMBERS: {
+        auto [l, r] = provenNumbers(sp);
+        sp[-1] = l > r;
+        break;
+      }
+      case OpCode::GREATER_EQUAL_NUMBERS: {
+        auto [l, r] = provenNumbers(sp);
+        sp[-1] = l >= r;
+        break;
+      }
+      case OpCode::ADD_NUMBERS: {
+        auto [l, r] = provenNumbers(sp);
+        sp[-1] = l + r;
+        break;
+      }
+      case OpCode::SUBTRACT_NUMBERS: {
+        auto [l, r] = provenNumbers(sp);
+        sp[-1] = l - r;
+        break;
+      }
+      case OpCode::MULTIPLY_NUMBERS: {
+        auto [l, r] = provenNumbers(sp);
+        sp[-1] = l * r;
+        break;
+      }
+      case OpCode::DIVIDE_NUMBERS: {
+        auto [l, r] = provenNumbers(sp);
+        sp[-1] = l / r;
+        break;
+      }
+      case OpCode::EQUAL_STRINGS:
+      case OpCode::NOT_EQUAL_STRINGS: {
+        auto equal = sp[-2].getString() == sp[-1].getString();
+        --sp;
+        sp[-1] = (code[offset] ==
+                  static_cast<std::uint8_t>(OpCode::EQUAL_STRINGS)) == equal;
+        break;
+      }
+      case OpCode::ADD_STRINGS:
+        sp[-2] = Value::concatenate(sp[-2], sp[-1]);
+        --sp;
+        break;
+      case OpCode::POP:
+        --sp;
+        break;
+      case OpCode::PRINT:
+        m_values.emplace_back(Interpreter::stringify(*--sp));
+        break;
+      case OpCode::JUMP_IF_FALSE: {
+        auto target = operand(ip);
+        if (!Interpreter::isTruthy(*--sp)) {
+          ip = code + target;
+        }
+        break;
+      }
+      case OpCode::JUMP:
+        ip = code + operand(ip);
+        break;
+      case OpCode::RETURN:
+        return;
+    }
+  }
+}
+
+auto VirtualMachine::global(std::uint32_t offset) -> Value & {
+  auto const *ip = m_bytecode.getCode().data() + offset + 1;
+  auto index = operand(ip);
+  auto *slot = m_environment.lookup(m_bytecode.getGlobals()[index]);
+  if (slot == nullptr) {
+    throw error(offset,
+                fmt::format("Undeclared variable '{}'",
+                            Bytecode::locate(m_source(), offset).name));
+  }
+  m_globals[index] = slot;
+  return *slot;
+}
+
+auto VirtualMachine::initialized(Value &slot, std::uint32_t offset)
+    -> Value & {
+  if (slot.isUndefined()) {
+    throw error(offset,
+                fmt::format("Undefined variable '{}'",
+                            Bytecode::locate(m_source(), offset).name));
+  }
+  return slot;
+}
+
+auto VirtualMachine::error(std::uint32_t offset, std::string const &msg)
+    -> Interpreter::InterpreterException {
+  m_error_reporter.setError(msg,
+                            Bytecode::locate(m_source(), offset).position);
+  return {msg};
+}
@@ -0,0 +1,79 @@
+#ifndef CPPLOX_VIRTUALMACHINE_HPP
+#define CPPLOX_VIRTUALMACHINE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "ErrorReporter.hpp"
+#include "Interpreter.hpp"
+#include "Statement.hpp"
+
+class Environment;
+
+/*
+Backend that compiles the whole program to Bytecode and runs it over a value
+stack, in a single loop. It prints the same values and reports the same errors
+as the Interpreter.
+
+The stack is sized by the compiler, so the instructions do not check it. A
+global is looked up in the environment by the first instruction that uses it,
+the others use the slot that lookup found.
+*/
+class VirtualMachine {
+ public:
+  // the statements the code is compiled from
+  using Source = std::function<std::span<Statement const>()>;
+
+ private:
+  using Value = Interpreter::ExpressionValue;
+
+  Source m_source;
+  Environment &m_environment;
+  ErrorReporter &m_error_reporter;
+
+  Bytecode m_bytecode;
+  bool m_compiled = false;
+  // the string literals, shared by the values that load them
+  std::vector<Value> m_strings;
+  std::vector<Value> m_stack;
+  std::vector<Value> m_locals;
+  // slots of the globals, nullptr until they are looked up
+  std::vector<Value *> m_globals;
+  std::vector<std::string> m_values;
+
+ public:
+  VirtualMachine(std::vector<Statement> const &statements,
+                 Environment &environment, ErrorReporter &error_reporter);
+  // runs bytecode, compiled from the statements of source by another run, which
+  // are only needed to locate an error
+  VirtualMachine(Bytecode bytecode, Source source, Environment &environment,
+                 ErrorReporter &error_reporter);
+
+  // compiles the statements unless their code was already compiled or given,
+  // false when it fails
+  auto compile() -> bool;
+  // the statements are compiled by the first call, the next ones run their
+  // code again
+  auto interpret() -> std::optional<std::vector<std::string> const>;
+
+  [[nodiscard]] inline auto getBytecode() const -> Bytecode const & {
+    return m_bytecode;
+  }
+
+ private:
+  void run();
+  // looks up the slot of the global of the instruction at offset
+  auto global(std::uint32_t offset) -> Value &;
+  // value of the variable of the instruction at offset
+  auto initialized(Value &slot, std::uint32_t offset) -> Value &;
+
+  auto error(std::uint32_t offset, std::string const &msg)
+      -> Interpreter::InterpreterException;
+};
+
+#endif /* CPPLOX_VIRTUALMACHINE_HPP */
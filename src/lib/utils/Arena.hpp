@@ -0,0 +1,114 @@
+#ifndef CPPLOX_ARENA_HPP
+#define CPPLOX_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// reference to a node allocated in an Arena, it does not own the node
+template <typename T>
+class Node {
+  T *m_node;
+
+ public:
+  explicit Node(T *node) : m_node(node) {}
+
+  auto operator*() const -> T & { return *m_node; }
+  auto operator->() const -> T * { return m_node; }
+
+  // nodes are compared by identity
+  auto operator==(Node const &other) const -> bool = default;
+};
+
+/*
+Bump allocator for the nodes of a syntax tree: nodes are carved out of large
+blocks and never destroyed one by one, the blocks are all freed with the arena.
+Only trivially destructible types can be allocated, so that freeing a tree
+does not have to walk it.
+*/
+class Arena {
+ public:
+  static constexpr std::size_t block_size = 64 << 10;
+
+ private:
+  std::vector<std::unique_ptr<std::byte[]> > m_blocks;
+  std::byte *m_cursor = nullptr;
+  std::byte *m_end = nullptr;
+  std::size_t m_size = 0;
+
+ public:
+  Arena() = default;
+  ~Arena() = default;
+  Arena(Arena const &) = delete;
+  auto operator=(Arena const &) -> Arena & = delete;
+
+  Arena(Arena &&other) noexcept
+      : m_blocks(std::move(other.m_blocks)),
+        m_cursor(std::exchange(other.m_cursor, nullptr)),
+        m_end(std::exchange(other.m_end, nullptr)),
+        m_size(std::exchange(other.m_size, 0)) {}
+
+  auto operator=(Arena &&other) noexcept -> Arena & {
+    m_blocks = std::move(other.m_blocks);
+    m_cursor = std::exchange(other.m_cursor, nullptr);
+    m_end = std::exchange(other.m_end, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    return *this;
+  }
+
+  template <typename T, typename... Args>
+  auto make(Args &&...args) -> Node<T> {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "arena nodes are never destroyed");
+    return Node<T>{new (allocate(sizeof(T), alignof(T)))
+                       T(std::forward<Args>(args)...)};
+  }
+
+  // copies items in the arena
+  template <typename T>
+  auto copy(std::span<T const> items) -> std::span<T const> {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "arena nodes are never destroyed");
+    if (items.empty()) {
+      return {};
+    }
+    auto *copy = static_cast<T *>(allocate(items.size_bytes(), alignof(T)));
+    std::uninitialized_copy(items.begin(), items.end(), copy);
+    return {copy, items.size()};
+  }
+
+  // bytes handed out by the arena
+  [[nodiscard]] auto size() const -> std::size_t { return m_size; }
+
+ private:
+  auto allocate(std::size_t size, std::size_t alignment) -> void * {
+    auto padding = static_cast<std::size_t>(
+        -reinterpret_cast<std::uintptr_t>(m_cursor) & (alignment - 1));
+    if (m_cursor == nullptr ||
+        static_cast<std::size_t>(m_end - m_cursor) < padding + size) {
+      // allocations bigger than a quarter of a block get their own block, so
+      // that they do not waste the end of the current one
+      if (size > block_size / 4) {
+        m_blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+        m_size += size;
+        return m_blocks.back().get();
+      }
+      m_blocks.push_back(
+          std::make_unique_for_overwrite<std::byte[]>(block_size));
+      m_cursor = m_blocks.back().get();
+      m_end = m_cursor + block_size;
+      padding = 0;
+    }
+    auto *node = m_cursor + padding;
+    m_cursor = node + size;
+    m_size += size;
+    return node;
+  }
+};
+
+#endif /* CPPLOX_ARENA_HPP */
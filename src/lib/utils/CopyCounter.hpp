@@ -0,0 +1,46 @@
+#ifndef CPPLOX_COPYCOUNTER_HPP
+#define CPPLOX_COPYCOUNTER_HPP
+
+#include <atomic>
+#include <cstddef>
+
+/*
+Base of the syntax tree nodes. Nodes are built in place in the arena of their
+program and moved, never copied: in debug builds every copy is counted so that
+tests can check that parsing and running a program never clones it.
+*/
+class CopyCounter {
+#ifndef NDEBUG
+  static inline std::atomic<std::size_t> s_copies = 0;
+#endif
+
+ public:
+  CopyCounter() = default;
+  ~CopyCounter() = default;
+  CopyCounter(CopyCounter const & /*other*/) { count(); }
+  auto operator=(CopyCounter const & /*other*/) -> CopyCounter & {
+    count();
+    return *this;
+  }
+  CopyCounter(CopyCounter &&) noexcept = default;
+  auto operator=(CopyCounter &&) noexcept -> CopyCounter & = default;
+
+  // number of nodes copied since the start of the program, always 0 in release
+  // builds
+  static auto getCopies() -> std::size_t {
+#ifndef NDEBUG
+    return s_copies.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+  }
+
+ private:
+  static void count() {
+#ifndef NDEBUG
+    s_copies.fetch_add(1, std::memory_order_relaxed);
+#endif
+  }
+};
+
+#endif /* CPPLOX_COPYCOUNTER_HPP */
@@ -0,0 +1,259 @@
+#ifndef CPPLOX_SCAN_HPP
+#define CPPLOX_SCAN_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*
+Byte scanning kernels used by the lexer. Each kernel looks at a whole block of
+the source at once (32 bytes with AVX2, 16 bytes with SSE2) and falls back to
+a scalar loop for the tail of the input or when no vector unit is available.
+
+Sources are UTF-8: every byte >= 0x80 is a part of a multi-byte character,
+which is allowed in identifiers, strings and comments.
+*/
+namespace Scan {
+namespace detail {
+#if defined(__AVX2__)
+using Block = __m256i;
+constexpr std::size_t block_size = 32;
+
+inline auto load(char const *it) -> Block {
+  return _mm256_loadu_si256(reinterpret_cast<Block const *>(it));
+}
+inline auto eq(Block block, char c) -> Block {
+  return _mm256_cmpeq_epi8(block, _mm256_set1_epi8(c));
+}
+inline auto lt(Block block, char c) -> Block {
+  return _mm256_cmpgt_epi8(_mm256_set1_epi8(c), block);
+}
+inline auto gt(Block block, char c) -> Block {
+  return _mm256_cmpgt_epi8(block, _mm256_set1_epi8(c));
+}
+inline auto either(Block a, Block b) -> Block { return _mm256_or_si256(a, b); }
+inline auto lower(Block block) -> Block {
+  return _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+}
+inline auto mask(Block block) -> std::uint32_t {
+  return static_cast<std::uint32_t>(_mm256_movemask_epi8(block));
+}
+#elif defined(__SSE2__)
+using Block = __m128i;
+constexpr std::size_t block_size = 16;
+
+inline auto load(char const *it) -> Block {
+  return _mm_loadu_si128(reinterpret_cast<Block const *>(it));
+}
+inline auto eq(Block block, char c) -> Block {
+  return _mm_cmpeq_epi8(block, _mm_set1_epi8(c));
+}
+inline auto lt(Block block, char c) -> Block {
+  return _mm_cmplt_epi8(block, _mm_set1_epi8(c));
+}
+inline auto gt(Block block, char c) -> Block {
+  return _mm_cmpgt_epi8(block, _mm_set1_epi8(c));
+}
+inline auto either(Block a, Block b) -> Block { return _mm_or_si128(a, b); }
+inline auto lower(Block block) -> Block {
+  return _mm_or_si128(block, _mm_set1_epi8(0x20));
+}
+inline auto mask(Block block) -> std::uint32_t {
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(block));
+}
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+// bits are set for the bytes outside of [lo, hi], compares are signed so
+// bytes >= 0x80 are always outside of an ascii range
+inline auto outside(Block block, char lo, char hi) -> std::uint32_t {
+  return mask(either(lt(block, lo), gt(block, hi)));
+}
+#endif
+
+constexpr auto isSpace(char c) -> bool {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+constexpr auto isIdentifier(char c) -> bool {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_' ||
+         static_cast<unsigned char>(c) >= 0x80;
+}
+
+// length of the UTF-8 sequence starting at it, 0 if it is invalid, overlong,
+// a surrogate, past U+10FFFF or truncated by end
+inline auto sequenceLength(char const *it, char const *end) -> std::size_t {
+  auto byte = [it](std::size_t i) {
+    return static_cast<unsigned char>(it[i]);
+  };
+  auto lead = byte(0);
+
+  std::size_t length = 0;
+  unsigned char lo = 0x80;
+  unsigned char hi = 0xBF;
+  if (lead < 0x80) {
+    return 1;
+  }
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    lo = lead == 0xE0 ? 0xA0 : lo;
+    hi = lead == 0xED ? 0x9F : hi;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    lo = lead == 0xF0 ? 0x90 : lo;
+    hi = lead == 0xF4 ? 0x8F : hi;
+  } else {
+    return 0;
+  }
+
+  if (static_cast<std::size_t>(end - it) < length || byte(1) < lo ||
+      byte(1) > hi) {
+    return 0;
+  }
+  for (std::size_t i = 2; i < length; ++i) {
+    if (byte(i) < 0x80 || byte(i) > 0xBF) {
+      return 0;
+    }
+  }
+  return length;
+}
+}  // namespace detail
+
+// returns a pointer to the first occurrence of c in [it, end) or end
+inline auto findByte(char const *it, char const *end, char c) -> char const * {
+#if defined(__AVX2__) || defined(__SSE2__)
+  for (; static_cast<std::size_t>(end - it) >= detail::block_size;
+       it += detail::block_size) {
+    auto found = detail::mask(detail::eq(detail::load(it), c));
+    if (found != 0) {
+      return it + std::countr_zero(found);
+    }
+  }
+#endif
+  while (it != end && *it != c) {
+    ++it;
+  }
+  return it;
+}
+
+// returns a pointer to the first occurrence of a or b in [it, end) or end
+inline auto findEither(char const *it, char const *end, char a, char b)
+    -> char const * {
+#if defined(__AVX2__) || defined(__SSE2__)
+  for (; static_cast<std::size_t>(end - it) >= detail::block_size;
+       it += detail::block_size) {
+    auto block = detail::load(it);
+    auto found = detail::mask(
+        detail::either(detail::eq(block, a), detail::eq(block, b)));
+    if (found != 0) {
+      return it + std::countr_zero(found);
+    }
+  }
+#endif
+  while (it != end && *it != a && *it != b) {
+    ++it;
+  }
+  return it;
+}
+
+// returns a pointer to the first "*/" in [it, end) or end
+inline auto findBlockCommentEnd(char const *it, char const *end)
+    -> char const * {
+  while (true) {
+    it = findByte(it, end, '*');
+    if (it == end || it + 1 == end) {
+      return end;
+    }
+    if (it[1] == '/') {
+      return it;
+    }
+    ++it;
+  }
+}
+
+// returns a pointer to the first non whitespace character in [it, end)
+inline auto skipWhitespace(char const *it, char const *end) -> char const * {
+#if defined(__AVX2__) || defined(__SSE2__)
+  for (; static_cast<std::size_t>(end - it) >= detail::block_size;
+       it += detail::block_size) {
+    auto block = detail::load(it);
+    auto other = detail::outside(block, '\t', '\r') &
+                 ~detail::mask(detail::eq(block, ' '));
+    if (other != 0) {
+      return it + std::countr_zero(other);
+    }
+  }
+#endif
+  while (it != end && detail::isSpace(*it)) {
+    ++it;
+  }
+  return it;
+}
+
+// returns a pointer to the first character of [it, end) that can not be part
+// of an identifier
+inline auto skipIdentifier(char const *it, char const *end) -> char const * {
+#if defined(__AVX2__) || defined(__SSE2__)
+  for (; static_cast<std::size_t>(end - it) >= detail::block_size;
+       it += detail::block_size) {
+    auto block = detail::load(it);
+    auto other = detail::outside(detail::lower(block), 'a', 'z') &
+                 detail::outside(block, '0', '9') &
+                 ~detail::mask(detail::eq(block, '_')) & ~detail::mask(block);
+    if (other != 0) {
+      return it + std::countr_zero(other);
+    }
+  }
+#endif
+  while (it != end && detail::isIdentifier(*it)) {
+    ++it;
+  }
+  return it;
+}
+
+// returns a pointer to the first byte of [it, end) that does not start a
+// valid UTF-8 sequence or end, blocks of ascii are skipped at once
+inline auto validateUtf8(char const *it, char const *end) -> char const * {
+  while (it != end) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    while (static_cast<std::size_t>(end - it) >= detail::block_size &&
+           detail::mask(detail::load(it)) == 0) {
+      it += detail::block_size;
+    }
+    if (it == end) {
+      break;
+    }
+#endif
+    auto length = detail::sequenceLength(it, end);
+    if (length == 0) {
+      return it;
+    }
+    it += length;
+  }
+  return it;
+}
+
+// returns the number of '\n' in [it, end)
+inline auto countNewlines(char const *it, char const *end) -> std::size_t {
+  std::size_t count = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+  for (; static_cast<std::size_t>(end - it) >= detail::block_size;
+       it += detail::block_size) {
+    count += std::popcount(detail::mask(detail::eq(detail::load(it), '\n')));
+  }
+#endif
+  for (; it != end; ++it) {
+    count += *it == '\n' ? 1 : 0;
+  }
+  return count;
+}
+}  // namespace Scan
+
+#endif /* CPPLOX_SCAN_HPP */
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "../src/lib/ErrorReporter.hpp"
+#include "../src/lib/Lexer.hpp"
+#include "../src/lib/Lox.hpp"
+#include "../src/lib/Parser.hpp"
+#include "../src/lib/utils/Arena.hpp"
+#include "../src/lib/utils/CopyCounter.hpp"
+
+TEST(Arena, AlignsNodes) {
+  Arena arena;
+
+  auto byte = arena.make<char>('a');
+  auto number = arena.make<double>(1.5);
+  auto big = arena.make<std::array<char, Arena::block_size> >();
+  auto after = arena.make<std::uint64_t>(42);
+
+  EXPECT_EQ(*byte, 'a');
+  EXPECT_EQ(*number, 1.5);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&*number) % alignof(double), 0);
+  EXPECT_EQ(*after, 42);
+  EXPECT_EQ(&*after, reinterpret_cast<std::uint64_t *>(&*number + 1));
+  EXPECT_EQ(big->size(), Arena::block_size);
+}
+
+TEST(Arena, CopiesSpans) {
+  Arena arena;
+  std::vector<int> values{1, 2, 3};
+
+  auto copy = arena.copy(std::span<int const>{values});
+  values.assign({4, 5, 6});
+  EXPECT_EQ(std::vector<int>(copy.begin(), copy.end()),
+            (std::vector<int>{1, 2, 3}));
+  EXPECT_TRUE(arena.copy(std::span<int const>{}).empty());
+}
+
+TEST(Arena, OwnsTheNodesOfAProgram) {
+  std::string source = "{ var a = 1; { print -a + 2 * 3; } }";
+  for (int i = 0; i < 10000; ++i) {
+    source += "print (1 + 2) * 3;";
+  }
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer lexer{source, err, symbols};
+  auto tokens = lexer.scanTokens();
+  ASSERT_TRUE(tokens.has_value());
+
+  std::optional<Program> program;
+  {
+    Parser parser{tokens.value(), err, symbols};
+    program = parser.parse();
+  }
+  ASSERT_TRUE(program.has_value());
+  EXPECT_GT(program->getArena().size(), 10000 * sizeof(Node<int>));
+
+  auto const &statements = program->getStatements();
+  ASSERT_EQ(statements.size(), 10001);
+  auto const *block = std::get_if<Node<BlockStatement> >(&statements[0]);
+  ASSERT_NE(block, nullptr);
+  auto inner = (*block)->getStatements();
+  ASSERT_EQ(inner.size(), 2);
+  EXPECT_TRUE(std::holds_alternative<Node<VariableDeclaration> >(inner[0]));
+  EXPECT_TRUE(std::holds_alternative<Node<BlockStatement> >(inner[1]));
+}
+
+TEST(Arena, RunsProgramsWithoutCopyingThem) {
+  auto copies = CopyCounter::getCopies();
+
+  Lox lox;
+  auto result = lox.run(
+      "var a = 1;\nvar b;\n"
+      "{ var c = \"s\"; b = (a + 2) * -3 / 4 - 5; print c + \"t\"; }\n"
+      "print a < b ? a <= b : (a > b, a >= b, a == b, a != b, !true);\n"
+      "print nil; print false;\n");
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->size(), 4);
+  EXPECT_EQ(CopyCounter::getCopies(), copies);
+
+#ifndef NDEBUG
+  LiteralNumberExpression number{1};
+  auto copy = number;
+  EXPECT_EQ(copy.getValue(), 1);
+  EXPECT_EQ(CopyCounter::getCopies(), copies + 1);
+#endif
+}
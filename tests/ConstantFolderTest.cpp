@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "../src/lib/ConstantFolder.hpp"
+#include "../src/lib/Lox.hpp"
+#include "Helpers.hpp"
+
+namespace {
+// expression of the print statement source ends with, after pass
+auto optimize(void (*pass)(Program &), std::string_view source,
+              SymbolTable &symbols) -> std::pair<Program, Expression> {
+  auto program = parse(source, symbols);
+  pass(program);
+  auto statement =
+      std::get<Node<PrintStatement> >(program.getStatements().back());
+  auto expr = statement->getExpression();
+  return {std::move(program), expr};
+}
+
+auto run(std::string const &source, bool fold) -> std::vector<std::string> {
+  Lox lox;
+  lox.setOptimizing(fold);
+  return output(lox, source);
+}
+}  // namespace
+
+TEST(ConstantFolder, FoldsLiteralOperands) {
+  SymbolTable symbols;
+
+  auto [seconds, seconds_expr] =
+      optimize(ConstantFolder::fold, "print (60 * 60 * 24);", symbols);
+  auto const *number =
+      std::get_if<Node<LiteralNumberExpression> >(&seconds_expr);
+  ASSERT_NE(number, nullptr);
+  EXPECT_EQ((*number)->getValue(), 86400);
+
+  auto [name, name_expr] =
+      optimize(ConstantFolder::fold, "print \"prefix\" + \"suffix\";", symbols);
+  auto const *string = std::get_if<Node<LiteralStringExpression> >(&name_expr);
+  ASSERT_NE(string, nullptr);
+  EXPECT_EQ((*string)->getValue(), "prefixsuffix");
+
+  auto [branch, branch_expr] =
+      optimize(ConstantFolder::fold, "print true ? a : b;", symbols);
+  auto const *variable = std::get_if<Node<VariableExpression> >(&branch_expr);
+  ASSERT_NE(variable, nullptr);
+  EXPECT_EQ((*variable)->getName(), "a");
+
+  auto [compare, compare_expr] =
+      optimize(ConstantFolder::fold, "print !(1 < 2) == nil;", symbols);
+  EXPECT_TRUE(std::holds_alternative<
+              Node<LiteralExpression<TokenType::TOKEN_FALSE> > >(compare_expr));
+}
+
+TEST(ConstantFolder, SimplifiesIdentitiesOnlyWhenTheyHold) {
+  SymbolTable symbols;
+
+  // -a is a number whenever it does not fail
+  auto [product, product_expr] =
+      optimize(ConstantFolder::fold, "print (-a) * 1 / 1 - 0;", symbols);
+  EXPECT_TRUE(
+      std::holds_alternative<Node<UnaryExpression<TokenType::TOKEN_MINUS> > >(
+          product_expr));
+
+  // a may be a string, a * 1 must still fail
+  auto [unknown, unknown_expr] =
+      optimize(ConstantFolder::fold, "print a * 1;", symbols);
+  EXPECT_TRUE(
+      std::holds_alternative<Node<BinaryExpression<TokenType::TOKEN_STAR> > >(
+          unknown_expr));
+
+  // x + 0 turns -0 into 0
+  auto [sum, sum_expr] =
+      optimize(ConstantFolder::fold, "print -a + 0;", symbols);
+  EXPECT_TRUE(
+      std::holds_alternative<Node<BinaryExpression<TokenType::TOKEN_PLUS> > >(
+          sum_expr));
+}
+
+TEST(ConstantFolder, KeepsTheSemanticsOfTheProgram) {
+  for (auto const *source :
+       {"var a = 2;\nprint (a + 1) * (60 * 60) - -0 * 1;\n",
+        "print -0 - 0, 0 - -0, -(-(0 * -1));\n",
+        "var s = \"x\";\nprint s + \"y\" + \"z\", !!(s == \"x\");\n",
+        "print 1 + (2 + \"three\");\n", "print -\"text\";\n",
+        "var a;\nprint nil ? a = 1 : (a = 2, a);\n",
+        "print 1 / 0, 0 / 0 == 0 / 0;\n",
+        "var a = 1;\n{ var b = a; { print b; } }\n",
+        "var a = -0;\nvar b = nil ? a = 0 : a;\nprint 1 / b, 1 / a;\n"}) {
+    EXPECT_EQ(run(source, true), run(source, false)) << source;
+  }
+}
+
+TEST(ConstantFolder, PropagatesTheValuesOfVariables) {
+  SymbolTable symbols;
+
+  auto [sum, sum_expr] =
+      optimize(ConstantFolder::propagate,
+               "var a = 2; var b = a * 3; print b + a;", symbols);
+  auto const *number = std::get_if<Node<LiteralNumberExpression> >(&sum_expr);
+  ASSERT_NE(number, nullptr);
+  EXPECT_EQ((*number)->getValue(), 8);
+
+  auto [shadowed, shadowed_expr] =
+      optimize(ConstantFolder::propagate,
+               "var a = 1; { var a = 2; a = 3; } print a;", symbols);
+  number = std::get_if<Node<LiteralNumberExpression> >(&shadowed_expr);
+  ASSERT_NE(number, nullptr);
+  EXPECT_EQ((*number)->getValue(), 1);
+
+  // the branches agree on a, not on b
+  auto [agreed, agreed_expr] =
+      optimize(ConstantFolder::propagate,
+               "var a = 1; var b = 1; x ? a = 1 : (b = 2); print a;", symbols);
+  EXPECT_TRUE(
+      std::holds_alternative<Node<LiteralNumberExpression> >(agreed_expr));
+  auto [disagreed, disagreed_expr] =
+      optimize(ConstantFolder::propagate,
+               "var a = 1; var b = 1; x ? a = 1 : (b = 2); print b;", symbols);
+  EXPECT_TRUE(
+      std::holds_alternative<Node<VariableExpression> >(disagreed_expr));
+
+  auto [undefined, undefined_expr] =
+      optimize(ConstantFolder::propagate, "var a; print a;", symbols);
+  EXPECT_TRUE(
+      std::holds_alternative<Node<VariableExpression> >(undefined_expr));
+}
+
+TEST(ConstantFolder, LeavesLongConcatenationsToTheRuntime) {
+  SymbolTable symbols;
+  auto source = "var s = \"" + std::string(600, 'x') + "\";";
+
+  auto [short_sum, short_expr] =
+      optimize(ConstantFolder::propagate,
+               "var s = \"x\"; print s + s;", symbols);
+  EXPECT_TRUE(
+      std::holds_alternative<Node<LiteralStringExpression> >(short_expr));
+  auto long_source = source + "print s + s;";
+  auto [long_sum, long_expr] =
+      optimize(ConstantFolder::propagate, long_source, symbols);
+  EXPECT_TRUE(
+      std::holds_alternative<Node<BinaryExpression<TokenType::TOKEN_PLUS> > >(
+          long_expr));
+
+  source += "s = s + s; print s;";
+  EXPECT_EQ(run(source, true), run(source, false));
+  EXPECT_EQ(run(source, true)[0].size(), 1200);
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/lib/Document.hpp"
+#include "../src/lib/Lox.hpp"
+
+namespace {
+// types and spellings of the tokens of every declaration, positions relative
+// to the whole text
+auto dump(Document const &document) -> std::vector<std::string> {
+  std::vector<std::string> tokens;
+  std::uint64_t offset = 0;
+  for (auto const &declaration : document.getDeclarations()) {
+    auto const &buffer = declaration->tokens;
+    for (TokenBuffer::Index i = 0; i < buffer.size(); ++i) {
+      if (buffer.getType(i) == TokenType::TOKEN_EOF) {
+        continue;
+      }
+      auto position = buffer.getPosition(i);
+      tokens.push_back(buffer.toString(i) + " @" +
+                       std::to_string(offset + position.getOffset()) + "+" +
+                       std::to_string(position.getLength()));
+    }
+    offset += declaration->text.size();
+  }
+  return tokens;
+}
+}  // namespace
+
+TEST(Document, SplitsTopLevelDeclarations) {
+  SymbolTable symbols;
+  Document document{symbols};
+  document.setText("var a = 1;\n{ var b = \"}\"; print b; }\nprint a; // ;\n");
+
+  auto const &declarations = document.getDeclarations();
+  ASSERT_EQ(declarations.size(), 4);
+  EXPECT_EQ(declarations[0]->text, "var a = 1;");
+  EXPECT_EQ(declarations[1]->text, "\n{ var b = \"}\"; print b; }");
+  EXPECT_EQ(declarations[2]->text, "\nprint a;");
+  EXPECT_EQ(declarations[3]->text, " // ;\n");
+  EXPECT_EQ(document.getReparsedCount(), 4);
+  EXPECT_FALSE(document.hasErrors());
+}
+
+TEST(Document, ReparsesOnlyTheEditedDeclaration) {
+  std::string source;
+  for (int i = 0; i < 100; ++i) {
+    source += "var v" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+  }
+  SymbolTable symbols;
+  Document document{symbols};
+  document.setText(source);
+
+  auto offset = source.find("= 42;") + 2;
+  document.edit(offset, 2, "4200 + 1");
+  source.replace(offset, 2, "4200 + 1");
+  EXPECT_EQ(document.getReparsedCount(), 1);
+  EXPECT_EQ(document.getText(), source);
+
+  Document expected{symbols};
+  expected.setText(source);
+  EXPECT_EQ(dump(document), dump(expected));
+}
+
+TEST(Document, MergesAndSplitsDeclarations) {
+  std::string source = "var a = 1;\nvar b = 2;\nvar c = 3;\nprint a;\n";
+  SymbolTable symbols;
+  Document document{symbols};
+  document.setText(source);
+
+  // opening a block swallows the following declarations until it is closed
+  auto edits = std::vector<std::tuple<std::size_t, std::size_t, std::string>>{
+      {11, 0, "{ "}, {33, 0, " }"}, {11, 2, ""}, {5, 0, "/* ;"}, {24, 0, "*/"},
+      {5, 4, ""},    {source.size() - 3, 3, ""}, {source.size() - 3, 0, "a;\n"},
+      {0, 0, "\"unterminated"}};
+  for (auto const &[offset, length, replacement] : edits) {
+    document.edit(offset, length, replacement);
+    source.replace(offset, length, replacement);
+    ASSERT_EQ(document.getText(), source);
+
+    Document expected{symbols};
+    expected.setText(source);
+    ASSERT_EQ(document.getDeclarations().size(),
+              expected.getDeclarations().size())
+        << source;
+    EXPECT_EQ(dump(document), dump(expected)) << source;
+    EXPECT_EQ(document.hasErrors(), expected.hasErrors()) << source;
+  }
+}
+
+TEST(Document, RunsWithTheLinesOfTheWholeText) {
+  Lox lox;
+  Document document{lox.getSymbols()};
+  document.setText("var a = 1;\nvar b = 2;\nprint a + b;\n");
+
+  auto result = lox.run(document);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result.value(), std::vector<std::string>{"3.000000"});
+
+  document.edit(document.getText().find("a + b"), 5, "a + c");
+  EXPECT_FALSE(lox.run(document).has_value());
+  auto errors = lox.getErrors();
+  ASSERT_EQ(errors.size(), 1);
+  EXPECT_NE(errors[0].find("3 | print a + c;"), std::string::npos) << errors[0];
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include "../src/lib/ErrorReporter.hpp"
+#include "../src/lib/LineIndex.hpp"
+
+namespace {
+auto messageFormater(Error const &error, LineIndex const &line_index,
+                     std::uint32_t first_line) -> std::string {
+  if (!error.hasPosition()) {
+    return error.getMessage();
+  }
+  auto location = line_index.locate(error.getPositon().value());
+  return error.getMessage() + "@" +
+         std::to_string(first_line - 1 + location.start_line) + ":" +
+         std::to_string(location.start_column);
+}
+}  // namespace
+
+TEST(SourcePosition, PacksOffsetsPastFourGigabytes) {
+  SourcePosition position{std::uint64_t{5} << 30, 3};
+  EXPECT_EQ(position.getOffset(), std::uint64_t{5} << 30);
+  EXPECT_EQ(position.getLength(), 3);
+
+  SourcePosition clamped{0, std::uint64_t{1} << 32};
+  EXPECT_EQ(clamped.getLength(), SourcePosition::max_length);
+}
+
+TEST(LineIndex, MapsOffsetsToLines) {
+  LineIndex lines{"a\nbc\n\nd"};
+
+  EXPECT_EQ(lines.getLineCount(), 4);
+  EXPECT_EQ(lines.getLine(0), 1);
+  EXPECT_EQ(lines.getLine(1), 1);
+  EXPECT_EQ(lines.getLine(2), 2);
+  EXPECT_EQ(lines.getLine(5), 3);
+  EXPECT_EQ(lines.getLine(6), 4);
+}
+
+TEST(LineIndex, LocatesSpansOverSeveralLines) {
+  LineIndex lines{"var a;\nprint \"x\ny\";\n"};
+
+  auto location = lines.locate({13, 5});
+  EXPECT_EQ(location.start_line, 2);
+  EXPECT_EQ(location.end_line, 3);
+  EXPECT_EQ(location.start_column, 6);
+  EXPECT_EQ(location.end_column, 1);
+  EXPECT_EQ(lines.getLines({13, 5}), "print \"x\ny\";");
+}
+
+TEST(ErrorReporter, FormatsErrorsLazily) {
+  std::size_t formated = 0;
+  ErrorReporter reporter{[&formated](Error const &error,
+                                     LineIndex const &line_index,
+                                     std::uint32_t first_line) {
+    ++formated;
+    return messageFormater(error, line_index, first_line);
+  }};
+  reporter.setSource("print 1;\nprint x;", 10);
+  reporter.setError("Undeclared variable", SourcePosition{15, 1});
+  EXPECT_EQ(formated, 0);
+
+  std::vector<std::string> errors;
+  reporter.report([&errors](std::string_view error) {
+    errors.emplace_back(error);
+  });
+  EXPECT_EQ(formated, 1);
+  EXPECT_EQ(errors, std::vector<std::string>{"Undeclared variable@11:6"});
+}
+
+TEST(ErrorReporter, ShowsTheWholeFirstLine) {
+  ErrorReporter reporter;
+  reporter.setSource("print -\"x\";\nprint x;", 3, "var a = 1; ");
+  reporter.setError("Operand must be a number", SourcePosition{6, 1});
+  reporter.setError("Undeclared variable", SourcePosition{18, 1});
+
+  auto errors = reporter.getErrors();
+  ASSERT_EQ(errors.size(), 2);
+  EXPECT_NE(errors[0].find("3 | var a = 1; print -\"x\";\n"), std::string::npos)
+      << errors[0];
+
+  ErrorReporter located{messageFormater};
+  located.setSource("print -\"x\";\nprint x;", 3, "var a = 1; ");
+  located.setError("Operand must be a number", SourcePosition{6, 1});
+  located.setError("Undeclared variable", SourcePosition{18, 1});
+  EXPECT_EQ(located.getErrors(),
+            (std::vector<std::string>{"Operand must be a number@3:17",
+                                      "Undeclared variable@4:6"}));
+}
+
+TEST(ErrorReporter, CapsErrorsAndDuplicates) {
+  ErrorReporter reporter{messageFormater};
+  reporter.setLimits(3, 2);
+
+  for (int i = 0; i < 5; ++i) {
+    reporter.setError("duplicate");
+  }
+  for (int i = 0; i < 5; ++i) {
+    reporter.setError("error " + std::to_string(i));
+  }
+
+  EXPECT_EQ(reporter.getSuppressedCount(), 7);
+  auto errors = reporter.getErrors();
+  ASSERT_EQ(errors.size(), 4);
+  EXPECT_EQ(errors[0], "duplicate");
+  EXPECT_EQ(errors[1], "duplicate");
+  EXPECT_EQ(errors[2], "error 0");
+  EXPECT_NE(errors[3].find("7 more errors"), std::string::npos);
+
+  reporter.clearErrors();
+  EXPECT_FALSE(reporter.hasErrors());
+  EXPECT_EQ(reporter.getSuppressedCount(), 0);
+}
@@ -0,0 +1,46 @@
+#ifndef CPPLOX_TESTS_HELPERS_HPP
+#define CPPLOX_TESTS_HELPERS_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/lib/ErrorReporter.hpp"
+#include "../src/lib/Lexer.hpp"
+#include "../src/lib/Lox.hpp"
+#include "../src/lib/Parser.hpp"
+#include "../src/lib/Statement.hpp"
+#include "../src/lib/SymbolTable.hpp"
+
+// program of source, nullopt when err reports errors. The program and err keep
+// views of source, which must outlive them.
+inline auto parse(std::string_view source, ErrorReporter &err,
+                  SymbolTable &symbols) -> std::optional<Program> {
+  err.setSource(source);
+  Lexer lexer{source, err, symbols};
+  auto tokens = lexer.scanTokens();
+  if (!tokens.has_value()) {
+    return std::nullopt;
+  }
+  Parser parser{tokens.value(), err, symbols};
+  return parser.parse();
+}
+
+// program of source, which is valid
+inline auto parse(std::string_view source, SymbolTable &symbols) -> Program {
+  ErrorReporter err;
+  return parse(source, err, symbols).value();
+}
+
+// values source printed when lox ran it, or its errors
+inline auto output(Lox &lox, std::string_view source)
+    -> std::vector<std::string> {
+  auto result = lox.run(source);
+  if (lox.hasErrors()) {
+    return lox.getErrors();
+  }
+  return result.value();
+}
+
+#endif /* CPPLOX_TESTS_HELPERS_HPP */
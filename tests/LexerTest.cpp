@@ -1,6 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <utility>
+
 #include "../src/lib/Lexer.hpp"
+#include "../src/lib/utils/Scan.hpp"
 
 int Factorial(int n) {
   int result = 1;
@@ -28,10 +34,319 @@ TEST(FactorialTest, HandlesPositiveInput) {
 
 TEST(One, Two) {
   ErrorReporter err;
-  Lexer l{"", err};
+  SymbolTable symbols;
+  Lexer l{"", err, symbols};
 
   auto tokens = l.scanTokens();
   // REQUIRE(tokens.has_value());
   // CHECK(tokens.value().get().empty());
   // CHECK(!err.hasErrors());
-}
\ No newline at end of file
+}
+TEST(Lexer, StoresTokensContiguously) {
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer l{"var answer = 42.5; print \"hi\";", err, symbols};
+
+  auto tokens = l.scanTokens();
+  ASSERT_TRUE(tokens.has_value());
+  ASSERT_FALSE(err.hasErrors());
+
+  auto const &buffer = tokens.value().get();
+  ASSERT_EQ(buffer.size(), 8);
+  EXPECT_EQ(buffer.getType(0), TokenType::TOKEN_VAR);
+  EXPECT_EQ(buffer.getType(1), TokenType::TOKEN_IDENTIFIER);
+  EXPECT_EQ(symbols.getName(buffer.getSymbol(1)), "answer");
+  EXPECT_EQ(buffer.getType(2), TokenType::TOKEN_EQUAL);
+  EXPECT_EQ(buffer.getType(3), TokenType::TOKEN_NUMBER);
+  EXPECT_EQ(buffer.getNumber(3), 42.5);
+  EXPECT_EQ(buffer.getType(4), TokenType::TOKEN_SEMICOLON);
+  EXPECT_EQ(buffer.getType(5), TokenType::TOKEN_PRINT);
+  EXPECT_EQ(buffer.getType(6), TokenType::TOKEN_STRING);
+  EXPECT_EQ(buffer.getString(6), "hi");
+  EXPECT_EQ(buffer.getType(7), TokenType::TOKEN_SEMICOLON);
+}
+
+TEST(Lexer, TracksLinesAcrossLongCommentsAndStrings) {
+  std::string_view source =
+      "/* a block comment that is longer than one simd block\n"
+      " spanning two lines */ print\n"
+      "// a line comment that is longer than one simd block too\n"
+      "   \"a string\nthat is longer than one simd block\" ;";
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer l{source, err, symbols};
+
+  auto tokens = l.scanTokens();
+  ASSERT_TRUE(tokens.has_value());
+  ASSERT_FALSE(err.hasErrors());
+
+  auto const &buffer = tokens.value().get();
+  ASSERT_EQ(buffer.size(), 3);
+
+  LineIndex lines{source};
+  EXPECT_EQ(buffer.getType(0), TokenType::TOKEN_PRINT);
+  auto print = lines.locate(buffer.getPosition(0));
+  EXPECT_EQ(print.start_line, 2);
+  EXPECT_EQ(print.start_column, 23);
+  EXPECT_EQ(print.end_column, 27);
+
+  EXPECT_EQ(buffer.getType(1), TokenType::TOKEN_STRING);
+  EXPECT_EQ(buffer.getString(1),
+            "a string\nthat is longer than one simd block");
+  auto string = lines.locate(buffer.getPosition(1));
+  EXPECT_EQ(string.start_line, 4);
+  EXPECT_EQ(string.end_line, 5);
+  EXPECT_EQ(string.start_column, 3);
+
+  EXPECT_EQ(buffer.getType(2), TokenType::TOKEN_SEMICOLON);
+  auto semicolon = lines.locate(buffer.getPosition(2));
+  EXPECT_EQ(semicolon.start_line, 5);
+  EXPECT_EQ(semicolon.start_column, 36);
+}
+
+TEST(Lexer, StoresCompactPositions) {
+  std::string_view source = "var answer = 42;";
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer l{source, err, symbols};
+
+  auto tokens = l.scanTokens();
+  ASSERT_TRUE(tokens.has_value());
+
+  auto const &position = tokens.value().get().getPosition(1);
+  EXPECT_EQ(sizeof(position), 8);
+  EXPECT_EQ(position.getOffset(), 4);
+  EXPECT_EQ(position.getLength(), 6);
+  EXPECT_EQ(LineIndex{source}.getLines(position), source);
+}
+
+TEST(Lexer, ReportsUnterminatedString) {
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer l{"print \"never closed", err, symbols};
+
+  l.scanTokens();
+  EXPECT_TRUE(err.hasErrors());
+}
+
+TEST(Lexer, RecognizesKeywords) {
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer l{"and class else false fun for if nil or print return super this "
+          "true var while",
+          err, symbols};
+
+  auto tokens = l.scanTokens();
+  ASSERT_TRUE(tokens.has_value());
+
+  auto const &buffer = tokens.value().get();
+  ASSERT_EQ(buffer.size(), 16);
+  for (TokenBuffer::Index i = 0; i < buffer.size(); ++i) {
+    EXPECT_EQ(static_cast<int>(buffer.getType(i)),
+              static_cast<int>(TokenType::TOKEN_AND) + static_cast<int>(i));
+  }
+}
+
+TEST(Lexer, DoesNotMistakeIdentifiersForKeywords) {
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer l{"an classy elsewhere fals fn fore i nill orr prints whale _var", err,
+          symbols};
+
+  auto tokens = l.scanTokens();
+  ASSERT_TRUE(tokens.has_value());
+
+  auto const &buffer = tokens.value().get();
+  ASSERT_EQ(buffer.size(), 12);
+  for (TokenBuffer::Index i = 0; i < buffer.size(); ++i) {
+    EXPECT_EQ(buffer.getType(i), TokenType::TOKEN_IDENTIFIER);
+  }
+}
+
+TEST(Lexer, ResolvesTwoCharacterOperators) {
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer l{"!=!<=<>=>===/", err, symbols};
+
+  auto tokens = l.scanTokens();
+  ASSERT_TRUE(tokens.has_value());
+
+  auto const &buffer = tokens.value().get();
+  std::vector<TokenType> const expected{
+      TokenType::TOKEN_BANG_EQUAL,    TokenType::TOKEN_BANG,
+      TokenType::TOKEN_LESS_EQUAL,    TokenType::TOKEN_LESS,
+      TokenType::TOKEN_GREATER_EQUAL, TokenType::TOKEN_GREATER_EQUAL,
+      TokenType::TOKEN_EQUAL_EQUAL,   TokenType::TOKEN_SLASH};
+  ASSERT_EQ(buffer.size(), expected.size());
+  for (TokenBuffer::Index i = 0; i < buffer.size(); ++i) {
+    EXPECT_EQ(buffer.getType(i), expected[i]);
+  }
+}
+
+TEST(Lexer, ReportsUnexpectedCharacter) {
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer l{"print 1 # 2;", err, symbols};
+
+  l.scanTokens();
+  EXPECT_TRUE(err.hasErrors());
+}
+
+namespace {
+// a few MiB of declarations, with strings and comments spanning lines so that
+// chunks can not be split anywhere
+auto generateLargeSource() -> std::string {
+  std::string source;
+  for (int i = 0; source.size() < 4 * Lexer::parallel_chunk_size; ++i) {
+    source += "var v" + std::to_string(i) + " = " + std::to_string(i) +
+              ".5 * (n + 1);\n";
+    source += "/* a comment\n   over \"two\" lines */ print \"a\nb\"; // x\n";
+    source += "if (a <= b) { fun f(x) { return x != nil; } }\n";
+  }
+  return source;
+}
+}  // namespace
+
+TEST(Lexer, LexesChunksInParallel) {
+  auto source = generateLargeSource();
+
+  ErrorReporter sequential_err;
+  SymbolTable sequential_symbols;
+  Lexer sequential{source, sequential_err, sequential_symbols};
+  auto expected = sequential.scanTokens(1);
+  ASSERT_TRUE(expected.has_value());
+  ASSERT_FALSE(sequential_err.hasErrors());
+
+  ErrorReporter parallel_err;
+  SymbolTable parallel_symbols;
+  Lexer parallel{source, parallel_err, parallel_symbols};
+  auto tokens = parallel.scanTokens(4);
+  ASSERT_TRUE(tokens.has_value());
+  ASSERT_FALSE(parallel_err.hasErrors());
+
+  auto const &lhs = expected.value().get();
+  auto const &rhs = tokens.value().get();
+  ASSERT_EQ(lhs.size(), rhs.size());
+  for (TokenBuffer::Index i = 0; i < lhs.size(); ++i) {
+    ASSERT_EQ(lhs.getType(i), rhs.getType(i)) << "token " << i;
+    ASSERT_EQ(lhs.toString(i), rhs.toString(i)) << "token " << i;
+    ASSERT_EQ(lhs.getPosition(i).getOffset(), rhs.getPosition(i).getOffset());
+    ASSERT_EQ(lhs.getPosition(i).getLength(), rhs.getPosition(i).getLength());
+  }
+}
+
+TEST(Lexer, ReportsProgressOverTheWholeSource) {
+  auto source = generateLargeSource();
+
+  for (auto threads : {1U, 4U}) {
+    std::mutex mutex;
+    std::vector<std::pair<std::size_t, std::size_t> > ranges;
+    ErrorReporter err;
+    SymbolTable symbols;
+    Lexer l{source, err, symbols};
+    l.setProgress([&](std::size_t offset, std::size_t size) {
+      std::lock_guard lock{mutex};
+      ranges.emplace_back(offset, size);
+    });
+    l.scanTokens(threads);
+
+    std::sort(ranges.begin(), ranges.end());
+    std::size_t lexed = 0;
+    for (auto [offset, size] : ranges) {
+      EXPECT_EQ(offset, lexed);
+      lexed += size;
+    }
+    EXPECT_EQ(lexed, source.size());
+  }
+}
+
+TEST(Lexer, ReportsErrorLinesOfLaterChunks) {
+  auto source = generateLargeSource();
+  source.insert(source.rfind("var"), "#");
+
+  ErrorReporter sequential_err;
+  SymbolTable sequential_symbols;
+  sequential_err.setSource(source);
+  Lexer sequential{source, sequential_err, sequential_symbols};
+  sequential.scanTokens(1);
+
+  ErrorReporter parallel_err;
+  SymbolTable parallel_symbols;
+  parallel_err.setSource(source);
+  Lexer parallel{source, parallel_err, parallel_symbols};
+  parallel.scanTokens(4);
+
+  ASSERT_TRUE(parallel_err.hasErrors());
+  EXPECT_EQ(parallel_err.getErrors(), sequential_err.getErrors());
+}
+
+TEST(Lexer, LexesUtf8IdentifiersAndStrings) {
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer l{"var café = \"naïve 日本語\"; print 変数_1;", err, symbols};
+
+  auto tokens = l.scanTokens();
+  ASSERT_TRUE(tokens.has_value());
+  ASSERT_FALSE(err.hasErrors());
+
+  auto const &buffer = tokens.value().get();
+  ASSERT_EQ(buffer.size(), 8);
+  EXPECT_EQ(buffer.getType(1), TokenType::TOKEN_IDENTIFIER);
+  EXPECT_EQ(symbols.getName(buffer.getSymbol(1)), "café");
+  EXPECT_EQ(buffer.getType(3), TokenType::TOKEN_STRING);
+  EXPECT_EQ(buffer.getString(3), "naïve 日本語");
+  EXPECT_EQ(buffer.getType(6), TokenType::TOKEN_IDENTIFIER);
+  EXPECT_EQ(symbols.getName(buffer.getSymbol(6)), "変数_1");
+}
+
+TEST(Lexer, ReportsInvalidUtf8) {
+  for (std::string_view source :
+       {"print \"\xff\";", "var a\xc3 = 1;", "// \xc0\xaf overlong",
+        "print \"\xed\xa0\x80\";", "print \"\xf4\x90\x80\x80\";",
+        "print 1; \xe6\x97"}) {
+    ErrorReporter err;
+    SymbolTable symbols;
+    Lexer l{source, err, symbols};
+
+    l.scanTokens();
+    EXPECT_TRUE(err.hasErrors()) << source;
+  }
+}
+
+TEST(Lexer, ReportsTheFirstErrorOfTheSource) {
+  // whether the invalid sequence is in the window of the first error or not
+  for (std::size_t padding : {std::size_t{0}, Lexer::validation_window * 2}) {
+    for (auto [source, utf8] :
+         {std::pair{"print 1 # \"\xff\";", false},
+          std::pair{"print \"\xff\"; print 1 #", true},
+          std::pair{"print \xff #", true}}) {
+      std::string padded = std::string(padding, ' ') + source;
+      ErrorReporter err;
+      SymbolTable symbols;
+      Lexer l{padded, err, symbols};
+      l.scanTokens(1);
+
+      auto errors = err.getErrors();
+      ASSERT_EQ(errors.size(), 1) << source;
+      EXPECT_EQ(errors.front().find("UTF-8") != std::string::npos, utf8)
+          << errors.front();
+    }
+  }
+}
+
+TEST(Lexer, ValidatesUtf8PastTheFirstWindow) {
+  std::string source(Lexer::validation_window * 3, ' ');
+  source += "print \"日本\xe8\";";
+
+  ErrorReporter err;
+  SymbolTable symbols;
+  Lexer l{source, err, symbols};
+  l.scanTokens(1);
+  EXPECT_TRUE(err.hasErrors());
+
+  auto const *begin = source.data();
+  EXPECT_EQ(Scan::validateUtf8(begin, begin + source.size() - 2),
+            begin + source.size() - 3);
+  EXPECT_EQ(Scan::validateUtf8(begin, begin + source.size() - 3),
+            begin + source.size() - 3);
+}
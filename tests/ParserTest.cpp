@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "../src/lib/ErrorReporter.hpp"
+#include "../src/lib/Lox.hpp"
+#include "Helpers.hpp"
+
+TEST(Parser, ParsesLongOperatorChainsWithoutRecursing) {
+  std::string commas = "print 0";
+  std::string sums = "print 0";
+  std::string negations = "print ";
+  for (int i = 1; i < 100000; ++i) {
+    commas += ", " + std::to_string(i % 10);
+    sums += " + 1";
+    negations += "!";
+  }
+  negations += "true";
+
+  for (auto const &source : {commas + ";", sums + ";", negations + ";"}) {
+    ErrorReporter err;
+    SymbolTable symbols;
+    auto program = parse(source, err, symbols);
+    ASSERT_FALSE(err.hasErrors());
+    ASSERT_TRUE(program.has_value());
+    ASSERT_EQ(program->getStatements().size(), 1);
+  }
+}
+
+TEST(Parser, ParsesDeepNestingWithoutRecursing) {
+  std::string parentheses = "print ";
+  std::string operands = "print ";
+  std::string blocks;
+  for (int i = 0; i < 100000; ++i) {
+    parentheses += "(-";
+    operands += "1 + (";
+    blocks += "{ var a = 1; ";
+  }
+  parentheses += "1" + std::string(100000, ')') + ";";
+  operands += "1" + std::string(100000, ')') + ";";
+  blocks += "print a;" + std::string(100000, '}');
+
+  for (auto const &source : {parentheses, operands, blocks}) {
+    ErrorReporter err;
+    SymbolTable symbols;
+    auto program = parse(source, err, symbols);
+    ASSERT_FALSE(err.hasErrors());
+    ASSERT_TRUE(program.has_value());
+    ASSERT_EQ(program->getStatements().size(), 1);
+  }
+
+  // every unterminated block is reported, the reporter keeps a view of the
+  // source to print them
+  std::string unterminated = "{ { print (1); } { print ((1);";
+  ErrorReporter err;
+  SymbolTable symbols;
+  parse(unterminated, err, symbols);
+  EXPECT_EQ(err.getErrors().size(), 3);
+}
+
+TEST(Parser, AppliesPrecedenceAndAssociativity) {
+  Lox lox;
+  auto result = lox.run(
+      "var a = 1;\n"
+      "var b;\n"
+      "print 2 + 3 * 4 - -6 / 2;\n"
+      "print 10 - 4 - 3;\n"
+      "print 1 < 2 == 2 < 3;\n"
+      "print a = b = 5, a + b;\n"
+      "print false ? 1 : true ? 2 : 3;\n"
+      "print !nil ? a = 7 : 8;\n"
+      "print a;\n");
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result.value(),
+            (std::vector<std::string>{"17.000000", "3.000000", "TRUE",
+                                      "10.000000", "2.000000", "7.000000",
+                                      "7.000000"}));
+}
+
+TEST(Parser, ReportsMalformedExpressions) {
+  for (auto const *source :
+       {"print 1 + 2 = 3;", "print a ? 1, 2 : 3;", "var v = a ? 1;",
+        "print (1 + ;", "print 1 +;"}) {
+    ErrorReporter err;
+    SymbolTable symbols;
+    auto program = parse(source, err, symbols);
+    EXPECT_TRUE(err.hasErrors()) << source;
+  }
+
+  // the reporter keeps a view of the source to print its errors
+  std::string source = "print 1 + 2 = 3;";
+  ErrorReporter err;
+  SymbolTable symbols;
+  parse(source, err, symbols);
+  auto errors = err.getErrors();
+  ASSERT_FALSE(errors.empty());
+  EXPECT_NE(errors[0].find("Invalid assignment target"), std::string::npos);
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "../src/lib/CommaSimplifier.hpp"
+#include "../src/lib/DeadStoreEliminator.hpp"
+#include "../src/lib/Lox.hpp"
+#include "../src/lib/PassManager.hpp"
+#include "../src/lib/TypeInference.hpp"
+#include "Helpers.hpp"
+
+namespace {
+auto run(std::string const &source, bool optimize)
+    -> std::vector<std::string> {
+  Lox lox;
+  lox.setOptimizing(optimize);
+  return output(lox, source);
+}
+}  // namespace
+
+TEST(PassManager, RemovesDeadStores) {
+  SymbolTable symbols;
+  auto program =
+      parse("var g = 1; g = 2;\n"
+            "{ var a = f; a = 1; print a; a = g; var b = h; var c = 1; }",
+            symbols);
+  DeadStoreEliminator::eliminate(program);
+
+  // the variables of the top level are kept
+  auto const &statements = program.getStatements();
+  ASSERT_EQ(statements.size(), 3);
+  auto block = std::get<Node<BlockStatement> >(statements.back());
+
+  // f; var a; a = 1; print a; g; h;
+  auto const &block_statements = block->getStatements();
+  ASSERT_EQ(block_statements.size(), 6);
+  auto declaration =
+      std::get<Node<VariableDeclaration> >(block_statements[1]);
+  EXPECT_FALSE(declaration->getInitializer().has_value());
+  auto store = std::get<Node<ExpressionStatement> >(block_statements[2]);
+  EXPECT_TRUE(std::holds_alternative<Node<AssignExpression> >(
+      store->getExpression()));
+  auto dead = std::get<Node<ExpressionStatement> >(block_statements[4]);
+  EXPECT_TRUE(
+      std::holds_alternative<Node<VariableExpression> >(dead->getExpression()));
+}
+
+TEST(PassManager, RemovesEffectFreeCommaOperands) {
+  SymbolTable symbols;
+  auto program = parse(
+      "var a = 1; a, nil == 1; print (a, !true, b), (a = 2, 3);", symbols);
+  CommaSimplifier::simplify(program);
+
+  auto const &statements = program.getStatements();
+  ASSERT_EQ(statements.size(), 2);
+  auto print = std::get<Node<PrintStatement> >(statements.back());
+
+  // b may not be declared, the assignment is an effect
+  auto comma = std::get<Node<BinaryExpression<TokenType::TOKEN_COMMA> > >(
+      print->getExpression());
+  auto grouping =
+      std::get<Node<GroupingExpression> >(comma->getLeftExpression());
+  EXPECT_TRUE(std::holds_alternative<Node<VariableExpression> >(
+      grouping->getExpression()));
+  auto right =
+      std::get<Node<GroupingExpression> >(comma->getRightExpression());
+  EXPECT_TRUE(
+      std::holds_alternative<Node<BinaryExpression<TokenType::TOKEN_COMMA> > >(
+          right->getExpression()));
+}
+
+TEST(PassManager, InfersOperandTypes) {
+  SymbolTable symbols;
+  auto program = parse(
+      "var a = 1; var s = \"x\"; print a + 2; print s + s; print a < s;"
+      "print x + a; a = x ? a : s; print a * a; print -x / 2;"
+      "print s == s + s;",
+      symbols);
+  TypeInference::infer(program);
+
+  std::vector<OperandTypes> types;
+  auto collect = [&types](auto const &e, auto const &self) -> void {
+    std::visit(
+        [&types, &self](auto const &node) {
+          if constexpr (requires { node->getOperandTypes(); }) {
+            self(node->getLeftExpression(), self);
+            self(node->getRightExpression(), self);
+            types.push_back(node->getOperandTypes());
+          }
+        },
+        e);
+  };
+  for (auto const &statement : program.getStatements()) {
+    if (auto const *print = std::get_if<Node<PrintStatement> >(&statement)) {
+      collect((*print)->getExpression(), collect);
+    }
+  }
+
+  // a is a number or a string after the ternary, x is not known but the
+  // division only runs on numbers
+  using enum OperandTypes;
+  EXPECT_EQ(types, (std::vector{NUMBERS, STRINGS, UNKNOWN, UNKNOWN, UNKNOWN,
+                                NUMBERS, STRINGS, STRINGS}));
+}
+
+TEST(PassManager, ReportsEveryPass) {
+  SymbolTable symbols;
+  auto program = parse(
+      "var a = x; var c = 2 * 3; { var b = a + c; print a, b; b = 3; }",
+      symbols);
+  auto nodes = PassManager::countNodes(program);
+
+  auto passes = PassManager::standard();
+  EXPECT_EQ(passes.getName(), "propagate,dead-stores,commas,types");
+  passes.setCounting(true);
+  passes.run(program);
+
+  std::int64_t removed = 0;
+  for (auto const &report : passes.getReports()) {
+    // the type inference only marks the nodes
+    if (report.name == "types") {
+      EXPECT_EQ(report.removed, 0);
+    } else {
+      EXPECT_GT(report.removed, 0) << report.name;
+    }
+    removed += report.removed;
+  }
+  EXPECT_EQ(removed, nodes - PassManager::countNodes(program));
+}
+
+TEST(PassManager, KeepsTheSemanticsOfTheProgram) {
+  for (auto const *source :
+       {"var a = 1;\n{ var b = a; b = b + 1; print b; b = 3; }\nprint a;\n",
+        "{ var a = 1; { a = 2; } }\n",
+        "{ var a = 1; var a; print a; }\n",
+        "{ var a = \"x\"; a = -a; }\n",
+        "{ var a = 1; var b = a ? a = 2 : 3; print a, b; }\n",
+        "var a;\nprint (a, 1);\n",
+        "var a = 1;\n{ var a = a + 1; print a; }\nprint a;\n",
+        "var a = \"x\";\nvar b = x ? a = 1 : 2;\nprint a + a;\n",
+        "var a = 1;\n{ var b = a < 2 ? \"x\" : \"y\"; print b + b == b; }\n",
+        "var a = 1;\n{ var a = \"x\"; { print a + a; } a = a + 1; }\n"}) {
+    EXPECT_EQ(run(source, true), run(source, false)) << source;
+  }
+}
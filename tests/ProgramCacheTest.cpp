@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../src/lib/Lox.hpp"
+#include "../src/lib/PassManager.hpp"
+#include "../src/lib/ProgramCache.hpp"
+#include "Helpers.hpp"
+
+namespace {
+// empty directory removed with the fixture
+class ProgramCacheTest : public testing::Test {
+ protected:
+  std::filesystem::path m_directory;
+
+  void SetUp() override {
+    auto const *test = testing::UnitTest::GetInstance()->current_test_info();
+    m_directory = std::filesystem::temp_directory_path() /
+                  (std::string("cpplox_") + test->name());
+    std::filesystem::remove_all(m_directory);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(m_directory); }
+
+  auto run(std::string const &source, std::string const &version = "1.0",
+           Lox::Backend backend = Lox::Backend::INTERPRETER)
+      -> std::vector<std::string> {
+    Lox lox;
+    lox.setBackend(backend);
+    lox.setProgramCache(ProgramCache{m_directory, "test.lox", version});
+    return output(lox, source);
+  }
+};
+
+constexpr char const *source =
+    "var a = 1; var b = \"x\" + \"y\";\n"
+    "{ var c = a - 2; print -c, b; }\n"
+    "a = a + 1 > 1 ? !nil : b;\n"
+    "print a == true, (b);";
+
+// of the programs Lox caches with its default passes
+auto const pipeline = PassManager::standard().getName();
+}  // namespace
+
+TEST(ProgramCache, SerializesEveryNode) {
+  SymbolTable symbols;
+  auto program = parse(source, symbols);
+
+  auto bytes = ProgramCache::serialize(program);
+
+  SymbolTable other;
+  auto loaded = ProgramCache::deserialize(bytes, other);
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(ProgramCache::serialize(loaded.value()), bytes);
+  EXPECT_EQ(other.size(), 3);
+
+  // every truncation is rejected
+  for (std::size_t size = 0; size < bytes.size(); ++size) {
+    EXPECT_FALSE(ProgramCache::deserialize(bytes.substr(0, size), other)
+                     .has_value());
+  }
+}
+
+TEST_F(ProgramCacheTest, LoadsTheStoredProgram) {
+  auto expected = run(source);
+
+  ProgramCache cache{m_directory, "test.lox", "1.0"};
+  SymbolTable symbols;
+  EXPECT_TRUE(cache.load(source, pipeline, symbols).has_value());
+  EXPECT_FALSE(cache.load(source, "", symbols).has_value());
+
+  EXPECT_EQ(run(source), expected);
+  EXPECT_EQ(run("print \"z\";"), std::vector<std::string>{"z"});
+
+  // runtime errors of a loaded program point in its source
+  auto errors = run("print 1;\nprint -\"a\";");
+  ASSERT_EQ(errors.size(), 1);
+  EXPECT_EQ(run("print 1;\nprint -\"a\";"), errors);
+}
+
+TEST_F(ProgramCacheTest, LoadsDeeplyNestedPrograms) {
+  // x is not known after the block, the expression is not folded
+  std::string deep = "var x = 1; { x = 1; } print -(x";
+  for (std::size_t i = 0; i < 100000; ++i) {
+    deep += " + (x";
+  }
+  deep += std::string(100001, ')') + ";";
+  for (std::size_t i = 0; i < 100000; ++i) {
+    deep += "{ var y = x; ";
+  }
+  deep += "print y;" + std::string(100000, '}');
+
+  auto expected = std::vector<std::string>{"-100001.000000", "1.000000"};
+  EXPECT_EQ(run(deep), expected);
+  SymbolTable symbols;
+  ProgramCache cache{m_directory, "test.lox", "1.0"};
+  auto entry = cache.load(deep, pipeline, symbols);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_NE(entry->getProgram(), nullptr);
+  EXPECT_EQ(run(deep), expected);
+}
+
+TEST_F(ProgramCacheTest, StoresTheCodeOfTheVirtualMachine) {
+  using enum Lox::Backend;
+  std::string source = "var a = 1;\nprint a + 1;\nprint -b;";
+  auto expected = run(source);
+  ASSERT_EQ(expected.size(), 1);
+
+  ProgramCache cache{m_directory, "test.lox", "1.0"};
+  SymbolTable symbols;
+  EXPECT_FALSE(cache.load(source, pipeline, symbols).value().getBytecode());
+
+  // the loaded program is compiled and stored again with its code, which
+  // runs without it until the error is located
+  EXPECT_EQ(run(source, "1.0", VIRTUAL_MACHINE), expected);
+  EXPECT_TRUE(cache.load(source, pipeline, symbols).value().getBytecode());
+  EXPECT_EQ(run(source, "1.0", VIRTUAL_MACHINE), expected);
+
+  std::string strings = "var s = \"a\";\n{ var t = s + \"b\"; print t; }";
+  auto output = std::vector<std::string>{"ab"};
+  EXPECT_EQ(run(strings, "1.0", VIRTUAL_MACHINE), output);
+  EXPECT_TRUE(cache.load(strings, pipeline, symbols).value().getBytecode());
+  EXPECT_EQ(run(strings, "1.0", VIRTUAL_MACHINE), output);
+  EXPECT_EQ(run(strings), output);
+}
+
+TEST_F(ProgramCacheTest, IgnoresStaleAndCorruptEntries) {
+  auto expected = run(source);
+  auto path = ProgramCache{m_directory, "test.lox", "1.0"}.getPath(pipeline);
+
+  // another version of the interpreter misses the entry
+  SymbolTable symbols;
+  EXPECT_FALSE(ProgramCache(m_directory, "test.lox", "2.0")
+                   .load(source, pipeline, symbols)
+                   .has_value());
+  EXPECT_EQ(run(source, "2.0"), expected);
+
+  // a corrupt entry is parsed again and replaced
+  auto size = std::filesystem::file_size(path);
+  std::filesystem::resize_file(path, size / 2);
+  EXPECT_FALSE(ProgramCache(m_directory, "test.lox", "1.0")
+                   .load(source, pipeline, symbols)
+                   .has_value());
+  EXPECT_EQ(run(source), expected);
+  EXPECT_EQ(std::filesystem::file_size(path), size);
+
+  {
+    std::fstream file{path, std::ios::in | std::ios::out | std::ios::binary};
+    file.seekp(static_cast<std::streamoff>(size - 1));
+    file.put('\xff');
+  }
+  EXPECT_FALSE(ProgramCache(m_directory, "test.lox", "1.0")
+                   .load(source, pipeline, symbols)
+                   .has_value());
+  EXPECT_EQ(run(source), expected);
+
+  // the program fails its checksum once it is decoded, the byte is in its tree
+  // before the checksum and the flag of the code
+  {
+    std::fstream file{path, std::ios::in | std::ios::out | std::ios::binary};
+    file.seekg(static_cast<std::streamoff>(size - 12));
+    auto byte = static_cast<char>(file.get());
+    file.seekp(static_cast<std::streamoff>(size - 12));
+    file.put(static_cast<char>(~byte));
+  }
+  auto entry = ProgramCache(m_directory, "test.lox", "1.0")
+                   .load(source, pipeline, symbols);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry->getProgram(), nullptr);
+  EXPECT_EQ(run(source), expected);
+}
+
+TEST_F(ProgramCacheTest, ReplacesTheEntryOfAnEditedScript) {
+  run(source);
+  auto path = ProgramCache{m_directory, "test.lox", "1.0"}.getPath(pipeline);
+  EXPECT_EQ(run("print 1;"), std::vector<std::string>{"1.000000"});
+  EXPECT_EQ(run("print 2;"), std::vector<std::string>{"2.000000"});
+
+  // a single entry, for the last source
+  auto entries = std::distance(std::filesystem::directory_iterator{m_directory},
+                               std::filesystem::directory_iterator{});
+  EXPECT_EQ(entries, 1);
+  EXPECT_TRUE(std::filesystem::exists(path));
+  SymbolTable symbols;
+  ProgramCache cache{m_directory, "test.lox", "1.0"};
+  EXPECT_FALSE(cache.load(source, pipeline, symbols).has_value());
+  EXPECT_TRUE(cache.load("print 2;", pipeline, symbols).has_value());
+}
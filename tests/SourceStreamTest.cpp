@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../src/lib/SourceStream.hpp"
+
+namespace {
+// reads the input a few bytes at a time so that every construct ends up
+// split across reads
+auto splitDeclarations(std::string_view input, std::size_t read_size)
+    -> std::vector<std::pair<std::string, std::uint32_t>> {
+  SourceStream stream{[&input, read_size](char *buffer, std::size_t size) {
+    auto count = std::min({input.size(), size, read_size});
+    std::copy_n(input.data(), count, buffer);
+    input.remove_prefix(count);
+    return static_cast<std::ptrdiff_t>(count);
+  }};
+
+  std::vector<std::pair<std::string, std::uint32_t>> declarations;
+  for (auto declaration = stream.next(); declaration.has_value();
+       declaration = stream.next()) {
+    declarations.emplace_back(declaration.value(), stream.getLine());
+  }
+  return declarations;
+}
+}  // namespace
+
+TEST(SourceStream, SplitsTopLevelDeclarations) {
+  std::string_view const input =
+      "var a = \"x;}\"; /* ; { */\n"
+      "{ var b = 1; { print b; } }\n"
+      "// ; }\n"
+      "print a;";
+
+  for (std::size_t read_size : {1, 2, 3, 64}) {
+    auto declarations = splitDeclarations(input, read_size);
+
+    ASSERT_EQ(declarations.size(), 3) << "read size " << read_size;
+    EXPECT_EQ(declarations[0].first, "var a = \"x;}\";");
+    EXPECT_EQ(declarations[0].second, 1);
+    EXPECT_EQ(declarations[1].first,
+              " /* ; { */\n{ var b = 1; { print b; } }");
+    EXPECT_EQ(declarations[1].second, 1);
+    EXPECT_EQ(declarations[2].first, "\n// ; }\nprint a;");
+    EXPECT_EQ(declarations[2].second, 2);
+  }
+}
+
+TEST(SourceStream, KeepsTheLinePrefixOfDeclarations) {
+  std::string_view const input = "var a = 1; print -\"x\";\nprint 2; print 3;";
+
+  for (std::size_t read_size : {1, 2, 3, 64}) {
+    auto remaining = input;
+    SourceStream stream{
+        [&remaining, read_size](char *buffer, std::size_t size) {
+          auto count = std::min({remaining.size(), size, read_size});
+          std::copy_n(remaining.data(), count, buffer);
+          remaining.remove_prefix(count);
+          return static_cast<std::ptrdiff_t>(count);
+        }};
+
+    std::vector<std::string> prefixes;
+    for (auto declaration = stream.next(); declaration.has_value();
+         declaration = stream.next()) {
+      prefixes.emplace_back(stream.getLinePrefix());
+    }
+    EXPECT_EQ(prefixes, (std::vector<std::string>{"", "var a = 1;",
+                                                  "var a = 1; print -\"x\";",
+                                                  "print 2;"}))
+        << "read size " << read_size;
+  }
+}
+
+TEST(SourceStream, ReturnsUnterminatedTrailingDeclaration) {
+  auto declarations = splitDeclarations("print 1;\nprint 2", 4);
+
+  ASSERT_EQ(declarations.size(), 2);
+  EXPECT_EQ(declarations[1].first, "\nprint 2");
+  EXPECT_EQ(declarations[1].second, 1);
+}
+
+TEST(SourceStream, ReportsReadErrors) {
+  SourceStream stream{[](char *, std::size_t) -> std::ptrdiff_t { return -1; }};
+
+  EXPECT_FALSE(stream.next().has_value());
+  EXPECT_TRUE(stream.hasFailed());
+}
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../src/lib/SymbolTable.hpp"
+
+TEST(SymbolTable, InternsEqualNamesOnce) {
+  SymbolTable symbols;
+
+  auto a = symbols.intern("alpha");
+  auto b = symbols.intern("beta");
+  EXPECT_EQ(a, 0);
+  EXPECT_EQ(b, 1);
+  EXPECT_EQ(symbols.intern("alpha"), a);
+  EXPECT_EQ(symbols.size(), 2);
+  EXPECT_EQ(symbols.find("beta"), b);
+  EXPECT_FALSE(symbols.find("gamma").has_value());
+}
+
+TEST(SymbolTable, OwnsTheNames) {
+  SymbolTable symbols;
+  SymbolTable::Symbol symbol = 0;
+  {
+    std::string source = "var temporary = 1;";
+    symbol = symbols.intern(std::string_view{source}.substr(4, 9));
+    source.assign(source.size(), 'x');
+  }
+  EXPECT_EQ(symbols.getName(symbol), "temporary");
+  EXPECT_EQ(symbols.getHash(symbol), SymbolTable::hash("temporary"));
+}
+
+TEST(SymbolTable, KeepsSymbolsDenseWhileGrowing) {
+  SymbolTable symbols;
+  for (int i = 0; i < 10000; ++i) {
+    EXPECT_EQ(symbols.intern("v" + std::to_string(i)), i);
+  }
+  for (int i = 0; i < 10000; ++i) {
+    auto name = "v" + std::to_string(i);
+    EXPECT_EQ(symbols.intern(name), i);
+    EXPECT_EQ(symbols.getName(i), name);
+  }
+}
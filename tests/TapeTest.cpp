@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "../src/lib/Lox.hpp"
+#include "../src/lib/Tape.hpp"
+#include "Helpers.hpp"
+
+namespace {
+// opcodes of the tape of the single print statement of source
+auto compile(std::string const &source, bool sharing = false)
+    -> std::vector<Tape::OpCode> {
+  SymbolTable symbols;
+  auto program = parse(source, symbols);
+  auto statement =
+      std::get<Node<PrintStatement> >(program.getStatements().front());
+  Tape tape;
+  tape.setSharing(sharing);
+  tape.compile(statement->getExpression());
+  std::vector<Tape::OpCode> codes;
+  for (auto const &instruction : tape.getInstructions()) {
+    codes.push_back(instruction.code);
+  }
+  return codes;
+}
+
+auto run(std::string const &source, bool fold, bool sharing = false)
+    -> std::vector<std::string> {
+  Lox lox;
+  lox.setOptimizing(fold);
+  lox.setSubexpressionSharing(sharing);
+  return output(lox, source);
+}
+}  // namespace
+
+TEST(Tape, CompilesInPostorder) {
+  using enum Tape::OpCode;
+  EXPECT_EQ(compile("print -(1 + 2) * 3;"),
+            (std::vector{NUMBER, NUMBER, ADD, NEGATE, NUMBER, MULTIPLY}));
+  EXPECT_EQ(compile("print a = !b, nil;"),
+            (std::vector{GET, NOT, SET, POP, NIL}));
+  EXPECT_EQ(compile("print a ? \"x\" : false;"),
+            (std::vector{GET, JUMP_IF_FALSE, STRING, JUMP, FALSE}));
+}
+
+TEST(Tape, EvaluatesTernariesAndCommas) {
+  // the interpreter only runs the tape while sharing
+  for (auto sharing : {false, true}) {
+    for (auto fold : {true, false}) {
+      EXPECT_EQ(
+          run("var a = 1; print a > 0 ? a < 2 ? \"b\" : \"c\" : \"d\";"
+              "print a = a + 1, a == 2 ? nil : a;",
+              fold, sharing),
+          (std::vector<std::string>{"b", "NIL"}));
+    }
+  }
+}
+
+TEST(Tape, EvaluatesDeepExpressions) {
+  std::string source = "var x = 1; print 0";
+  for (std::size_t i = 1; i < 200000; ++i) {
+    source += i % 2 == 0 ? " + x" : " * x";
+  }
+  source += ";";
+  for (auto fold : {true, false}) {
+    EXPECT_EQ(run(source, fold), std::vector<std::string>{"99999.000000"});
+  }
+}
+
+TEST(Tape, SharesCommonSubexpressions) {
+  using enum Tape::OpCode;
+  EXPECT_EQ(compile("print a * b + a * b;", true),
+            (std::vector{MULTIPLY_VARIABLES, GET, MULTIPLY, LOAD, ADD}));
+  EXPECT_EQ(compile("print -a == -a ? -a : 1;", true),
+            (std::vector{GET, NEGATE, LOAD, EQUAL, JUMP_IF_FALSE, LOAD, JUMP,
+                         NUMBER}));
+  // the assignment changes the value of a * b
+  EXPECT_EQ(compile("print a * b + (a = 1) + a * b;", true),
+            (std::vector{MULTIPLY_VARIABLES, GET, MULTIPLY, NUMBER, SET, ADD,
+                         MULTIPLY_VARIABLES, GET, MULTIPLY, ADD}));
+  // a * b is only computed when a is truthy
+  EXPECT_EQ(compile("print (a ? a * b : 0) + a * b;", true),
+            (std::vector{GET, JUMP_IF_FALSE, MULTIPLY_VARIABLES, GET, MULTIPLY,
+                         JUMP, NUMBER, MULTIPLY_VARIABLES, GET, MULTIPLY,
+                         ADD}));
+  // string literals are compared by content
+  EXPECT_EQ(compile("print a + \"x\" == a + \"x\";", true),
+            (std::vector{GET, STRING, ADD, LOAD, EQUAL}));
+}
+
+TEST(Tape, EvaluatesCommonSubexpressions) {
+  for (auto fold : {true, false}) {
+    EXPECT_EQ(run("var a = 2; var b = 3; print a * b + a * b;"
+                  "print a * b + (a = 1) + a * b;"
+                  "print (a ? b * a : 0) + b * a;"
+                  "var s = \"x\"; print s + s + (s + s);",
+                  fold, true),
+              (std::vector<std::string>{"12.000000", "10.000000", "6.000000",
+                                        "xxxx"}));
+  }
+}
+
+TEST(Tape, FusesSuperinstructions) {
+  using enum Tape::OpCode;
+  EXPECT_EQ(compile("print x = x + 1;"),
+            (std::vector{INCREMENT, NUMBER, ADD, SET}));
+  EXPECT_EQ(compile("print y = x + 1;"),
+            (std::vector{ADD_VARIABLE_NUMBER, NUMBER, ADD, SET}));
+  EXPECT_EQ(compile("print i < 10 ? a - b : a;"),
+            (std::vector{LESS_VARIABLE_NUMBER, NUMBER, LESS, JUMP_IF_FALSE,
+                         SUBTRACT_VARIABLES, GET, SUBTRACT, JUMP, GET}));
+  // the operands are not both leaves
+  EXPECT_EQ(compile("print (c ? a : b) < 1;"),
+            (std::vector{GET, JUMP_IF_FALSE, GET, JUMP, GET, NUMBER, LESS}));
+  EXPECT_EQ(compile("print 1 < x;"), (std::vector{NUMBER, GET, LESS}));
+}
+
+TEST(Tape, EvaluatesSuperinstructions) {
+  for (auto sharing : {false, true}) {
+    for (auto fold : {true, false}) {
+      EXPECT_EQ(run("var x = 1; x = x + 2; print x; print x < 4;"
+                    "var s = \"a\"; print s + s; print s == s; print x / x;"
+                    "print x = x + 1, x;",
+                    fold, sharing),
+                (std::vector<std::string>{"3.000000", "TRUE", "aa", "TRUE",
+                                          "1.000000", "4.000000"}));
+    }
+  }
+  // the errors of the sequences they replace
+  for (auto [source, message] : {
+           std::pair{"var s = \"a\"; s = s + 1;",
+                     "Operands must be two numbers or two strings\n1 | "},
+           std::pair{"var s = \"a\"; print s < 1;",
+                     "Operands must be numbers\n1 | "},
+           std::pair{"var x = 1; var y; print x * y;",
+                     "Undefined variable 'y'\n1 | "},
+           std::pair{"print x;", "Undeclared variable 'x'\n1 | "},
+       }) {
+    for (auto sharing : {false, true}) {
+      auto errors = run(source, false, sharing);
+      ASSERT_EQ(errors.size(), 1);
+      EXPECT_NE(errors[0].find(message), std::string::npos) << errors[0];
+    }
+  }
+}
+
+TEST(Tape, EvaluatesTheNodesBelowTheRecursion) {
+  // x is not known after the block, the products are not folded
+  auto nest = [](std::string const &inner) {
+    std::string source = "var x = 1; var s = \"a\"; { x = 1; } print ";
+    for (std::size_t i = 0; i < 1000; ++i) {
+      source += "x * (";
+    }
+    return source + inner + std::string(1000, ')') + ";";
+  };
+  for (auto fold : {true, false}) {
+    EXPECT_EQ(run(nest("x = x + 2"), fold),
+              std::vector<std::string>{"3.000000"});
+    EXPECT_EQ(run(nest("s + s == \"aa\" ? x + x : nil"), fold),
+              std::vector<std::string>{"2.000000"});
+  }
+  for (auto [inner, message] : {
+           std::pair{"s < 1", "Operands must be numbers\n1 | "},
+           std::pair{"-s", "Operand must be a number\n1 | "},
+       }) {
+    auto errors = run(nest(inner), false);
+    ASSERT_EQ(errors.size(), 1);
+    EXPECT_NE(errors[0].find(message), std::string::npos) << errors[0];
+  }
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "../src/lib/Interpreter.hpp"
+#include "../src/lib/Value.hpp"
+
+TEST(Value, FitsInAWord) {
+  EXPECT_EQ(sizeof(Value), 8);
+}
+
+TEST(Value, HoldsEveryType) {
+  Value number{2.5};
+  ASSERT_TRUE(number.isNumber());
+  EXPECT_EQ(number.getNumber(), 2.5);
+
+  Value boolean{false};
+  ASSERT_TRUE(boolean.isBool());
+  EXPECT_FALSE(boolean.getBool());
+  EXPECT_FALSE(boolean.isNumber());
+
+  Value nil{nullptr};
+  EXPECT_TRUE(nil.isNil());
+  EXPECT_TRUE(Value{}.isNil());
+  EXPECT_FALSE(nil.isBool());
+
+  Value string{std::string{"lox"}};
+  ASSERT_TRUE(string.isString());
+  EXPECT_EQ(string.getString(), "lox");
+  EXPECT_FALSE(string.isNumber());
+
+  EXPECT_TRUE(Value::undefined().isUndefined());
+  EXPECT_FALSE(Value::undefined().isNil());
+}
+
+TEST(Value, KeepsNaNsAndInfinitiesAsNumbers) {
+  auto infinity = std::numeric_limits<double>::infinity();
+  for (auto number : {std::nan(""), -std::nan(""), 0.0 / 0.0, -(0.0 / 0.0),
+                      infinity, -infinity}) {
+    EXPECT_TRUE(Value{number}.isNumber()) << number;
+  }
+  EXPECT_EQ(Interpreter::stringify(Value{-0.0}), "-0.000000");
+}
+
+TEST(Value, SharesStrings) {
+  Value string{std::string{"lox"}};
+  Value copy = string;
+  EXPECT_EQ(copy.getString().data(), string.getString().data());
+  Value moved = std::move(copy);
+  EXPECT_EQ(moved.getString().data(), string.getString().data());
+  string = Value{1.0};
+  EXPECT_EQ(moved.getString(), "lox");
+  auto const &same = moved;
+  moved = same;
+  EXPECT_EQ(moved.getString(), "lox");
+}
+
+TEST(Value, KeepsTheSemanticsOfTheVariant) {
+  Value string{std::string{"a"}};
+  EXPECT_TRUE(Interpreter::isTruthy(string));
+  EXPECT_TRUE(Interpreter::isTruthy(Value{0.0}));
+  EXPECT_FALSE(Interpreter::isTruthy(Value{nullptr}));
+  EXPECT_FALSE(Interpreter::isTruthy(Value{false}));
+
+  EXPECT_TRUE(Interpreter::isEqual(string, Value{std::string_view{"a"}}));
+  EXPECT_TRUE(Interpreter::isEqual(Value{0.0}, Value{-0.0}));
+  EXPECT_FALSE(Interpreter::isEqual(Value{0.0 / 0.0}, Value{0.0 / 0.0}));
+  EXPECT_FALSE(Interpreter::isEqual(Value{nullptr}, Value{false}));
+  EXPECT_TRUE(Interpreter::isEqual(Value{nullptr}, Value{}));
+
+  EXPECT_EQ(Interpreter::stringify(Value{true}), "TRUE");
+  EXPECT_EQ(Interpreter::stringify(Value{nullptr}), "NIL");
+  EXPECT_EQ(Interpreter::stringify(Value{1.5}), "1.500000");
+  EXPECT_EQ(Interpreter::stringify(string), "a");
+}
+
+TEST(Value, ConcatenatesLongStringsLazily) {
+  Value line{std::string_view{"lorem ipsum dolor sit amet\n"}};
+  Value report{std::string_view{""}};
+  Value start;
+  std::string expected;
+  for (std::size_t i = 0; i < 200000; ++i) {
+    report = Value::concatenate(report, line);
+    expected += line.getString();
+    if (i == 10) {
+      start = report;
+    }
+  }
+  // either operand can be the long one
+  auto reversed = Value::concatenate(line, report);
+  EXPECT_EQ(report.getString(), expected);
+  EXPECT_EQ(reversed.getString(), std::string{line.getString()} + expected);
+  // the strings the ropes were made of are not changed
+  EXPECT_EQ(start.getString(),
+            expected.substr(0, 11 * line.getString().size()));
+  EXPECT_EQ(line.getString(), "lorem ipsum dolor sit amet\n");
+}
+
+TEST(Value, FreesDeepRopes) {
+  // freed without being flattened
+  Value report{std::string_view{"lorem ipsum dolor sit amet\n"}};
+  Value x{std::string_view{"x"}};
+  for (std::size_t i = 0; i < 1000000; ++i) {
+    report = Value::concatenate(report, x);
+  }
+  EXPECT_TRUE(report.isString());
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "../src/lib/Bytecode.hpp"
+#include "../src/lib/Lox.hpp"
+#include "Helpers.hpp"
+
+namespace {
+// opcodes of the bytecode of source
+auto compile(std::string const &source) -> std::vector<Bytecode::OpCode> {
+  SymbolTable symbols;
+  auto program = parse(source, symbols);
+  Bytecode bytecode;
+  bytecode.compile(program.getStatements());
+  std::vector<Bytecode::OpCode> codes;
+  auto code = bytecode.getCode();
+  for (std::size_t i = 0; i < code.size(); ++i) {
+    auto opcode = static_cast<Bytecode::OpCode>(code[i]);
+    codes.push_back(opcode);
+    if (Bytecode::hasOperand(opcode)) {
+      i += sizeof(std::uint32_t);
+    }
+  }
+  return codes;
+}
+
+struct Instruction {
+  Bytecode::OpCode code;
+  std::uint32_t operand = 0;
+};
+
+// code of the instructions, with a number, a string, a global and a local
+auto load(std::vector<Instruction> const &instructions)
+    -> std::optional<Bytecode> {
+  std::vector<std::uint8_t> code;
+  for (auto [opcode, operand] : instructions) {
+    code.push_back(static_cast<std::uint8_t>(opcode));
+    if (Bytecode::hasOperand(opcode)) {
+      std::array<std::uint8_t, sizeof(operand)> bytes{};
+      std::memcpy(bytes.data(), &operand, sizeof(operand));
+      code.insert(code.end(), bytes.begin(), bytes.end());
+    }
+  }
+  return Bytecode::load(std::move(code), {1}, {"a"}, {0}, 1);
+}
+
+// output, or errors, of source run by backend
+auto run(std::string const &source, Lox::Backend backend, bool fold = false)
+    -> std::vector<std::string> {
+  Lox lox;
+  lox.setOptimizing(fold);
+  lox.setBackend(backend);
+  return output(lox, source);
+}
+}  // namespace
+
+TEST(VirtualMachine, CompilesStatements) {
+  using enum Bytecode::OpCode;
+  EXPECT_EQ(compile("var a = 1; print a + 2;"),
+            (std::vector{NUMBER, DEFINE_GLOBAL, GET_GLOBAL, NUMBER, ADD, PRINT,
+                         RETURN}));
+  // the assignment statement pops its value, the block has a local
+  EXPECT_EQ(compile("var a; { var b = a ? 1 : 2; a = b; }"),
+            (std::vector{DECLARE_GLOBAL, GET_GLOBAL, JUMP_IF_FALSE, NUMBER,
+                         JUMP, NUMBER, STORE_LOCAL, GET_LOCAL, STORE_GLOBAL,
+                         RETURN}));
+  // the ternary is the root: the assignments are in its branches
+  EXPECT_EQ(compile("c ? a = 1 : b = 2;"),
+            (std::vector{GET_GLOBAL, JUMP_IF_FALSE, NUMBER, SET_GLOBAL, JUMP,
+                         NUMBER, SET_GLOBAL, POP, RETURN}));
+}
+
+TEST(VirtualMachine, LoadsVerifiedCode) {
+  using enum Bytecode::OpCode;
+  // the offsets of the branches are 16 and 21
+  auto ternary = load({{TRUE},
+                       {JUMP_IF_FALSE, 16},
+                       {NUMBER, 0},
+                       {JUMP, 21},
+                       {STRING, 0},
+                       {PRINT},
+                       {RETURN}});
+  ASSERT_TRUE(ternary.has_value());
+  EXPECT_EQ(ternary->getStackSize(), 1);
+  EXPECT_TRUE(load({{GET_GLOBAL, 0}, {STORE_LOCAL, 0}, {RETURN}}));
+
+  // unterminated
+  EXPECT_FALSE(load({{NUMBER, 0}, {PRINT}}));
+  EXPECT_FALSE(load({{static_cast<Bytecode::OpCode>(0xff)}, {RETURN}}));
+  // operands out of the pools
+  EXPECT_FALSE(load({{NUMBER, 1}, {PRINT}, {RETURN}}));
+  EXPECT_FALSE(load({{GET_GLOBAL, 1}, {PRINT}, {RETURN}}));
+  EXPECT_FALSE(load({{GET_LOCAL, 1}, {PRINT}, {RETURN}}));
+  // pops values that were not pushed
+  EXPECT_FALSE(load({{PRINT}, {RETURN}}));
+  EXPECT_FALSE(load({{NUMBER, 0}, {ADD}, {PRINT}, {RETURN}}));
+  // jumps backward, into an operand, or to a depth another path does not have
+  EXPECT_FALSE(load({{TRUE}, {JUMP_IF_FALSE, 0}, {RETURN}}));
+  EXPECT_FALSE(load({{TRUE}, {JUMP_IF_FALSE, 8}, {NUMBER, 0}, {RETURN}}));
+  EXPECT_FALSE(load({{TRUE}, {JUMP_IF_FALSE, 11}, {NUMBER, 0}, {RETURN}}));
+}
+
+TEST(VirtualMachine, RunsAsTheInterpreter) {
+  for (auto const *source : {
+           "var a = 1; print a > 0 ? a < 2 ? \"b\" : \"c\" : \"d\";"
+           "print a = a + 1, a == 2 ? nil : a;",
+           "var a = \"g\"; { var a = \"l\"; var b = a + a; print b; }"
+           "print a; { var c; print c = 3; var c = !c; print c; }",
+           "var x = 1; x = x + 2; print x; print x < 4; print -x / 4;"
+           "print \"a\" == \"a\"; print nil == false; print 1 != nil;",
+           "var s = \"a\"; s = s + 1;",
+           "var s = \"a\"; print s < 1;",
+           "var x = 1; var y; print x * y;",
+           "print 1; print x;",
+           "{ var y; print y; }",
+           "print -\"a\";",
+       }) {
+    for (auto fold : {true, false}) {
+      EXPECT_EQ(run(source, Lox::Backend::VIRTUAL_MACHINE, fold),
+                run(source, Lox::Backend::INTERPRETER, fold))
+          << source;
+    }
+  }
+}
+
+TEST(VirtualMachine, EvaluatesDeepExpressions) {
+  std::string source = "var x = 1; print 0";
+  for (std::size_t i = 1; i < 200000; ++i) {
+    source += i % 2 == 0 ? " + x" : " * x";
+  }
+  source += ";";
+  EXPECT_EQ(run(source, Lox::Backend::VIRTUAL_MACHINE),
+            std::vector<std::string>{"99999.000000"});
+}
+
+TEST(VirtualMachine, RunsDeeplyNestedPrograms) {
+  // x is not known after the block, the expression is not folded
+  std::string source = "var x = 1; { x = 1; } print x";
+  for (std::size_t i = 1; i < 100000; ++i) {
+    source += " + (x";
+  }
+  source += std::string(99999, ')') + ";";
+  for (std::size_t i = 0; i < 100000; ++i) {
+    source += "{ var y = x; print y = -y; ";
+  }
+  source += std::string(100000, '}');
+
+  for (auto backend :
+       {Lox::Backend::VIRTUAL_MACHINE, Lox::Backend::INTERPRETER}) {
+    for (auto fold : {true, false}) {
+      auto output = run(source, backend, fold);
+      ASSERT_EQ(output.size(), 100001);
+      EXPECT_EQ(output.front(), "100000.000000");
+      EXPECT_EQ(output.back(), "-1.000000");
+    }
+  }
+}